@@ -0,0 +1,217 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <thread>
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+string FormatRow(const BenchmarkResult &result)
+{
+    const BenchmarkSummary summary = result.GetSummary();
+    char line[256];
+    snprintf(
+        line, sizeof(line), "%-40s %10zu %14.1f %12.1f %14.0f",
+        result.name.c_str(), result.corpus_size, summary.median, summary.stddev,
+        result.GetThroughput()
+    );
+    return line;
+}
+
+// "    cycles/op 1234.5 (12.3/posting), ..." or empty without counters
+string FormatCounters(const BenchmarkResult &result, bool are_requested)
+{
+    if (are_requested && result.threads == BenchmarkThreads::POOL)
+    {
+        return "    counters not read, the work runs on pool threads"s;
+    }
+    string text;
+    char value[128];
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i)
+    {
+        const auto event = static_cast<PerfEvent>(i);
+        if (!result.counters.Has(event))
+        {
+            continue;
+        }
+        snprintf(
+            value, sizeof(value), "%s%s/op %.1f",
+            text.empty() ? "    " : ", ", string(GetPerfEventName(event)).c_str(),
+            result.GetCountPerOperation(event)
+        );
+        text += value;
+        if (result.postings > 0)
+        {
+            snprintf(value, sizeof(value), " (%.2f/posting)", result.GetCountPerPosting(event));
+            text += value;
+        }
+    }
+    return text;
+}
+
+}
+
+BenchmarkSummary BenchmarkResult::GetSummary() const
+{
+    BenchmarkSummary summary;
+    if (run_times.empty())
+    {
+        return summary;
+    }
+    vector<double> times;
+    for (chrono::nanoseconds run_time : run_times)
+    {
+        times.push_back(static_cast<double>(run_time.count()) / max<size_t>(1, operations));
+    }
+    sort(times.begin(), times.end());
+    summary.min = times.front();
+    summary.max = times.back();
+    const size_t middle = times.size() / 2;
+    summary.median = times.size() % 2 == 1
+        ? times[middle]
+        : (times[middle - 1] + times[middle]) / 2;
+    for (double time : times)
+    {
+        summary.mean += time;
+    }
+    summary.mean /= times.size();
+    for (double time : times)
+    {
+        summary.stddev += (time - summary.mean) * (time - summary.mean);
+    }
+    summary.stddev = times.size() > 1 ? sqrt(summary.stddev / (times.size() - 1)) : 0;
+    return summary;
+}
+
+double BenchmarkResult::GetThroughput() const
+{
+    const double median = GetSummary().median;
+    return median > 0 ? 1e9 / median : 0;
+}
+
+double BenchmarkResult::GetCountPerOperation(PerfEvent event) const
+{
+    if (!counters.Has(event) || run_times.empty() || operations == 0)
+    {
+        return 0;
+    }
+    return static_cast<double>(counters.Get(event)) / (run_times.size() * operations);
+}
+
+double BenchmarkResult::GetCountPerPosting(PerfEvent event) const
+{
+    if (!counters.Has(event) || run_times.empty() || postings == 0)
+    {
+        return 0;
+    }
+    return static_cast<double>(counters.Get(event)) / (run_times.size() * postings);
+}
+
+BenchmarkSuite::BenchmarkSuite(BenchmarkOptions options)
+    : options_(move(options))
+{
+}
+
+bool BenchmarkSuite::IsSelected(const std::string &name) const
+{
+    return name.find(options_.filter) != string::npos;
+}
+
+const std::vector<BenchmarkResult> &BenchmarkSuite::GetResults() const
+{
+    return results_;
+}
+
+void BenchmarkSuite::Report(const BenchmarkResult &result) const
+{
+    cerr << FormatRow(result) << endl;
+    const string counters = FormatCounters(result, options_.perf_counters);
+    if (!counters.empty())
+    {
+        cerr << counters << endl;
+    }
+}
+
+void BenchmarkSuite::PrintTable(std::ostream &os) const
+{
+    char line[256];
+    snprintf(
+        line, sizeof(line), "%-40s %10s %14s %12s %14s",
+        "benchmark", "corpus", "median ns/op", "stddev", "ops/s"
+    );
+    os << line << '\n';
+    for (const BenchmarkResult &result : results_)
+    {
+        os << FormatRow(result) << '\n';
+        const string counters = FormatCounters(result, options_.perf_counters);
+        if (!counters.empty())
+        {
+            os << counters << '\n';
+        }
+    }
+}
+
+void BenchmarkSuite::WriteJson(std::ostream &os) const
+{
+    char number[64];
+    const auto format = [&number](double value) {
+        snprintf(number, sizeof(number), "%.3f", value);
+        return string(number);
+    };
+    os << "{\n  \"warmup_runs\": "s << options_.warmup_runs
+       << ",\n  \"runs\": "s << options_.runs
+       << ",\n  \"hardware_concurrency\": "s << thread::hardware_concurrency()
+       << ",\n  \"benchmarks\": ["s;
+    bool is_first = true;
+    for (const BenchmarkResult &result : results_)
+    {
+        const BenchmarkSummary summary = result.GetSummary();
+        os << (is_first ? "\n"s : ",\n"s)
+           << "    {\"name\": \""s << result.name
+           << "\", \"corpus_size\": "s << result.corpus_size
+           << ", \"operations\": "s << result.operations
+           << ", \"ns_per_op\": {\"min\": "s << format(summary.min)
+           << ", \"median\": "s << format(summary.median)
+           << ", \"mean\": "s << format(summary.mean)
+           << ", \"stddev\": "s << format(summary.stddev)
+           << ", \"max\": "s << format(summary.max)
+           << "}, \"ops_per_second\": "s << format(result.GetThroughput());
+        if (result.postings > 0)
+        {
+            os << ", \"postings\": "s << result.postings;
+        }
+        if (result.threads == BenchmarkThreads::POOL)
+        {
+            os << ", \"threads\": \"pool\""s;
+        }
+        if (result.counters.available != 0)
+        {
+            os << ", \"counters\": {"s;
+            bool is_first_counter = true;
+            for (size_t i = 0; i < PERF_EVENT_COUNT; ++i)
+            {
+                const auto event = static_cast<PerfEvent>(i);
+                if (!result.counters.Has(event))
+                {
+                    continue;
+                }
+                os << (is_first_counter ? "\""s : ", \""s) << GetPerfEventName(event)
+                   << "\": {\"per_op\": "s << format(result.GetCountPerOperation(event));
+                if (result.postings > 0)
+                {
+                    os << ", \"per_posting\": "s << format(result.GetCountPerPosting(event));
+                }
+                os << '}';
+                is_first_counter = false;
+            }
+            os << '}';
+        }
+        os << '}';
+        is_first = false;
+    }
+    os << "\n  ]\n}\n"s;
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../log_duration.h"
+#include "../perf_counters.h"
+
+struct BenchmarkOptions {
+    // runs done before the measured ones and thrown away
+    int warmup_runs = 1;
+    int runs = 5;
+    // only benchmarks whose name contains the filter are run
+    std::string filter;
+    // read the hardware counters of the calling thread around every run
+    bool perf_counters = false;
+};
+
+// threads a benchmark runs its work on
+enum class BenchmarkThreads {
+    CALLING,
+    // also pool threads, e.g. execution::par or a QueryExecutor, whose
+    // events the counters of the calling thread miss
+    POOL,
+};
+
+// per-operation times of the measured runs, in nanoseconds
+struct BenchmarkSummary {
+    double min = 0;
+    double median = 0;
+    double mean = 0;
+    double stddev = 0;
+    double max = 0;
+};
+
+struct BenchmarkResult {
+    std::string name;
+    size_t corpus_size = 0;
+    // operations done by one run
+    size_t operations = 0;
+    std::vector<std::chrono::nanoseconds> run_times;
+    // postings one run visits, 0 if the operation does not search
+    uint64_t postings = 0;
+    // summed over the measured runs, empty unless counters were requested
+    // and the work runs on the calling thread only
+    PerfCounts counters;
+    BenchmarkThreads threads = BenchmarkThreads::CALLING;
+
+    BenchmarkSummary GetSummary() const;
+    // operations per second of the median run
+    double GetThroughput() const;
+    // mean count of the event per operation and per posting, 0 if the event
+    // or the postings are unknown
+    double GetCountPerOperation(PerfEvent event) const;
+    double GetCountPerPosting(PerfEvent event) const;
+};
+
+// keeps the compiler from dropping the computation of value
+template <typename T>
+void DoNotOptimize(const T &value)
+{
+    asm volatile("" : : "g"(&value) : "memory");
+}
+
+// Runs benchmarks and collects their results. Each run first calls setup
+// untimed, then times run on the state setup returned, so every run
+// starts from the same state. The postings visited by one run, when
+// given, turn the hardware counts into counts per posting. Counters are
+// not read for benchmarks using pool threads, as they would miss most of
+// the work.
+class BenchmarkSuite
+{
+public:
+    explicit BenchmarkSuite(BenchmarkOptions options);
+
+    bool IsSelected(const std::string &name) const;
+
+    template <typename Setup, typename Run>
+    void Add(
+        const std::string &name,
+        size_t corpus_size,
+        size_t operations,
+        Setup setup,
+        Run run,
+        uint64_t postings = 0,
+        BenchmarkThreads threads = BenchmarkThreads::CALLING
+    );
+
+    const std::vector<BenchmarkResult> &GetResults() const;
+    void PrintTable(std::ostream &os) const;
+    void WriteJson(std::ostream &os) const;
+
+private:
+    const BenchmarkOptions options_;
+    std::vector<BenchmarkResult> results_;
+
+    void Report(const BenchmarkResult &result) const;
+};
+
+template <typename Setup, typename Run>
+void BenchmarkSuite::Add(
+    const std::string &name,
+    size_t corpus_size,
+    size_t operations,
+    Setup setup,
+    Run run,
+    uint64_t postings,
+    BenchmarkThreads threads
+)
+{
+    if (!IsSelected(name))
+    {
+        return;
+    }
+    BenchmarkResult result{name, corpus_size, operations, {}, postings, {}, threads};
+    const bool is_counted = options_.perf_counters && threads == BenchmarkThreads::CALLING;
+    for (int i = 0; i < options_.warmup_runs + options_.runs; ++i)
+    {
+        auto state = setup();
+        PerfCounts counters;
+        const auto start_time = std::chrono::steady_clock::now();
+        if (is_counted)
+        {
+            LOG_PERF(counters);
+            run(state);
+        }
+        else
+        {
+            run(state);
+        }
+        const auto end_time = std::chrono::steady_clock::now();
+        DoNotOptimize(state);
+        if (i >= options_.warmup_runs)
+        {
+            result.run_times.push_back(end_time - start_time);
+            result.counters += counters;
+        }
+    }
+    Report(result);
+    results_.push_back(std::move(result));
+}
@@ -0,0 +1,327 @@
+#include "benchmark.h"
+#include "../near_duplicates.h"
+#include "../process_queries.h"
+#include "../remove_duplicates.h"
+#include "../search_server.h"
+#include "../sharded_search_server.h"
+#include "workload_generator.h"
+
+#include <algorithm>
+#include <execution>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+struct Workload {
+    string stop_words;
+    vector<GeneratedDocument> documents;
+    vector<string> queries;
+};
+
+Workload GenerateWorkload(const WorkloadOptions& options, size_t document_count, size_t query_count) {
+    const WorkloadGenerator generator(options);
+    return {generator.GetStopWords(), generator.GenerateDocuments(document_count), generator.GenerateQueries(query_count)};
+}
+
+// postings the queries visit, the same for every status and predicate
+uint64_t CountPostings(const SearchServer& search_server, const vector<string>& queries) {
+    QueryStats stats;
+    for (const string& query : queries) {
+        search_server.FindTopDocuments(query, DocumentStatus::ACTUAL, stats);
+    }
+    return stats.postings_scanned;
+}
+
+SearchServer BuildServer(const Workload& workload) {
+    SearchServer search_server(workload.stop_words);
+    for (size_t i = 0; i < workload.documents.size(); ++i) {
+        const GeneratedDocument& document = workload.documents[i];
+        search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+    }
+    return search_server;
+}
+
+void RunSuite(BenchmarkSuite& suite, const WorkloadOptions& options, size_t corpus_size, size_t query_count) {
+    const Workload workload = GenerateWorkload(options, corpus_size, query_count);
+    const SearchServer search_server = BuildServer(workload);
+    const auto& documents = workload.documents;
+    const auto& queries = workload.queries;
+    const uint64_t postings = CountPostings(search_server, queries);
+    const auto no_setup = [] { return 0; };
+    const auto even_ids = [](int document_id, DocumentStatus, int) {
+        return document_id % 2 == 0;
+    };
+
+    suite.Add(
+        "AddDocument"s, corpus_size, documents.size(),
+        [&] { return SearchServer(workload.stop_words); },
+        [&](SearchServer& server) {
+            for (size_t i = 0; i < documents.size(); ++i) {
+                server.AddDocument(i, documents[i].text, DocumentStatus::ACTUAL, {1, 2, 3});
+            }
+        }
+    );
+    suite.Add(
+        "AddDocuments/sharded"s, corpus_size, documents.size(),
+        [&] {
+            vector<NewDocument> new_documents;
+            new_documents.reserve(documents.size());
+            for (size_t i = 0; i < documents.size(); ++i) {
+                new_documents.push_back({static_cast<int>(i), documents[i].text, DocumentStatus::ACTUAL, {1, 2, 3}});
+            }
+            return make_pair(
+                make_unique<ShardedSearchServer>(thread::hardware_concurrency(), workload.stop_words),
+                move(new_documents)
+            );
+        },
+        [](auto& state) {
+            state.first->AddDocuments(state.second);
+        },
+        0,
+        BenchmarkThreads::POOL
+    );
+    for (const auto& [name, is_parallel] : {pair{"RemoveDocument/seq"s, false}, pair{"RemoveDocument/par"s, true}}) {
+        const size_t remove_count = min<size_t>(documents.size(), 1000);
+        suite.Add(
+            name, corpus_size, remove_count,
+            [&] { return search_server; },
+            [&, is_parallel = is_parallel](SearchServer& server) {
+                for (size_t i = 0; i < remove_count; ++i) {
+                    if (is_parallel) {
+                        server.RemoveDocument(execution::par, i);
+                    } else {
+                        server.RemoveDocument(execution::seq, i);
+                    }
+                }
+            },
+            0,
+            is_parallel ? BenchmarkThreads::POOL : BenchmarkThreads::CALLING
+        );
+    }
+    suite.Add(
+        "FindTopDocuments"s, corpus_size, queries.size(), no_setup,
+        [&](int&) {
+            for (const string& query : queries) {
+                DoNotOptimize(search_server.FindTopDocuments(query));
+            }
+        },
+        postings
+    );
+    suite.Add(
+        "FindTopDocuments/seq"s, corpus_size, queries.size(), no_setup,
+        [&](int&) {
+            for (const string& query : queries) {
+                DoNotOptimize(search_server.FindTopDocuments(execution::seq, query));
+            }
+        },
+        postings
+    );
+    suite.Add(
+        "FindTopDocuments/par"s, corpus_size, queries.size(), no_setup,
+        [&](int&) {
+            for (const string& query : queries) {
+                DoNotOptimize(search_server.FindTopDocuments(execution::par, query));
+            }
+        },
+        postings,
+        BenchmarkThreads::POOL
+    );
+    suite.Add(
+        "FindTopDocuments/bm25"s, corpus_size, queries.size(),
+        [&] {
+            auto server = make_unique<SearchServer>(search_server);
+            server->SetScoringModel(Bm25{});
+            return server;
+        },
+        [&](unique_ptr<SearchServer>& server) {
+            for (const string& query : queries) {
+                DoNotOptimize(server->FindTopDocuments(query));
+            }
+        },
+        postings
+    );
+    for (const auto& [name, precision] : {
+             pair{"FindTopDocuments/impact8"s, ImpactPrecision::BITS_8},
+             pair{"FindTopDocuments/impact16"s, ImpactPrecision::BITS_16},
+         }) {
+        suite.Add(
+            name, corpus_size, queries.size(),
+            [&, precision = precision] {
+                auto server = make_unique<SearchServer>(search_server);
+                server->BuildImpactIndex(precision);
+                return server;
+            },
+            [&](unique_ptr<SearchServer>& server) {
+                for (const string& query : queries) {
+                    DoNotOptimize(server->FindTopDocumentsByImpact(query));
+                }
+            }
+        );
+    }
+    suite.Add(
+        "FindTopDocuments/status"s, corpus_size, queries.size(), no_setup,
+        [&](int&) {
+            for (const string& query : queries) {
+                DoNotOptimize(search_server.FindTopDocuments(query, DocumentStatus::BANNED));
+            }
+        },
+        postings
+    );
+    suite.Add(
+        "FindTopDocuments/predicate"s, corpus_size, queries.size(), no_setup,
+        [&](int&) {
+            for (const string& query : queries) {
+                DoNotOptimize(search_server.FindTopDocuments(query, even_ids));
+            }
+        },
+        postings
+    );
+    suite.Add(
+        "FindTopDocuments/par/predicate"s, corpus_size, queries.size(), no_setup,
+        [&](int&) {
+            for (const string& query : queries) {
+                DoNotOptimize(search_server.FindTopDocuments(execution::par, query, even_ids));
+            }
+        },
+        postings,
+        BenchmarkThreads::POOL
+    );
+    for (const auto& [name, is_parallel] : {pair{"MatchDocument/seq"s, false}, pair{"MatchDocument/par"s, true}}) {
+        suite.Add(
+            name, corpus_size, queries.size(), no_setup,
+            [&, is_parallel = is_parallel](int&) {
+                for (size_t i = 0; i < queries.size(); ++i) {
+                    const int document_id = i % documents.size();
+                    if (is_parallel) {
+                        DoNotOptimize(search_server.MatchDocument(execution::par, queries[i], document_id));
+                    } else {
+                        DoNotOptimize(search_server.MatchDocument(queries[i], document_id));
+                    }
+                }
+            },
+            0,
+            is_parallel ? BenchmarkThreads::POOL : BenchmarkThreads::CALLING
+        );
+    }
+    suite.Add(
+        "ProcessQueries"s, corpus_size, queries.size(), no_setup,
+        [&](int&) { DoNotOptimize(ProcessQueries(search_server, queries)); },
+        postings,
+        BenchmarkThreads::POOL
+    );
+    suite.Add(
+        "ProcessQueriesJoined"s, corpus_size, queries.size(), no_setup,
+        [&](int&) { DoNotOptimize(ProcessQueriesJoined(search_server, queries)); },
+        postings,
+        BenchmarkThreads::POOL
+    );
+    // every tenth document repeats the words of the one before it, for
+    // near duplicates with one more word
+    const auto build_duplicated = [&](bool is_near) {
+        SearchServer server(workload.stop_words);
+        for (size_t i = 0; i < documents.size(); ++i) {
+            if (i % 10 == 9) {
+                const string& text = documents[i].text;
+                const string extra_word = is_near ? " "s + text.substr(0, text.find(' ')) : ""s;
+                server.AddDocument(i, documents[i - 1].text + extra_word, DocumentStatus::ACTUAL, {1});
+            } else {
+                server.AddDocument(i, documents[i].text, DocumentStatus::ACTUAL, {1});
+            }
+        }
+        return server;
+    };
+    suite.Add(
+        "RemoveDuplicates"s, corpus_size, documents.size(),
+        [&] { return build_duplicated(false); },
+        [](SearchServer& server) { RemoveDuplicates(server); },
+        0,
+        BenchmarkThreads::POOL
+    );
+    suite.Add(
+        "RemoveNearDuplicates"s, corpus_size, documents.size(),
+        [&] { return build_duplicated(true); },
+        [](SearchServer& server) { RemoveNearDuplicates(server, 0.8); },
+        0,
+        BenchmarkThreads::POOL
+    );
+}
+
+vector<size_t> ParseSizes(const string& text) {
+    vector<size_t> sizes;
+    size_t start = 0;
+    while (start < text.size()) {
+        const size_t comma = min(text.find(',', start), text.size());
+        sizes.push_back(stoul(text.substr(start, comma - start)));
+        start = comma + 1;
+    }
+    return sizes;
+}
+
+void PrintUsage() {
+    cerr << "Usage: benchmark [--sizes <n>[,<n>]...] [--queries <count>]\n"
+            "                 [--runs <count>] [--warmup <count>]\n"
+            "                 [--seed <seed>] [--zipf <exponent>]\n"
+            "                 [--filter <substring>] [--json <file>] [--perf on|off]\n"
+            "With --perf on, hardware counters of the benchmark thread are read\n"
+            "around every run where perf_event_open is allowed. Benchmarks also\n"
+            "running on pool threads report no counters.\n";
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    BenchmarkOptions options;
+    WorkloadOptions workload_options;
+    vector<size_t> sizes = {1'000, 10'000};
+    size_t query_count = 1'000;
+    string json_path;
+    for (int i = 1; i < argc; ++i) {
+        const string arg = argv[i];
+        if (i + 1 >= argc) {
+            PrintUsage();
+            return 1;
+        }
+        const string value = argv[++i];
+        if (arg == "--sizes") {
+            sizes = ParseSizes(value);
+        } else if (arg == "--queries") {
+            query_count = stoul(value);
+        } else if (arg == "--runs") {
+            options.runs = max(1, stoi(value));
+        } else if (arg == "--warmup") {
+            options.warmup_runs = max(0, stoi(value));
+        } else if (arg == "--seed") {
+            workload_options.seed = stoull(value);
+        } else if (arg == "--zipf") {
+            workload_options.zipf_exponent = workload_options.query_zipf_exponent = stod(value);
+        } else if (arg == "--perf" && (value == "on" || value == "off")) {
+            options.perf_counters = value == "on";
+        } else if (arg == "--filter") {
+            options.filter = value;
+        } else if (arg == "--json") {
+            json_path = value;
+        } else {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    if (options.perf_counters && !GetThreadPerfCounters().IsAvailable()) {
+        cerr << "Hardware counters are unavailable, reporting times only" << endl;
+    }
+    BenchmarkSuite suite(options);
+    for (size_t size : sizes) {
+        RunSuite(suite, workload_options, size, query_count);
+    }
+    suite.PrintTable(cout);
+    if (!json_path.empty()) {
+        ofstream json(json_path);
+        suite.WriteJson(json);
+    }
+    return 0;
+}
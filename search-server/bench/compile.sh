@@ -0,0 +1,5 @@
+LIB="../document.cpp ../forward_index.cpp ../impact_index.cpp ../latency_histogram.cpp ../min_hash.cpp ../near_duplicates.cpp ../perf_counters.cpp ../process_queries.cpp ../query_executor.cpp ../query_stats.cpp ../read_input_functions.cpp ../remove_duplicates.cpp ../scoring_model.cpp ../search_cursor.cpp ../search_server.cpp ../sharded_search_server.cpp ../signature_index.cpp ../slow_query_log.cpp ../string_processing.cpp ../term_set_signature.cpp ../text_storage.cpp ../tracing.cpp ../versioned_search_server.cpp"
+g++ -std=c++17 ${OPT:--O2} replay_main.cpp corpus.cpp $LIB -ltbb -lpthread -o replay
+g++ -std=c++17 ${OPT:--O2} benchmark_main.cpp benchmark.cpp workload_generator.cpp $LIB -ltbb -lpthread -o benchmark
+g++ -std=c++17 ${OPT:--O2} generate_main.cpp workload_generator.cpp $LIB -ltbb -lpthread -o generate_workload
+g++ -std=c++17 ${OPT:--O2} load_main.cpp load_driver.cpp corpus.cpp workload_generator.cpp $LIB -ltbb -lpthread -o load_test
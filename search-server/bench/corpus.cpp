@@ -0,0 +1,67 @@
+#include "corpus.h"
+#include "../read_input_functions.h"
+
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+string_view CutField(string_view &line)
+{
+    line.remove_prefix(min(line.find_first_not_of(' '), line.size()));
+    const size_t space = min(line.find(' '), line.size());
+    const string_view field = line.substr(0, space);
+    line.remove_prefix(min(space + 1, line.size()));
+    return field;
+}
+
+vector<int> ParseRatings(string_view text)
+{
+    vector<int> ratings;
+    if (text == "-"sv)
+    {
+        return ratings;
+    }
+    while (!text.empty())
+    {
+        const size_t comma = min(text.find(','), text.size());
+        ratings.push_back(stoi(string(text.substr(0, comma))));
+        text.remove_prefix(min(comma + 1, text.size()));
+    }
+    return ratings;
+}
+
+}
+
+size_t LoadCorpus(std::istream &input, SearchServer &search_server)
+{
+    size_t count = 0;
+    string line;
+    while (ReadLine(input, line))
+    {
+        string_view rest = line;
+        if (rest.empty())
+        {
+            continue;
+        }
+        if (rest.substr(0, 4) == "ADD "sv)
+        {
+            rest.remove_prefix(4);
+        }
+        const int document_id = stoi(string(CutField(rest)));
+        const auto status = ParseStatus(CutField(rest));
+        if (!status)
+        {
+            throw invalid_argument("Invalid status in corpus line: "s + line);
+        }
+        const vector<int> ratings = ParseRatings(CutField(rest));
+        search_server.AddDocument(document_id, string(rest), *status, ratings);
+        ++count;
+    }
+    return count;
+}
@@ -0,0 +1,10 @@
+#pragma once
+#include <iostream>
+
+#include "../search_server.h"
+
+// Adds the documents of a corpus file to the server and returns their
+// number. Every line is "<id> <status> <ratings> <text>", optionally
+// prefixed with "ADD ", so the request files loaded by the network server
+// work as they are; <ratings> is a comma separated list or "-".
+size_t LoadCorpus(std::istream &input, SearchServer &search_server);
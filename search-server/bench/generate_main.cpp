@@ -0,0 +1,97 @@
+#include "workload_generator.h"
+
+#include <fstream>
+#include <iostream>
+#include <string>
+
+using namespace std;
+
+namespace {
+
+void PrintUsage()
+{
+    cerr << "Usage: generate_workload --corpus <file> [--queries <file>]\n"
+            "                         [--documents <count>] [--query-count <count>]\n"
+            "                         [--seed <seed>] [--vocabulary <size>] [--zipf <exponent>]\n"
+            "                         [--document-length <median>] [--minus-words <probability>]\n"
+            "Writes a synthetic corpus in the format read by replay and prints\n"
+            "its stop words.\n";
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    WorkloadOptions options;
+    string corpus_path;
+    string queries_path;
+    size_t document_count = 100'000;
+    size_t query_count = 10'000;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 1;
+        }
+        const string value = argv[++i];
+        if (arg == "--corpus")
+        {
+            corpus_path = value;
+        }
+        else if (arg == "--queries")
+        {
+            queries_path = value;
+        }
+        else if (arg == "--documents")
+        {
+            document_count = stoul(value);
+        }
+        else if (arg == "--query-count")
+        {
+            query_count = stoul(value);
+        }
+        else if (arg == "--seed")
+        {
+            options.seed = stoull(value);
+        }
+        else if (arg == "--vocabulary")
+        {
+            options.vocabulary_size = stoul(value);
+        }
+        else if (arg == "--zipf")
+        {
+            options.zipf_exponent = options.query_zipf_exponent = stod(value);
+        }
+        else if (arg == "--document-length")
+        {
+            options.document_length_median = stod(value);
+        }
+        else if (arg == "--minus-words")
+        {
+            options.minus_word_probability = stod(value);
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (corpus_path.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    const WorkloadGenerator generator(options);
+    ofstream corpus(corpus_path);
+    WriteCorpus(corpus, generator.GenerateDocuments(document_count));
+    if (!queries_path.empty())
+    {
+        ofstream queries(queries_path);
+        WriteQueries(queries, generator.GenerateQueries(query_count));
+    }
+    cout << generator.GetStopWords() << endl;
+    return 0;
+}
@@ -0,0 +1,222 @@
+#include "load_driver.h"
+#include "benchmark.h"
+#include "../process_queries.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <random>
+#include <stdexcept>
+#include <thread>
+
+using namespace std;
+using namespace std::literals;
+
+LoadDriver::LoadDriver(
+    VersionedSearchServer &search_server,
+    vector<string> queries,
+    vector<GeneratedDocument> new_documents,
+    LoadOptions options
+)
+    : search_server_(search_server),
+      queries_(move(queries)),
+      new_documents_(move(new_documents)),
+      options_(move(options))
+{
+    if (queries_.empty())
+    {
+        throw invalid_argument("Load needs at least one query"s);
+    }
+    if (options_.client_count == 0 || options_.batch_size == 0)
+    {
+        throw invalid_argument("Client count and batch size must be positive"s);
+    }
+}
+
+LoadStep LoadDriver::RunStep(double target_rate)
+{
+    if (target_rate < 0)
+    {
+        throw invalid_argument("Target rate must not be negative"s);
+    }
+    // lets every thread start before the first request is due
+    const auto start = Clock::now() + 20ms;
+    const auto end = start + options_.step_duration;
+
+    vector<LoadStep> client_results(options_.client_count);
+    LoadStep result;
+    result.target_rate = target_rate;
+    {
+        vector<thread> threads;
+        threads.reserve(options_.client_count + 1);
+        const double client_rate = target_rate / options_.client_count;
+        for (size_t i = 0; i < options_.client_count; ++i)
+        {
+            threads.emplace_back([&, i] {
+                RunClient(i, client_rate, start, end, client_results[i]);
+            });
+        }
+        if (options_.write_rate > 0)
+        {
+            threads.emplace_back([&] {
+                RunWriter(start, end, result);
+            });
+        }
+        for (thread &t : threads)
+        {
+            t.join();
+        }
+    }
+    const chrono::duration<double> elapsed = max(Clock::now(), end) - start;
+    for (const LoadStep &client_result : client_results)
+    {
+        result.completed += client_result.completed;
+        result.latency.Merge(client_result.latency);
+        result.service_time.Merge(client_result.service_time);
+    }
+    result.achieved_rate = result.completed / elapsed.count();
+    result.write_rate = result.written / elapsed.count();
+    ++step_index_;
+    return result;
+}
+
+vector<LoadStep> LoadDriver::Run(const vector<double> &target_rates)
+{
+    vector<LoadStep> steps;
+    steps.reserve(target_rates.size());
+    for (double target_rate : target_rates)
+    {
+        steps.push_back(RunStep(target_rate));
+    }
+    return steps;
+}
+
+void LoadDriver::RunClient(
+    size_t client_index,
+    double client_rate,
+    Clock::time_point start,
+    Clock::time_point end,
+    LoadStep &result
+)
+{
+    mt19937_64 generator(options_.seed ^ (step_index_ << 32) ^ client_index);
+    // clients start at different queries so they do not share cache lines
+    size_t query_index = client_index * queries_.size() / options_.client_count;
+    vector<string> batch(options_.batch_size);
+
+    auto intended = start;
+    while (true)
+    {
+        if (client_rate > 0)
+        {
+            const double interval = options_.mode == LoadMode::OPEN_LOOP
+                ? exponential_distribution<>(client_rate)(generator)
+                : 1.0 / client_rate;
+            intended += chrono::duration_cast<Clock::duration>(chrono::duration<double>(interval));
+        }
+        else
+        {
+            intended = Clock::now();
+        }
+        if (intended >= end)
+        {
+            break;
+        }
+        this_thread::sleep_until(intended);
+
+        const auto sent = Clock::now();
+        if (options_.batch_size == 1)
+        {
+            DoNotOptimize(search_server_.FindTopDocuments(queries_[query_index++ % queries_.size()]));
+        }
+        else
+        {
+            for (string &query : batch)
+            {
+                query = queries_[query_index++ % queries_.size()];
+            }
+            DoNotOptimize(ProcessQueries(*search_server_.GetSnapshot(), batch));
+        }
+        const auto done = Clock::now();
+        result.latency.Record(done - intended);
+        result.service_time.Record(done - sent);
+        ++result.completed;
+    }
+}
+
+void LoadDriver::RunWriter(Clock::time_point start, Clock::time_point end, LoadStep &result)
+{
+    for (auto tick = start + options_.write_interval; tick <= end; tick += options_.write_interval)
+    {
+        this_thread::sleep_until(tick);
+        const chrono::duration<double> elapsed = tick - start;
+        const size_t due = static_cast<size_t>(options_.write_rate * elapsed.count());
+        const size_t count = min(due - result.written, new_documents_.size() - next_document_);
+        if (count == 0)
+        {
+            continue;
+        }
+        const auto first = new_documents_.begin() + next_document_;
+        const auto begin = Clock::now();
+        search_server_.Update([first, count](SearchServer &search_server) {
+            for (auto it = first; it != first + count; ++it)
+            {
+                search_server.AddDocument(it->id, it->text, it->status, it->ratings);
+            }
+        });
+        result.write_latency.Record(Clock::now() - begin);
+        next_document_ += count;
+        result.written += count;
+    }
+}
+
+void PrintLoadCurve(ostream &os, const vector<LoadStep> &steps)
+{
+    const auto us = [](chrono::nanoseconds duration) {
+        return duration.count() / 1000.0;
+    };
+    os << left << setw(12) << "target/s"s << right << setw(12) << "achieved/s"s
+       << setw(10) << "writes/s"s << setw(12) << "p50 us"s << setw(12) << "p90 us"s
+       << setw(12) << "p99 us"s << setw(12) << "p999 us"s << setw(12) << "max us"s
+       << setw(16) << "uncorr p99 us"s << '\n';
+    os << fixed << setprecision(1);
+    for (const LoadStep &step : steps)
+    {
+        os << left << setw(12);
+        if (step.target_rate > 0)
+        {
+            os << step.target_rate;
+        }
+        else
+        {
+            os << "max"s;
+        }
+        os << right << setw(12) << step.achieved_rate << setw(10) << step.write_rate
+           << setw(12) << us(step.latency.GetPercentile(50))
+           << setw(12) << us(step.latency.GetPercentile(90))
+           << setw(12) << us(step.latency.GetPercentile(99))
+           << setw(12) << us(step.latency.GetPercentile(99.9))
+           << setw(12) << us(step.latency.GetMax())
+           << setw(16) << us(step.service_time.GetPercentile(99)) << '\n';
+    }
+    os << defaultfloat;
+}
+
+void WriteLoadCurveCsv(ostream &os, const vector<LoadStep> &steps)
+{
+    const auto us = [](chrono::nanoseconds duration) {
+        return duration.count() / 1000.0;
+    };
+    os << "target_rate,achieved_rate,write_rate,completed,written,"
+          "p50_us,p90_us,p99_us,p999_us,max_us,service_p50_us,service_p99_us,write_p99_us\n"s;
+    for (const LoadStep &step : steps)
+    {
+        os << step.target_rate << ',' << step.achieved_rate << ',' << step.write_rate << ','
+           << step.completed << ',' << step.written << ','
+           << us(step.latency.GetPercentile(50)) << ',' << us(step.latency.GetPercentile(90)) << ','
+           << us(step.latency.GetPercentile(99)) << ',' << us(step.latency.GetPercentile(99.9)) << ','
+           << us(step.latency.GetMax()) << ','
+           << us(step.service_time.GetPercentile(50)) << ',' << us(step.service_time.GetPercentile(99)) << ','
+           << us(step.write_latency.GetPercentile(99)) << '\n';
+    }
+}
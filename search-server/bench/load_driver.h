@@ -0,0 +1,94 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../latency_histogram.h"
+#include "../versioned_search_server.h"
+#include "workload_generator.h"
+
+enum class LoadMode {
+    // requests arrive as a Poisson process whatever the response times
+    OPEN_LOOP,
+    // every client sends its requests at a fixed pace, or back to back when
+    // the target rate is 0
+    CLOSED_LOOP,
+};
+
+struct LoadOptions {
+    LoadMode mode = LoadMode::OPEN_LOOP;
+    size_t client_count = 8;
+    std::chrono::milliseconds step_duration{5'000};
+    // queries searched together with ProcessQueries per request, 1 to call
+    // FindTopDocuments
+    size_t batch_size = 1;
+    // documents added per second while the clients run, 0 for none
+    double write_rate = 0;
+    // writes due within the interval are published as one version
+    std::chrono::milliseconds write_interval{100};
+    uint64_t seed = 1;
+};
+
+// Result of running the load at one target rate. Latencies are measured
+// from the time a request was due to be sent, not from the time it was
+// sent, so a stalled server is charged for the requests queued behind the
+// stall instead of hiding them (coordinated omission).
+struct LoadStep {
+    double target_rate = 0;
+    // requests completed per second
+    double achieved_rate = 0;
+    double write_rate = 0;
+    size_t completed = 0;
+    size_t written = 0;
+    LatencyHistogram latency;
+    // from the actual send time, what an uncorrected benchmark would report
+    LatencyHistogram service_time;
+    // time to publish one batch of writes
+    LatencyHistogram write_latency;
+};
+
+// Drives a server from client threads at a series of target rates while a
+// writer thread adds documents, giving a throughput/latency curve.
+class LoadDriver
+{
+public:
+    // writes add the documents in order; the server must not already
+    // contain their ids
+    LoadDriver(
+        VersionedSearchServer &search_server,
+        std::vector<std::string> queries,
+        std::vector<GeneratedDocument> new_documents,
+        LoadOptions options
+    );
+
+    // target_rate is in requests per second over all clients; 0 runs a
+    // closed loop as fast as the server answers
+    LoadStep RunStep(double target_rate);
+    std::vector<LoadStep> Run(const std::vector<double> &target_rates);
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    VersionedSearchServer &search_server_;
+    const std::vector<std::string> queries_;
+    const std::vector<GeneratedDocument> new_documents_;
+    const LoadOptions options_;
+    size_t next_document_ = 0;
+    uint64_t step_index_ = 0;
+
+    void RunClient(
+        size_t client_index,
+        double client_rate,
+        Clock::time_point start,
+        Clock::time_point end,
+        LoadStep &result
+    );
+    void RunWriter(Clock::time_point start, Clock::time_point end, LoadStep &result);
+};
+
+void PrintLoadCurve(std::ostream &os, const std::vector<LoadStep> &steps);
+// one row per step, latencies in microseconds
+void WriteLoadCurveCsv(std::ostream &os, const std::vector<LoadStep> &steps);
@@ -0,0 +1,176 @@
+#include "corpus.h"
+#include "load_driver.h"
+#include "workload_generator.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void PrintUsage()
+{
+    cerr << "Usage: load_test [--rates <rate>[,<rate>]...] [--mode open|closed]\n"
+            "                 [--clients <count>] [--duration-ms <ms>] [--batch <size>]\n"
+            "                 [--write-rate <documents per second>]\n"
+            "                 [--corpus <file> --stop-words <words> | --documents <count>]\n"
+            "                 [--queries <file> | --query-count <count>]\n"
+            "                 [--seed <seed>] [--zipf <exponent>] [--csv <file>]\n"
+            "Runs the load at every target rate, 0 meaning as fast as possible,\n"
+            "and prints the throughput/latency curve.\n";
+}
+
+vector<double> ParseRates(const string &text)
+{
+    vector<double> rates;
+    size_t start = 0;
+    while (start < text.size())
+    {
+        const size_t comma = min(text.find(',', start), text.size());
+        rates.push_back(stod(text.substr(start, comma - start)));
+        start = comma + 1;
+    }
+    return rates;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    LoadOptions options;
+    WorkloadOptions workload_options;
+    vector<double> rates = {1'000, 2'000, 5'000, 10'000, 0};
+    string corpus_path;
+    string stop_words;
+    string queries_path;
+    string csv_path;
+    size_t document_count = 50'000;
+    size_t query_count = 10'000;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 1;
+        }
+        const string value = argv[++i];
+        if (arg == "--rates")
+        {
+            rates = ParseRates(value);
+        }
+        else if (arg == "--mode" && (value == "open" || value == "closed"))
+        {
+            options.mode = value == "open" ? LoadMode::OPEN_LOOP : LoadMode::CLOSED_LOOP;
+        }
+        else if (arg == "--clients")
+        {
+            options.client_count = max(1ul, stoul(value));
+        }
+        else if (arg == "--duration-ms")
+        {
+            options.step_duration = chrono::milliseconds(stol(value));
+        }
+        else if (arg == "--batch")
+        {
+            options.batch_size = max(1ul, stoul(value));
+        }
+        else if (arg == "--write-rate")
+        {
+            options.write_rate = stod(value);
+        }
+        else if (arg == "--corpus")
+        {
+            corpus_path = value;
+        }
+        else if (arg == "--stop-words")
+        {
+            stop_words = value;
+        }
+        else if (arg == "--documents")
+        {
+            document_count = stoul(value);
+        }
+        else if (arg == "--queries")
+        {
+            queries_path = value;
+        }
+        else if (arg == "--query-count")
+        {
+            query_count = stoul(value);
+        }
+        else if (arg == "--seed")
+        {
+            options.seed = workload_options.seed = stoull(value);
+        }
+        else if (arg == "--zipf")
+        {
+            workload_options.zipf_exponent = workload_options.query_zipf_exponent = stod(value);
+        }
+        else if (arg == "--csv")
+        {
+            csv_path = value;
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+
+    const WorkloadGenerator generator(workload_options);
+    SearchServer search_server(corpus_path.empty() ? generator.GetStopWords() : stop_words);
+    int next_id = 0;
+    if (corpus_path.empty())
+    {
+        for (const GeneratedDocument &document : generator.GenerateDocuments(document_count))
+        {
+            search_server.AddDocument(document.id, document.text, document.status, document.ratings);
+        }
+        next_id = static_cast<int>(document_count);
+    }
+    else
+    {
+        ifstream corpus(corpus_path);
+        LoadCorpus(corpus, search_server);
+        for (const int document_id : search_server)
+        {
+            next_id = max(next_id, document_id + 1);
+        }
+    }
+    vector<string> queries;
+    if (queries_path.empty())
+    {
+        queries = generator.GenerateQueries(query_count);
+    }
+    else
+    {
+        ifstream input(queries_path);
+        queries = ReadQueries(input);
+    }
+
+    // enough new documents for every step at the full write rate
+    const double total_seconds = chrono::duration<double>(options.step_duration).count() * rates.size();
+    const size_t write_count = static_cast<size_t>(options.write_rate * total_seconds) + 1;
+    cerr << "Loaded "s << search_server.GetDocumentCount() << " documents, "s << queries.size() << " queries"s << endl;
+
+    VersionedSearchServer versioned_server(move(search_server));
+    LoadDriver driver(versioned_server, move(queries), generator.GenerateDocuments(write_count, next_id), options);
+    vector<LoadStep> steps;
+    for (double rate : rates)
+    {
+        steps.push_back(driver.RunStep(rate));
+        PrintLoadCurve(cerr, {steps.back()});
+    }
+    PrintLoadCurve(cout, steps);
+    if (!csv_path.empty())
+    {
+        ofstream csv(csv_path);
+        WriteLoadCurveCsv(csv, steps);
+    }
+    return 0;
+}
@@ -0,0 +1,113 @@
+#include "corpus.h"
+#include "../latency_histogram.h"
+#include "../slow_query_log.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void PrintUsage()
+{
+    cerr << "Usage: replay --corpus <file> --slow-queries <file>\n"
+            "              [--stop-words <words>] [--repeat <count>]\n"
+            "Runs every captured query <count> times against the corpus and\n"
+            "compares the work and latency with the captured ones.\n";
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    string corpus_path;
+    string slow_queries_path;
+    string stop_words;
+    int repeat_count = 10;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 1;
+        }
+        const string value = argv[++i];
+        if (arg == "--corpus")
+        {
+            corpus_path = value;
+        }
+        else if (arg == "--slow-queries")
+        {
+            slow_queries_path = value;
+        }
+        else if (arg == "--stop-words")
+        {
+            stop_words = value;
+        }
+        else if (arg == "--repeat")
+        {
+            repeat_count = max(1, stoi(value));
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if (corpus_path.empty() || slow_queries_path.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    SearchServer search_server(stop_words);
+    ifstream corpus(corpus_path);
+    LoadCorpus(corpus, search_server);
+    ifstream slow_queries_file(slow_queries_path);
+    const vector<SlowQuery> slow_queries = ReadSlowQueries(slow_queries_file);
+    cout << "Loaded "s << search_server.GetDocumentCount() << " documents, generation "s
+         << search_server.GetGeneration() << ", "s << slow_queries.size() << " slow queries"s << endl;
+
+    LatencyHistogram total;
+    size_t skipped = 0;
+    for (const SlowQuery &slow_query : slow_queries)
+    {
+        if (!slow_query.status)
+        {
+            // the predicate of the search was not captured
+            ++skipped;
+            continue;
+        }
+        if (slow_query.generation != search_server.GetGeneration())
+        {
+            cout << "# captured at generation "s << slow_query.generation
+                 << ", the results may differ"s << endl;
+        }
+        LatencyHistogram histogram;
+        QueryStats stats;
+        for (int i = 0; i < repeat_count; ++i)
+        {
+            stats = QueryStats{};
+            const auto start_time = chrono::steady_clock::now();
+            search_server.FindTopDocuments(slow_query.raw_query, *slow_query.status, stats);
+            histogram.Record(chrono::steady_clock::now() - start_time);
+        }
+        total.Merge(histogram);
+        cout << slow_query.raw_query << '\n'
+             << "  captured: "s << slow_query.latency.count() << " ns "s << slow_query.stats << '\n'
+             << "  replayed: "s << histogram << '\n'
+             << "  last run: "s << stats << endl;
+    }
+    cout << "All replays: "s << total << endl;
+    if (skipped > 0)
+    {
+        cout << "Skipped "s << skipped << " queries with custom predicates"s << endl;
+    }
+    return 0;
+}
@@ -0,0 +1,340 @@
+#include "workload_generator.h"
+#include "../read_input_functions.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_set>
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+// independent random streams derived from the seed
+enum class Stream : uint64_t {
+    VOCABULARY = 1,
+    DOCUMENT = 2,
+    QUERY = 3,
+};
+
+// SplitMix64, small and with a fixed output sequence
+class Random
+{
+public:
+    Random(uint64_t seed, Stream stream, uint64_t index)
+        : state_(seed)
+    {
+        state_ = Next() ^ static_cast<uint64_t>(stream);
+        state_ = Next() ^ index;
+    }
+
+    uint64_t Next()
+    {
+        uint64_t z = (state_ += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // uniform in [0, 1)
+    double NextDouble()
+    {
+        return static_cast<double>(Next() >> 11) * 0x1.0p-53;
+    }
+
+    // uniform in [min, max]
+    int64_t NextInt(int64_t min, int64_t max)
+    {
+        const uint64_t range = static_cast<uint64_t>(max - min) + 1;
+        return min + static_cast<int64_t>(range == 0 ? Next() : Next() % range);
+    }
+
+    // standard normal, Box-Muller
+    double NextNormal()
+    {
+        const double u = 1.0 - NextDouble();
+        const double v = NextDouble();
+        return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+    }
+
+private:
+    uint64_t state_;
+};
+
+// index of the weight u falls into, u in [0, 1)
+template <typename Weights, typename GetWeight>
+size_t PickWeighted(const Weights &weights, GetWeight get_weight, double u)
+{
+    double total = 0;
+    for (const auto &item : weights)
+    {
+        total += get_weight(item);
+    }
+    double threshold = u * total;
+    size_t index = 0;
+    for (const auto &item : weights)
+    {
+        threshold -= get_weight(item);
+        if (threshold < 0)
+        {
+            return index;
+        }
+        ++index;
+    }
+    return weights.size() - 1;
+}
+
+void CheckOptions(const WorkloadOptions &options)
+{
+    if (options.vocabulary_size == 0 || options.stop_word_count >= options.vocabulary_size)
+    {
+        throw invalid_argument("Vocabulary must be larger than the stop word list"s);
+    }
+    if (options.min_word_length == 0 || options.min_word_length > options.max_word_length)
+    {
+        throw invalid_argument("Invalid word length range"s);
+    }
+    if (options.document_length_median < 1 || options.max_document_length == 0)
+    {
+        throw invalid_argument("Invalid document length distribution"s);
+    }
+    if (options.query_length_mix.empty()
+        || any_of(options.query_length_mix.begin(), options.query_length_mix.end(), [](const auto &item) {
+               return item.first == 0 || item.second < 0;
+           }))
+    {
+        throw invalid_argument("Invalid query length mix"s);
+    }
+    if (options.minus_word_probability < 0 || options.minus_word_probability > 1)
+    {
+        throw invalid_argument("Minus-word probability must be in [0, 1]"s);
+    }
+    if (accumulate(options.status_weights.begin(), options.status_weights.end(), 0.0) <= 0)
+    {
+        throw invalid_argument("Status weights must not all be zero"s);
+    }
+    if (options.min_rating > options.max_rating)
+    {
+        throw invalid_argument("Invalid rating range"s);
+    }
+}
+
+vector<string> GenerateVocabulary(const WorkloadOptions &options)
+{
+    Random random(options.seed, Stream::VOCABULARY, 0);
+    unordered_set<string> seen;
+    vector<string> words;
+    words.reserve(options.vocabulary_size);
+    size_t attempts = 0;
+    while (words.size() < options.vocabulary_size)
+    {
+        if (++attempts > options.vocabulary_size * 100)
+        {
+            throw invalid_argument("Word lengths are too short for the vocabulary size"s);
+        }
+        const auto length = random.NextInt(options.min_word_length, options.max_word_length);
+        string word;
+        word.reserve(length);
+        for (int64_t i = 0; i < length; ++i)
+        {
+            word.push_back(static_cast<char>('a' + random.NextInt(0, 25)));
+        }
+        if (seen.insert(word).second)
+        {
+            words.push_back(move(word));
+        }
+    }
+    // frequent words are short in natural language too
+    stable_sort(words.begin(), words.end(), [](const string &lhs, const string &rhs) {
+        return lhs.size() < rhs.size();
+    });
+    return words;
+}
+
+}
+
+ZipfDistribution::ZipfDistribution(size_t size, double exponent)
+    : cdf_(size)
+{
+    if (size == 0 || exponent < 0)
+    {
+        throw invalid_argument("Zipf distribution needs a positive size and a non-negative exponent"s);
+    }
+    double total = 0;
+    for (size_t rank = 0; rank < size; ++rank)
+    {
+        total += 1.0 / pow(static_cast<double>(rank + 1), exponent);
+        cdf_[rank] = total;
+    }
+    for (double &value : cdf_)
+    {
+        value /= total;
+    }
+    cdf_.back() = 1.0;
+}
+
+size_t ZipfDistribution::operator()(double u) const
+{
+    return min<size_t>(upper_bound(cdf_.begin(), cdf_.end(), u) - cdf_.begin(), cdf_.size() - 1);
+}
+
+size_t ZipfDistribution::GetSize() const
+{
+    return cdf_.size();
+}
+
+double ZipfDistribution::GetProbability(size_t rank) const
+{
+    return rank == 0 ? cdf_[0] : cdf_.at(rank) - cdf_[rank - 1];
+}
+
+WorkloadGenerator::WorkloadGenerator(WorkloadOptions options)
+    : options_((CheckOptions(options), move(options))),
+      vocabulary_(GenerateVocabulary(options_)),
+      document_words_(options_.vocabulary_size, options_.zipf_exponent),
+      query_words_(options_.vocabulary_size, options_.query_zipf_exponent)
+{
+}
+
+const WorkloadOptions &WorkloadGenerator::GetOptions() const
+{
+    return options_;
+}
+
+const vector<string> &WorkloadGenerator::GetVocabulary() const
+{
+    return vocabulary_;
+}
+
+string WorkloadGenerator::GetStopWords() const
+{
+    string stop_words;
+    for (size_t rank = 0; rank < options_.stop_word_count; ++rank)
+    {
+        if (!stop_words.empty())
+        {
+            stop_words.push_back(' ');
+        }
+        stop_words += vocabulary_[rank];
+    }
+    return stop_words;
+}
+
+GeneratedDocument WorkloadGenerator::GenerateDocument(int document_id) const
+{
+    Random random(options_.seed, Stream::DOCUMENT, static_cast<uint64_t>(document_id));
+    GeneratedDocument document;
+    document.id = document_id;
+
+    const double length = options_.document_length_median * exp(options_.document_length_sigma * random.NextNormal());
+    const size_t word_count = clamp<size_t>(llround(length), 1, options_.max_document_length);
+    for (size_t i = 0; i < word_count; ++i)
+    {
+        if (i > 0)
+        {
+            document.text.push_back(' ');
+        }
+        document.text += vocabulary_[document_words_(random.NextDouble())];
+    }
+
+    const auto &weights = options_.status_weights;
+    document.status = static_cast<DocumentStatus>(
+        PickWeighted(weights, [](double weight) { return weight; }, random.NextDouble())
+    );
+    const auto rating_count = random.NextInt(0, options_.max_rating_count);
+    document.ratings.reserve(rating_count);
+    for (int64_t i = 0; i < rating_count; ++i)
+    {
+        document.ratings.push_back(static_cast<int>(random.NextInt(options_.min_rating, options_.max_rating)));
+    }
+    return document;
+}
+
+vector<GeneratedDocument> WorkloadGenerator::GenerateDocuments(size_t count, int first_id) const
+{
+    vector<GeneratedDocument> documents;
+    documents.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        documents.push_back(GenerateDocument(first_id + static_cast<int>(i)));
+    }
+    return documents;
+}
+
+size_t WorkloadGenerator::GetQueryLength(double u) const
+{
+    const auto &mix = options_.query_length_mix;
+    return mix[PickWeighted(mix, [](const auto &item) { return item.second; }, u)].first;
+}
+
+string WorkloadGenerator::GenerateQuery(uint64_t index) const
+{
+    Random random(options_.seed, Stream::QUERY, index);
+    const size_t word_count = GetQueryLength(random.NextDouble());
+    string query;
+    for (size_t i = 0; i < word_count; ++i)
+    {
+        if (i > 0)
+        {
+            query.push_back(' ');
+        }
+        if (random.NextDouble() < options_.minus_word_probability)
+        {
+            query.push_back('-');
+        }
+        query += vocabulary_[query_words_(random.NextDouble())];
+    }
+    return query;
+}
+
+vector<string> WorkloadGenerator::GenerateQueries(size_t count, uint64_t first_index) const
+{
+    vector<string> queries;
+    queries.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        queries.push_back(GenerateQuery(first_index + i));
+    }
+    return queries;
+}
+
+void WriteCorpus(ostream &output, const vector<GeneratedDocument> &documents)
+{
+    for (const GeneratedDocument &document : documents)
+    {
+        output << document.id << ' ' << GetStatusName(document.status) << ' ';
+        if (document.ratings.empty())
+        {
+            output << '-';
+        }
+        for (size_t i = 0; i < document.ratings.size(); ++i)
+        {
+            output << (i > 0 ? ","sv : ""sv) << document.ratings[i];
+        }
+        output << ' ' << document.text << '\n';
+    }
+}
+
+void WriteQueries(ostream &output, const vector<string> &queries)
+{
+    for (const string &query : queries)
+    {
+        output << query << '\n';
+    }
+}
+
+vector<string> ReadQueries(istream &input)
+{
+    vector<string> queries;
+    string line;
+    while (ReadLine(input, line))
+    {
+        if (!line.empty())
+        {
+            queries.push_back(line);
+        }
+    }
+    return queries;
+}
@@ -0,0 +1,105 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "../document.h"
+
+// Word ranks drawn with P(rank) proportional to 1 / (rank + 1)^exponent,
+// so a few words are in most documents and most words are rare.
+class ZipfDistribution
+{
+public:
+    ZipfDistribution(size_t size, double exponent);
+
+    // u is uniform in [0, 1)
+    size_t operator()(double u) const;
+    size_t GetSize() const;
+    // probability of the rank
+    double GetProbability(size_t rank) const;
+
+private:
+    // cumulative probabilities, the last one is 1
+    std::vector<double> cdf_;
+};
+
+struct WorkloadOptions {
+    uint64_t seed = 1;
+
+    size_t vocabulary_size = 20'000;
+    // 1 is close to natural language text
+    double zipf_exponent = 1.0;
+    size_t min_word_length = 2;
+    size_t max_word_length = 12;
+    // the most frequent words, passed to SearchServer as stop words
+    size_t stop_word_count = 10;
+
+    // document lengths in words are log-normal with this median
+    double document_length_median = 60;
+    // standard deviation of the logarithm of the length
+    double document_length_sigma = 0.6;
+    size_t max_document_length = 1'000;
+
+    // weights of the query lengths in words
+    std::vector<std::pair<size_t, double>> query_length_mix = {
+        {1, 0.25}, {2, 0.35}, {3, 0.2}, {4, 0.1}, {6, 0.07}, {10, 0.03}
+    };
+    // probability of a query word to be a minus-word
+    double minus_word_probability = 0.05;
+    // exponent of the query word ranks; queries follow the corpus by default
+    double query_zipf_exponent = 1.0;
+
+    // weights of ACTUAL, IRRELEVANT, BANNED and REMOVED
+    std::array<double, 4> status_weights = {0.85, 0.05, 0.05, 0.05};
+    size_t max_rating_count = 5;
+    int min_rating = -10;
+    int max_rating = 10;
+};
+
+struct GeneratedDocument {
+    int id = 0;
+    std::string text;
+    DocumentStatus status = DocumentStatus::ACTUAL;
+    std::vector<int> ratings;
+};
+
+// Seeded generator of corpora and queries. The same options give the same
+// output on every platform: it uses its own distributions instead of the
+// implementation-defined standard ones. A document depends only on the seed
+// and its id, so corpora of different sizes share their prefix.
+class WorkloadGenerator
+{
+public:
+    explicit WorkloadGenerator(WorkloadOptions options);
+
+    const WorkloadOptions &GetOptions() const;
+    // words ordered by rank, the most frequent first
+    const std::vector<std::string> &GetVocabulary() const;
+    // space separated stop words
+    std::string GetStopWords() const;
+
+    GeneratedDocument GenerateDocument(int document_id) const;
+    // documents with ids [first_id, first_id + count)
+    std::vector<GeneratedDocument> GenerateDocuments(size_t count, int first_id = 0) const;
+    // the index-th query of the query stream
+    std::string GenerateQuery(uint64_t index) const;
+    std::vector<std::string> GenerateQueries(size_t count, uint64_t first_index = 0) const;
+
+private:
+    const WorkloadOptions options_;
+    std::vector<std::string> vocabulary_;
+    ZipfDistribution document_words_;
+    ZipfDistribution query_words_;
+
+    size_t GetQueryLength(double u) const;
+};
+
+// writes the documents in the format read by LoadCorpus
+void WriteCorpus(std::ostream &output, const std::vector<GeneratedDocument> &documents);
+// one query per line
+void WriteQueries(std::ostream &output, const std::vector<std::string> &queries);
+std::vector<std::string> ReadQueries(std::istream &input);
@@ -0,0 +1,13 @@
+# Builds everything without and with optimization and runs the tests.
+# The -O0 build keeps the calls the optimizer folds away, so a static
+# member used without a definition fails to link there.
+set -e
+cd "$(dirname "$0")"
+for OPT in -O0 -O2; do
+    export OPT
+    g++ -std=c++17 $OPT *.cpp -ltbb -lpthread -o check_tests
+    ./check_tests > /dev/null
+    (cd net && sh compile.sh && sh test_replicas.sh)
+    (cd bench && sh compile.sh)
+done
+rm -f check_tests
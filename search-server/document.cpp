@@ -1,5 +1,8 @@
 #include "document.h"
 
+using namespace std;
+using namespace std::literals;
+
 Document::Document() = default;
 
 Document::Document(int id, double relevance, int rating)
@@ -16,3 +19,36 @@ std::ostream& operator<<(
         <<", rating = "<<doc.rating<<" }";
     return os;
 }
+
+std::optional<DocumentStatus> ParseStatus(std::string_view text)
+{
+    for (DocumentStatus status : {
+        DocumentStatus::ACTUAL,
+        DocumentStatus::IRRELEVANT,
+        DocumentStatus::BANNED,
+        DocumentStatus::REMOVED,
+    })
+    {
+        if (GetStatusName(status) == text)
+        {
+            return status;
+        }
+    }
+    return nullopt;
+}
+
+std::string_view GetStatusName(DocumentStatus status)
+{
+    switch (status)
+    {
+    case DocumentStatus::ACTUAL:
+        return "ACTUAL"sv;
+    case DocumentStatus::IRRELEVANT:
+        return "IRRELEVANT"sv;
+    case DocumentStatus::BANNED:
+        return "BANNED"sv;
+    case DocumentStatus::REMOVED:
+        return "REMOVED"sv;
+    }
+    return "UNKNOWN"sv;
+}
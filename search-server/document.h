@@ -1,5 +1,7 @@
 #pragma once
 #include <iostream>
+#include <optional>
+#include <string_view>
 
 
 struct Document {
@@ -18,6 +20,10 @@ enum class DocumentStatus {
     REMOVED,
 };
 
+// ACTUAL, IRRELEVANT, BANNED or REMOVED
+std::string_view GetStatusName(DocumentStatus status);
+std::optional<DocumentStatus> ParseStatus(std::string_view text);
+
 std::ostream& operator<<(
     std::ostream& os,
     const Document& doc
@@ -0,0 +1,116 @@
+#include "forward_index.h"
+#include <algorithm>
+
+using namespace std;
+
+int ForwardIndex::GetTermId(std::string_view word)
+{
+    auto [it, inserted] = term_ids_.emplace(word, static_cast<int>(terms_.size()));
+    if (inserted)
+    {
+        terms_.push_back(word);
+    }
+    return it->second;
+}
+
+int ForwardIndex::FindTermId(std::string_view word) const
+{
+    auto it = term_ids_.find(word);
+    return it == term_ids_.end() ? -1 : it->second;
+}
+
+std::string_view ForwardIndex::GetTerm(int term_id) const
+{
+    return terms_.at(term_id);
+}
+
+size_t ForwardIndex::GetTermCount() const
+{
+    return terms_.size();
+}
+
+void ForwardIndex::Add(int document_id, std::vector<TermFrequency> entries)
+{
+    Remove(document_id);
+    stable_sort(
+        entries.begin(),
+        entries.end(),
+        [](const TermFrequency &lhs, const TermFrequency &rhs) {
+            return lhs.term_id < rhs.term_id;
+        }
+    );
+    const size_t offset = pool_.size();
+    for (const TermFrequency &entry : entries)
+    {
+        if (pool_.size() > offset && pool_.back().term_id == entry.term_id)
+        {
+            pool_.back().term_freq += entry.term_freq;
+        }
+        else
+        {
+            pool_.push_back(entry);
+        }
+    }
+    spans_[document_id] = Span{offset, pool_.size() - offset};
+}
+
+void ForwardIndex::Remove(int document_id)
+{
+    auto it = spans_.find(document_id);
+    if (it == spans_.end())
+    {
+        return;
+    }
+    garbage_ += it->second.size;
+    spans_.erase(it);
+    if (pool_.size() < 2 * garbage_)
+    {
+        Compact();
+    }
+}
+
+void ForwardIndex::Remove(const std::vector<int> &document_ids)
+{
+    for (int document_id : document_ids)
+    {
+        auto it = spans_.find(document_id);
+        if (it != spans_.end())
+        {
+            garbage_ += it->second.size;
+            spans_.erase(it);
+        }
+    }
+    if (pool_.size() < 2 * garbage_)
+    {
+        Compact();
+    }
+}
+
+WordFrequencies ForwardIndex::Get(int document_id) const
+{
+    auto it = spans_.find(document_id);
+    if (it == spans_.end())
+    {
+        return {};
+    }
+    const TermFrequency *begin = pool_.data() + it->second.offset;
+    return {begin, begin + it->second.size, &terms_};
+}
+
+void ForwardIndex::Compact()
+{
+    vector<TermFrequency> pool;
+    pool.reserve(pool_.size() - garbage_);
+    for (auto &[document_id, span] : spans_)
+    {
+        const size_t offset = pool.size();
+        pool.insert(
+            pool.end(),
+            pool_.begin() + span.offset,
+            pool_.begin() + span.offset + span.size
+        );
+        span.offset = offset;
+    }
+    pool_ = move(pool);
+    garbage_ = 0;
+}
@@ -0,0 +1,154 @@
+#pragma once
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// One entry of a document's forward index: a term and its normalized
+// frequency in the document (the same value stored in the posting list).
+struct TermFrequency {
+    int term_id;
+    double term_freq;
+};
+
+// Lightweight read-only view over the (term, tf) entries of one document,
+// sorted by term id. Iteration yields std::pair<std::string_view, double>.
+// The view is invalidated by any change of the ForwardIndex it came from.
+class WordFrequencies
+{
+public:
+    class Iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = std::pair<std::string_view, double>;
+        using difference_type = std::ptrdiff_t;
+        using pointer = void;
+        using reference = value_type;
+
+        Iterator(
+            const TermFrequency *entry,
+            const std::vector<std::string_view> *terms
+        )
+            : entry_(entry), terms_(terms)
+        {
+        }
+
+        value_type operator*() const
+        {
+            return {(*terms_)[entry_->term_id], entry_->term_freq};
+        }
+
+        Iterator &operator++()
+        {
+            ++entry_;
+            return *this;
+        }
+
+        Iterator operator++(int)
+        {
+            Iterator result = *this;
+            ++entry_;
+            return result;
+        }
+
+        bool operator==(const Iterator &other) const
+        {
+            return entry_ == other.entry_;
+        }
+
+        bool operator!=(const Iterator &other) const
+        {
+            return entry_ != other.entry_;
+        }
+
+    private:
+        const TermFrequency *entry_;
+        const std::vector<std::string_view> *terms_;
+    };
+
+    WordFrequencies() = default;
+    WordFrequencies(
+        const TermFrequency *entries_begin,
+        const TermFrequency *entries_end,
+        const std::vector<std::string_view> *terms
+    )
+        : entries_begin_(entries_begin), entries_end_(entries_end), terms_(terms)
+    {
+    }
+
+    Iterator begin() const
+    {
+        return {entries_begin_, terms_};
+    }
+
+    Iterator end() const
+    {
+        return {entries_end_, terms_};
+    }
+
+    size_t size() const
+    {
+        return entries_end_ - entries_begin_;
+    }
+
+    bool empty() const
+    {
+        return entries_begin_ == entries_end_;
+    }
+
+    // raw (term_id, tf) entries, sorted by term_id
+    const TermFrequency *TermsBegin() const
+    {
+        return entries_begin_;
+    }
+
+    const TermFrequency *TermsEnd() const
+    {
+        return entries_end_;
+    }
+
+private:
+    const TermFrequency *entries_begin_ = nullptr;
+    const TermFrequency *entries_end_ = nullptr;
+    const std::vector<std::string_view> *terms_ = nullptr;
+};
+
+// Term dictionary plus per-document (term_id, tf) arrays kept in one
+// shared pool. Removed documents leave holes which are compacted once
+// they outweigh the live entries.
+class ForwardIndex
+{
+public:
+    // returns id of the word, registering it on first use;
+    // the word must outlive the index
+    int GetTermId(std::string_view word);
+    // returns -1 for unknown words
+    int FindTermId(std::string_view word) const;
+    std::string_view GetTerm(int term_id) const;
+    size_t GetTermCount() const;
+
+    // entries may come in any order and contain repeated term ids,
+    // repeated ids are merged by summing their frequencies
+    void Add(int document_id, std::vector<TermFrequency> entries);
+    void Remove(int document_id);
+    // compacts at most once for the whole batch
+    void Remove(const std::vector<int> &document_ids);
+    WordFrequencies Get(int document_id) const;
+
+private:
+    struct Span {
+        size_t offset;
+        size_t size;
+    };
+
+    std::map<std::string_view, int> term_ids_;
+    std::vector<std::string_view> terms_;
+    std::vector<TermFrequency> pool_;
+    std::map<int, Span> spans_;
+    size_t garbage_ = 0;
+
+    void Compact();
+};
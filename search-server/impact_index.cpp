@@ -0,0 +1,283 @@
+#include "impact_index.h"
+#include "search_server.h"
+
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+ImpactIndex::ImpactIndex(
+    ImpactPrecision precision,
+    uint64_t generation,
+    vector<DocumentInfo> documents,
+    map<string, vector<ScoredPosting>, less<>> postings
+)
+    : precision_(precision)
+    , generation_(generation)
+    , documents_(move(documents))
+{
+    const uint32_t max_impact = precision == ImpactPrecision::BITS_8 ? 0xff : 0xffff;
+    double max_score = 0;
+    size_t posting_count = 0;
+    for (const auto &[word, word_postings] : postings)
+    {
+        for (const ScoredPosting &posting : word_postings)
+        {
+            max_score = max(max_score, posting.score);
+        }
+        posting_count += word_postings.size();
+    }
+    quantum_ = max_score > 0 ? max_score / max_impact : 1.0;
+
+    postings_.reserve(posting_count);
+    vector<pair<uint32_t, uint32_t>> impacts;
+    for (const auto &[word, word_postings] : postings)
+    {
+        if (word_postings.empty())
+        {
+            continue;
+        }
+        // a positive score keeps at least the lowest impact
+        impacts.clear();
+        for (const ScoredPosting &posting : word_postings)
+        {
+            const uint32_t impact = posting.score > 0
+                ? clamp<uint32_t>(lround(posting.score / quantum_), 1, max_impact)
+                : 0;
+            impacts.emplace_back(impact, posting.document);
+        }
+        sort(
+            impacts.begin(), impacts.end(),
+            [](const pair<uint32_t, uint32_t> &lhs, const pair<uint32_t, uint32_t> &rhs) {
+                return lhs.first != rhs.first ? lhs.first > rhs.first : lhs.second < rhs.second;
+            }
+        );
+        vector<Segment> segments;
+        for (const auto &[impact, document] : impacts)
+        {
+            if (segments.empty() || segments.back().impact != impact)
+            {
+                const auto position = static_cast<uint32_t>(postings_.size());
+                segments.push_back({impact, position, position});
+            }
+            postings_.push_back(document);
+            ++segments.back().end;
+        }
+        words_.emplace(word, move(segments));
+    }
+}
+
+ImpactPrecision ImpactIndex::GetPrecision() const
+{
+    return precision_;
+}
+
+uint64_t ImpactIndex::GetGeneration() const
+{
+    return generation_;
+}
+
+size_t ImpactIndex::GetPostingCount() const
+{
+    return postings_.size();
+}
+
+vector<ImpactIndex::QuerySegment> ImpactIndex::CollectSegments(const vector<string_view> &words) const
+{
+    vector<QuerySegment> segments;
+    for (auto word = words.begin(); word != words.end(); ++word)
+    {
+        const auto it = words_.find(*word);
+        if (it == words_.end())
+        {
+            continue;
+        }
+        const auto word_index = static_cast<uint32_t>(word - words.begin());
+        const vector<Segment> &word_segments = it->second;
+        for (size_t i = 0; i < word_segments.size(); ++i)
+        {
+            const uint32_t next_impact = i + 1 < word_segments.size() ? word_segments[i + 1].impact : 0;
+            segments.push_back({word_segments[i], word_index, next_impact});
+        }
+    }
+    // stable, so the segments of a word stay in their order
+    stable_sort(
+        segments.begin(), segments.end(),
+        [](const QuerySegment &lhs, const QuerySegment &rhs) {
+            return lhs.segment.impact > rhs.segment.impact;
+        }
+    );
+    return segments;
+}
+
+Document ImpactIndex::ToDocument(uint32_t document, uint32_t score) const
+{
+    const DocumentInfo &info = documents_[document];
+    return Document(info.id, score * quantum_, info.rating);
+}
+
+vector<uint32_t> ImpactIndex::SelectCandidates(const Accumulators &accumulators, size_t result_count) const
+{
+    vector<uint32_t> candidates = accumulators.GetScoredDocuments();
+    const size_t candidate_count = min(result_count, candidates.size());
+    nth_element(
+        candidates.begin(), candidates.begin() + candidate_count, candidates.end(),
+        [&](uint32_t lhs, uint32_t rhs) {
+            return SearchServer::IsMoreRelevant(
+                ToDocument(lhs, accumulators.GetScore(lhs)),
+                ToDocument(rhs, accumulators.GetScore(rhs))
+            );
+        }
+    );
+    candidates.resize(candidate_count);
+    return candidates;
+}
+
+bool ImpactIndex::IsTopFixed(
+    const Accumulators &accumulators,
+    const vector<uint32_t> &word_impacts,
+    size_t result_count
+) const
+{
+    uint32_t remaining_impact = 0;
+    for (uint32_t impact : word_impacts)
+    {
+        remaining_impact += impact;
+    }
+    if (result_count == 0)
+    {
+        return true;
+    }
+    const vector<uint32_t> candidates = SelectCandidates(accumulators, result_count);
+    // documents not scored yet may fill the top, even with no impact
+    if (candidates.size() < result_count)
+    {
+        return false;
+    }
+    const uint32_t *last = &candidates.front();
+    for (const uint32_t &candidate : candidates)
+    {
+        if (SearchServer::IsMoreRelevant(
+                ToDocument(*last, accumulators.GetScore(*last)),
+                ToDocument(candidate, accumulators.GetScore(candidate))))
+        {
+            last = &candidate;
+        }
+    }
+    // the candidates only gain, so the last of them is at least this
+    const Document last_document = ToDocument(*last, accumulators.GetScore(*last));
+    // a document not scored yet may gain every word, its rating and id are
+    // unknown
+    if (last_document.relevance - remaining_impact * quantum_ < EPS)
+    {
+        return false;
+    }
+    for (uint32_t document : accumulators.GetScoredDocuments())
+    {
+        if (find(candidates.begin(), candidates.end(), document) != candidates.end())
+        {
+            continue;
+        }
+        const uint32_t words = accumulators.GetWords(document);
+        uint32_t best_score = accumulators.GetScore(document);
+        for (size_t word = 0; word < word_impacts.size(); ++word)
+        {
+            if (word >= 31 || (words & (1u << word)) == 0)
+            {
+                best_score += word_impacts[word];
+            }
+        }
+        if (!SearchServer::IsMoreRelevant(last_document, ToDocument(document, best_score)))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+vector<Document> ImpactIndex::CompleteCandidates(
+    const Accumulators &accumulators,
+    const vector<QuerySegment> &segments,
+    size_t segments_read,
+    size_t result_count
+) const
+{
+    vector<Document> result;
+    result.reserve(result_count);
+    for (uint32_t document : SelectCandidates(accumulators, result_count))
+    {
+        uint32_t score = accumulators.GetScore(document);
+        for (size_t i = segments_read; i < segments.size(); ++i)
+        {
+            const Segment &segment = segments[i].segment;
+            if (binary_search(postings_.begin() + segment.begin, postings_.begin() + segment.end, document))
+            {
+                score += segment.impact;
+            }
+        }
+        result.push_back(ToDocument(document, score));
+    }
+    sort(result.begin(), result.end(), SearchServer::IsMoreRelevant);
+    return result;
+}
+
+ImpactIndex::Accumulators::Lease::Lease(size_t document_count)
+{
+    static thread_local Accumulators thread_accumulators;
+    accumulators_ = &thread_accumulators;
+    if (thread_accumulators.is_leased_)
+    {
+        own_accumulators_ = make_unique<Accumulators>();
+        accumulators_ = own_accumulators_.get();
+    }
+    accumulators_->is_leased_ = true;
+    accumulators_->Grow(document_count);
+}
+
+ImpactIndex::Accumulators::Lease::~Lease()
+{
+    accumulators_->Clear();
+    accumulators_->is_leased_ = false;
+}
+
+void ImpactIndex::Accumulators::Grow(size_t document_count)
+{
+    if (scores_.size() < document_count)
+    {
+        scores_.resize(document_count);
+        states_.resize(document_count, UNKNOWN);
+        words_.resize(document_count);
+    }
+}
+
+void ImpactIndex::Accumulators::Clear()
+{
+    for (uint32_t document : changed_)
+    {
+        scores_[document] = 0;
+        states_[document] = UNKNOWN;
+        words_[document] = 0;
+    }
+    changed_.clear();
+    documents_.clear();
+}
+
+size_t ImpactIndex::Accumulators::GetScoredCount() const
+{
+    return documents_.size();
+}
+
+const vector<uint32_t> &ImpactIndex::Accumulators::GetScoredDocuments() const
+{
+    return documents_;
+}
+
+uint32_t ImpactIndex::Accumulators::GetScore(uint32_t document) const
+{
+    return scores_[document];
+}
+
+uint32_t ImpactIndex::Accumulators::GetWords(uint32_t document) const
+{
+    return words_[document] & ~SCORED;
+}
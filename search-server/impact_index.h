@@ -0,0 +1,301 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "query_stats.h"
+
+// number of bits of a quantized impact
+enum class ImpactPrecision {
+    BITS_8,
+    BITS_16,
+};
+
+struct ImpactSearchOptions {
+    // stop after reading this many postings and return the best documents
+    // found so far, 0 reads as many as needed
+    size_t max_postings = 0;
+    // receives the work done by the search, nullptr to skip counting
+    QueryStats *stats = nullptr;
+};
+
+// The postings of a server, each holding the score of its document for the
+// word quantized to an integer impact. The postings of a word are grouped
+// by impact, highest first, so a posting is stored as a document position
+// and an impact once per group.
+//
+// A search reads the groups of all query words in decreasing impact and
+// stops as soon as the impacts left cannot change which documents are in
+// the top, then completes the scores of those documents by binary search in
+// the groups left. The result is the top of an exhaustive search over the
+// quantized scores.
+class ImpactIndex
+{
+public:
+    struct DocumentInfo {
+        int id;
+        DocumentStatus status;
+        int rating;
+    };
+    struct ScoredPosting {
+        // position in the documents
+        uint32_t document;
+        double score;
+    };
+
+    // Quantizes the scores relative to the highest one. generation is the
+    // generation of the server the postings come from.
+    ImpactIndex(
+        ImpactPrecision precision,
+        uint64_t generation,
+        std::vector<DocumentInfo> documents,
+        std::map<std::string, std::vector<ScoredPosting>, std::less<>> postings
+    );
+
+    ImpactPrecision GetPrecision() const;
+    uint64_t GetGeneration() const;
+    // number of postings of all words
+    size_t GetPostingCount() const;
+
+    // the result_count best documents satisfying the predicate, in the
+    // order of SearchServer::IsMoreRelevant
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(
+        const std::vector<std::string_view> &plus_words,
+        const std::vector<std::string_view> &minus_words,
+        DocumentPredicate document_predicate,
+        size_t result_count,
+        const ImpactSearchOptions &options
+    ) const;
+
+private:
+    // postings of one word with the same impact
+    struct Segment {
+        uint32_t impact;
+        // range in postings_, sorted by document
+        uint32_t begin;
+        uint32_t end;
+    };
+    struct QuerySegment {
+        Segment segment;
+        // position of the word in the query
+        uint32_t word;
+        // the impact of the next segment of the same word, 0 for the last
+        uint32_t next_impact;
+    };
+
+    // Scores of one search by document position, with the query words
+    // each document was scored for. Documents are accepted or rejected
+    // once, rejected ones are never scored. The arrays are kept by the
+    // thread between searches, and a search resets only the entries it
+    // changed, so it costs nothing per document it does not reach.
+    class Accumulators
+    {
+    public:
+        // The accumulators of the calling thread, grown to document_count
+        // and left clean when the lease ends. A search started from the
+        // predicate of another one on the same thread gets its own.
+        class Lease
+        {
+        public:
+            explicit Lease(size_t document_count);
+            ~Lease();
+
+            Lease(const Lease &) = delete;
+            Lease &operator=(const Lease &) = delete;
+
+            Accumulators &operator*() const
+            {
+                return *accumulators_;
+            }
+
+        private:
+            std::unique_ptr<Accumulators> own_accumulators_;
+            Accumulators *accumulators_;
+        };
+
+        static constexpr uint32_t SCORED = 1u << 31;
+
+        enum State : uint8_t {
+            UNKNOWN,
+            ACCEPTED,
+            REJECTED,
+        };
+
+        State GetState(uint32_t document) const
+        {
+            return states_[document];
+        }
+        void SetState(uint32_t document, State state)
+        {
+            if (states_[document] == UNKNOWN)
+            {
+                changed_.push_back(document);
+            }
+            states_[document] = state;
+        }
+        void Add(uint32_t document, uint32_t impact, uint32_t word)
+        {
+            if (words_[document] == 0)
+            {
+                documents_.push_back(document);
+            }
+            // words past the first 31 are not tracked and count as not
+            // scored for
+            words_[document] |= SCORED | (word < 31 ? 1u << word : 0);
+            scores_[document] += impact;
+        }
+
+        size_t GetScoredCount() const;
+        // documents with a score, in the order they were first scored
+        const std::vector<uint32_t> &GetScoredDocuments() const;
+        uint32_t GetScore(uint32_t document) const;
+        // bit i is set if the document was scored for the word i < 31
+        uint32_t GetWords(uint32_t document) const;
+
+    private:
+        std::vector<uint32_t> scores_;
+        std::vector<State> states_;
+        std::vector<uint32_t> words_;
+        std::vector<uint32_t> documents_;
+        // documents whose state was set, a superset of documents_
+        std::vector<uint32_t> changed_;
+        bool is_leased_ = false;
+
+        void Grow(size_t document_count);
+        // resets the changed entries
+        void Clear();
+    };
+
+    ImpactPrecision precision_;
+    uint64_t generation_;
+    // relevance of one unit of impact
+    double quantum_ = 0;
+    std::vector<DocumentInfo> documents_;
+    std::vector<uint32_t> postings_;
+    // segments of every word, highest impact first
+    std::map<std::string, std::vector<Segment>, std::less<>> words_;
+
+    // the segments of the words, highest impact first
+    std::vector<QuerySegment> CollectSegments(const std::vector<std::string_view> &words) const;
+    Document ToDocument(uint32_t document, uint32_t score) const;
+    // the best result_count documents by score so far, in no order
+    std::vector<uint32_t> SelectCandidates(const Accumulators &accumulators, size_t result_count) const;
+    // True if no document outside the best result_count can enter them.
+    // word_impacts are the impacts of the next segments of the words, a
+    // document can gain the ones of the words it was not scored for.
+    bool IsTopFixed(
+        const Accumulators &accumulators,
+        const std::vector<uint32_t> &word_impacts,
+        size_t result_count
+    ) const;
+    // completes the scores of the candidates from the segments not read
+    // and orders them
+    std::vector<Document> CompleteCandidates(
+        const Accumulators &accumulators,
+        const std::vector<QuerySegment> &segments,
+        size_t segments_read,
+        size_t result_count
+    ) const;
+};
+
+template <typename DocumentPredicate>
+std::vector<Document> ImpactIndex::FindTopDocuments(
+    const std::vector<std::string_view> &plus_words,
+    const std::vector<std::string_view> &minus_words,
+    DocumentPredicate document_predicate,
+    size_t result_count,
+    const ImpactSearchOptions &options
+) const
+{
+    const Accumulators::Lease lease(documents_.size());
+    Accumulators &accumulators = *lease;
+    uint64_t terms_resolved = 0;
+    uint64_t predicate_evaluations = 0;
+    for (std::string_view word : minus_words)
+    {
+        const auto it = words_.find(word);
+        if (it == words_.end())
+        {
+            continue;
+        }
+        ++terms_resolved;
+        for (const Segment &segment : it->second)
+        {
+            for (uint32_t i = segment.begin; i < segment.end; ++i)
+            {
+                accumulators.SetState(postings_[i], Accumulators::REJECTED);
+            }
+        }
+    }
+
+    const std::vector<QuerySegment> segments = CollectSegments(plus_words);
+    // the impacts of the next segments of the words
+    std::vector<uint32_t> word_impacts(plus_words.size());
+    for (size_t i = 0; i < plus_words.size(); ++i)
+    {
+        const auto it = words_.find(plus_words[i]);
+        if (it != words_.end())
+        {
+            ++terms_resolved;
+            word_impacts[i] = it->second.front().impact;
+        }
+    }
+
+    uint64_t postings_scanned = 0;
+    // checking the top costs a pass over the scored documents, so it is
+    // done once per as many postings
+    uint64_t next_check = 0;
+    size_t segments_read = 0;
+    while (segments_read < segments.size())
+    {
+        if (options.max_postings > 0 && postings_scanned >= options.max_postings)
+        {
+            break;
+        }
+        const auto &[segment, word, next_impact] = segments[segments_read++];
+        for (uint32_t i = segment.begin; i < segment.end; ++i)
+        {
+            const uint32_t document = postings_[i];
+            auto state = accumulators.GetState(document);
+            if (state == Accumulators::UNKNOWN)
+            {
+                const DocumentInfo &info = documents_[document];
+                ++predicate_evaluations;
+                state = document_predicate(info.id, info.status, info.rating)
+                    ? Accumulators::ACCEPTED
+                    : Accumulators::REJECTED;
+                accumulators.SetState(document, state);
+            }
+            if (state == Accumulators::ACCEPTED)
+            {
+                accumulators.Add(document, segment.impact, word);
+            }
+        }
+        postings_scanned += segment.end - segment.begin;
+        word_impacts[word] = next_impact;
+        if (postings_scanned >= next_check)
+        {
+            if (IsTopFixed(accumulators, word_impacts, result_count))
+            {
+                break;
+            }
+            next_check = postings_scanned + accumulators.GetScoredCount();
+        }
+    }
+
+    if (options.stats)
+    {
+        options.stats->terms_resolved += terms_resolved;
+        options.stats->postings_scanned += postings_scanned;
+        options.stats->predicate_evaluations += predicate_evaluations;
+        options.stats->documents_scored += accumulators.GetScoredCount();
+    }
+    return CompleteCandidates(accumulators, segments, segments_read, result_count);
+}
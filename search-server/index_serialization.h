@@ -0,0 +1,93 @@
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Appends values to a byte string in the layout of this machine, for an
+// index read back by IndexReader on a machine of the same kind.
+class IndexWriter
+{
+public:
+    explicit IndexWriter(std::string &output)
+        : output_(output)
+    {
+    }
+
+    template <typename T>
+    void Write(T value)
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        output_.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+
+    // the length, then the bytes
+    void WriteString(std::string_view text)
+    {
+        Write<uint64_t>(text.size());
+        output_.append(text);
+    }
+
+private:
+    std::string &output_;
+};
+
+// Reads the values written by IndexWriter, throwing invalid_argument
+// instead of reading past the end.
+class IndexReader
+{
+public:
+    explicit IndexReader(std::string_view data)
+        : data_(data)
+    {
+    }
+
+    template <typename T>
+    T Read()
+    {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T value;
+        std::memcpy(&value, Take(sizeof(value)).data(), sizeof(value));
+        return value;
+    }
+
+    // valid while the data is
+    std::string_view ReadString()
+    {
+        return Take(Read<uint64_t>());
+    }
+
+    // a count of items of at least min_item_size bytes each, checked
+    // against the bytes left so that a corrupt count does not reserve
+    // memory for nothing
+    size_t ReadCount(size_t min_item_size)
+    {
+        const uint64_t count = Read<uint64_t>();
+        if (count > data_.size() / min_item_size)
+        {
+            throw std::invalid_argument("Truncated index");
+        }
+        return count;
+    }
+
+    bool IsAtEnd() const
+    {
+        return data_.empty();
+    }
+
+private:
+    std::string_view data_;
+
+    std::string_view Take(size_t size)
+    {
+        if (size > data_.size())
+        {
+            throw std::invalid_argument("Truncated index");
+        }
+        const std::string_view bytes = data_.substr(0, size);
+        data_.remove_prefix(size);
+        return bytes;
+    }
+};
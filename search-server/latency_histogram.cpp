@@ -0,0 +1,241 @@
+#include "latency_histogram.h"
+#include <atomic>
+#include <cmath>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+// histograms written by one thread and read by the mergers
+struct ThreadHistograms {
+    array<array<atomic<uint64_t>, LatencyHistogram::BUCKET_COUNT>, LATENCY_OPERATION_COUNT> counts{};
+};
+
+// Histograms outlive their threads so the durations they recorded stay
+// counted; the histograms of a finished thread go to the next new one.
+struct Registry {
+    mutex mx;
+    vector<unique_ptr<ThreadHistograms>> all;
+    vector<ThreadHistograms *> free;
+};
+
+Registry &GetRegistry()
+{
+    // never destroyed, threads may record while static objects are destroyed
+    static Registry *registry = new Registry;
+    return *registry;
+}
+
+struct ThreadHistogramsHolder {
+    ThreadHistograms *histograms;
+
+    ThreadHistogramsHolder()
+    {
+        Registry &registry = GetRegistry();
+        lock_guard guard(registry.mx);
+        if (registry.free.empty())
+        {
+            registry.all.push_back(make_unique<ThreadHistograms>());
+            histograms = registry.all.back().get();
+        }
+        else
+        {
+            histograms = registry.free.back();
+            registry.free.pop_back();
+        }
+    }
+
+    ~ThreadHistogramsHolder()
+    {
+        Registry &registry = GetRegistry();
+        lock_guard guard(registry.mx);
+        registry.free.push_back(histograms);
+    }
+};
+
+ThreadHistograms &GetThreadHistograms()
+{
+    thread_local ThreadHistogramsHolder holder;
+    return *holder.histograms;
+}
+
+}
+
+std::string_view GetLatencyOperationName(LatencyOperation operation)
+{
+    switch (operation)
+    {
+    case LatencyOperation::FIND_TOP_DOCUMENTS:
+        return "FindTopDocuments"sv;
+    case LatencyOperation::MATCH_DOCUMENT:
+        return "MatchDocument"sv;
+    case LatencyOperation::ADD_DOCUMENT:
+        return "AddDocument"sv;
+    case LatencyOperation::REMOVE_DOCUMENT:
+        return "RemoveDocument"sv;
+    case LatencyOperation::PROCESS_QUERIES:
+        return "ProcessQueries"sv;
+    }
+    return "Unknown"sv;
+}
+
+void LatencyHistogram::Record(std::chrono::nanoseconds duration, uint64_t count)
+{
+    const uint64_t value = duration.count() < 0 ? 0 : duration.count();
+    counts_[GetBucketIndex(value)] += count;
+    total_count_ += count;
+}
+
+void LatencyHistogram::Merge(const LatencyHistogram &other)
+{
+    for (size_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        counts_[i] += other.counts_[i];
+    }
+    total_count_ += other.total_count_;
+}
+
+uint64_t LatencyHistogram::GetCount() const
+{
+    return total_count_;
+}
+
+std::chrono::nanoseconds LatencyHistogram::GetPercentile(double percentile) const
+{
+    if (total_count_ == 0)
+    {
+        return 0ns;
+    }
+    const double rank = ceil(min(100.0, max(0.0, percentile)) / 100.0 * total_count_);
+    const uint64_t target = max<uint64_t>(1, static_cast<uint64_t>(rank));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT; ++i)
+    {
+        seen += counts_[i];
+        if (seen >= target)
+        {
+            return chrono::nanoseconds(GetBucketMaxValue(i));
+        }
+    }
+    return GetMax();
+}
+
+std::chrono::nanoseconds LatencyHistogram::GetMax() const
+{
+    for (size_t i = BUCKET_COUNT; i > 0; --i)
+    {
+        if (counts_[i - 1] > 0)
+        {
+            return chrono::nanoseconds(GetBucketMaxValue(i - 1));
+        }
+    }
+    return 0ns;
+}
+
+size_t LatencyHistogram::GetBucketIndex(uint64_t value)
+{
+    const uint64_t sub_bucket_count = uint64_t{1} << SUB_BUCKET_BITS;
+    value = min(value, (uint64_t{1} << MAX_VALUE_BITS) - 1);
+    if (value < 2 * sub_bucket_count)
+    {
+        return value;
+    }
+    // values with the highest bit at 2^(shift + SUB_BUCKET_BITS) keep
+    // SUB_BUCKET_BITS bits below it
+    const int highest_bit = 63 - __builtin_clzll(value);
+    const int shift = highest_bit - SUB_BUCKET_BITS;
+    return (static_cast<size_t>(shift) << SUB_BUCKET_BITS) + (value >> shift);
+}
+
+uint64_t LatencyHistogram::GetBucketMaxValue(size_t bucket_index)
+{
+    const size_t sub_bucket_count = size_t{1} << SUB_BUCKET_BITS;
+    if (bucket_index < 2 * sub_bucket_count)
+    {
+        return bucket_index;
+    }
+    const int shift = static_cast<int>(bucket_index >> SUB_BUCKET_BITS) - 1;
+    const uint64_t sub_bucket = bucket_index - (static_cast<size_t>(shift) << SUB_BUCKET_BITS);
+    return ((sub_bucket + 1) << shift) - 1;
+}
+
+uint64_t LatencyHistogram::GetBucketCount(size_t bucket_index) const
+{
+    return counts_.at(bucket_index);
+}
+
+std::ostream &operator<<(std::ostream &os, const LatencyHistogram &histogram)
+{
+    os << "{ count = "s << histogram.GetCount()
+       << ", p50 = "s << histogram.GetPercentile(50).count()
+       << " ns, p90 = "s << histogram.GetPercentile(90).count()
+       << " ns, p99 = "s << histogram.GetPercentile(99).count()
+       << " ns, p999 = "s << histogram.GetPercentile(99.9).count()
+       << " ns, max = "s << histogram.GetMax().count() << " ns }"s;
+    return os;
+}
+
+void RecordLatency(LatencyOperation operation, std::chrono::nanoseconds duration)
+{
+    const uint64_t value = duration.count() < 0 ? 0 : duration.count();
+    atomic<uint64_t> &count = GetThreadHistograms()
+        .counts[static_cast<size_t>(operation)][LatencyHistogram::GetBucketIndex(value)];
+    // only this thread writes the counter, a plain increment is enough
+    count.store(count.load(memory_order_relaxed) + 1, memory_order_relaxed);
+}
+
+LatencyHistogram GetLatencyHistogram(LatencyOperation operation)
+{
+    LatencyHistogram histogram;
+    Registry &registry = GetRegistry();
+    lock_guard guard(registry.mx);
+    for (const auto &thread_histograms : registry.all)
+    {
+        const auto &counts = thread_histograms->counts[static_cast<size_t>(operation)];
+        for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i)
+        {
+            const uint64_t count = counts[i].load(memory_order_relaxed);
+            if (count > 0)
+            {
+                histogram.Record(
+                    chrono::nanoseconds(LatencyHistogram::GetBucketMaxValue(i)),
+                    count
+                );
+            }
+        }
+    }
+    return histogram;
+}
+
+void ResetLatencyHistograms()
+{
+    Registry &registry = GetRegistry();
+    lock_guard guard(registry.mx);
+    for (const auto &thread_histograms : registry.all)
+    {
+        for (auto &counts : thread_histograms->counts)
+        {
+            for (auto &count : counts)
+            {
+                count.store(0, memory_order_relaxed);
+            }
+        }
+    }
+}
+
+void PrintLatencyHistograms(std::ostream &os)
+{
+    for (size_t i = 0; i < LATENCY_OPERATION_COUNT; ++i)
+    {
+        const auto operation = static_cast<LatencyOperation>(i);
+        const LatencyHistogram histogram = GetLatencyHistogram(operation);
+        if (histogram.GetCount() > 0)
+        {
+            os << GetLatencyOperationName(operation) << ": "s << histogram << endl;
+        }
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+
+// operations of the server whose latency is recorded
+enum class LatencyOperation {
+    FIND_TOP_DOCUMENTS,
+    MATCH_DOCUMENT,
+    ADD_DOCUMENT,
+    REMOVE_DOCUMENT,
+    PROCESS_QUERIES,
+};
+const size_t LATENCY_OPERATION_COUNT = 5;
+
+std::string_view GetLatencyOperationName(LatencyOperation operation);
+
+// Log-linear histogram of durations in nanoseconds. Every power of two is
+// split into 32 equal buckets, so a recorded value is known within about
+// 3% over the whole range. Durations of 2^40 ns (about 18 minutes) and
+// more are counted in the last bucket.
+class LatencyHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 5;
+    static const int MAX_VALUE_BITS = 40;
+    static const size_t BUCKET_COUNT =
+        (MAX_VALUE_BITS - SUB_BUCKET_BITS + 1) << SUB_BUCKET_BITS;
+
+    void Record(std::chrono::nanoseconds duration, uint64_t count = 1);
+    void Merge(const LatencyHistogram &other);
+
+    uint64_t GetCount() const;
+    // the largest duration the bucket holding the given percentile of the
+    // recorded durations may contain, 0 if nothing was recorded
+    std::chrono::nanoseconds GetPercentile(double percentile) const;
+    std::chrono::nanoseconds GetMax() const;
+
+    static size_t GetBucketIndex(uint64_t value);
+    // the largest value counted in the bucket
+    static uint64_t GetBucketMaxValue(size_t bucket_index);
+
+    uint64_t GetBucketCount(size_t bucket_index) const;
+
+private:
+    std::array<uint64_t, BUCKET_COUNT> counts_{};
+    uint64_t total_count_ = 0;
+};
+
+// { count = ..., p50 = ... ns, p90 = ..., p99 = ..., p999 = ..., max = ... }
+std::ostream &operator<<(std::ostream &os, const LatencyHistogram &histogram);
+
+// Records a duration into the histogram of the calling thread. Recording
+// takes no lock; the histograms of all threads are merged when read.
+void RecordLatency(LatencyOperation operation, std::chrono::nanoseconds duration);
+// histogram of the operation merged over all threads
+LatencyHistogram GetLatencyHistogram(LatencyOperation operation);
+void ResetLatencyHistograms();
+// One line per operation with recorded durations. The test program prints
+// them to stderr only when built with SEARCH_SERVER_LATENCY_REPORT defined.
+void PrintLatencyHistograms(std::ostream &os);
+
+// records the lifetime of the scope as the latency of the operation
+class LatencyScope
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit LatencyScope(LatencyOperation operation)
+        : operation_(operation) {}
+
+    ~LatencyScope()
+    {
+        RecordLatency(operation_, Clock::now() - start_time_);
+    }
+
+    LatencyScope(const LatencyScope &) = delete;
+    LatencyScope &operator=(const LatencyScope &) = delete;
+
+private:
+    const LatencyOperation operation_;
+    const Clock::time_point start_time_ = Clock::now();
+};
@@ -1,14 +1,92 @@
 #pragma once
 
+#include <atomic>
 #include <chrono>
 #include <iostream>
+#include <optional>
+#include <string>
+#include <string_view>
+
+#include "latency_histogram.h"
+#include "perf_counters.h"
 
 #define PROFILE_CONCAT_INTERNAL(X, Y) X##Y
 #define PROFILE_CONCAT(X, Y) PROFILE_CONCAT_INTERNAL(X, Y)
 #define UNIQUE_VAR_NAME_PROFILE PROFILE_CONCAT(profileGuard, __LINE__)
+// reports to the sink selected with SetDefaultDurationSink, std::cerr by default
 #define LOG_DURATION(x) LogDuration UNIQUE_VAR_NAME_PROFILE(x)
 
 #define LOG_DURATION_STREAM(x, y) LogDuration UNIQUE_VAR_NAME_PROFILE(x, y)
+#define LOG_DURATION_SINK(x, sink) LogDuration UNIQUE_VAR_NAME_PROFILE(x, sink)
+// records into the thread-local latency histogram of the operation
+#define LOG_LATENCY(operation) LatencyScope UNIQUE_VAR_NAME_PROFILE(operation)
+// adds the hardware event counts of the scope to a PerfCounts
+#define LOG_PERF(counts) PerfScope UNIQUE_VAR_NAME_PROFILE(counts)
+
+// receives the durations measured by LogDuration
+class DurationSink
+{
+public:
+    virtual ~DurationSink() = default;
+    virtual void Report(std::string_view id, std::chrono::nanoseconds duration) = 0;
+};
+
+// writes "<id>: <duration> ns" lines to a stream
+class StreamDurationSink : public DurationSink
+{
+public:
+    explicit StreamDurationSink(std::ostream &os)
+        : os_(os) {}
+
+    void Report(std::string_view id, std::chrono::nanoseconds duration) override
+    {
+        using namespace std::literals;
+        os_ << id << ": "s << duration.count() << " ns"s << std::endl;
+    }
+
+private:
+    std::ostream &os_;
+};
+
+// records the durations into the latency histogram of an operation
+class LatencyDurationSink : public DurationSink
+{
+public:
+    explicit LatencyDurationSink(LatencyOperation operation)
+        : operation_(operation) {}
+
+    void Report(std::string_view, std::chrono::nanoseconds duration) override
+    {
+        RecordLatency(operation_, duration);
+    }
+
+private:
+    const LatencyOperation operation_;
+};
+
+class NullDurationSink : public DurationSink
+{
+public:
+    void Report(std::string_view, std::chrono::nanoseconds) override {}
+};
+
+inline std::atomic<DurationSink *> &DefaultDurationSinkSlot()
+{
+    static StreamDurationSink cerr_sink(std::cerr);
+    static std::atomic<DurationSink *> sink{&cerr_sink};
+    return sink;
+}
+
+// the sink must outlive the LOG_DURATION scopes reporting to it
+inline void SetDefaultDurationSink(DurationSink &sink)
+{
+    DefaultDurationSinkSlot() = &sink;
+}
+
+inline DurationSink &GetDefaultDurationSink()
+{
+    return *DefaultDurationSinkSlot().load();
+}
 
 class LogDuration
 {
@@ -17,25 +95,27 @@ public:
     // с помощью using для удобства
     using Clock = std::chrono::steady_clock;
 
-    LogDuration(const std::string &id, std::ostream &os = std::cerr)
-        : id_(id), os_(os) {}
+    explicit LogDuration(std::string_view id)
+        : LogDuration(id, GetDefaultDurationSink()) {}
 
-    LogDuration(std::string_view id, std::ostream &os = std::cerr)
-        : id_(std::string(id)), os_(os) {}
+    LogDuration(std::string_view id, std::ostream &os)
+        : id_(id), stream_sink_(std::in_place, os), sink_(*stream_sink_) {}
+
+    LogDuration(std::string_view id, DurationSink &sink)
+        : id_(id), sink_(sink) {}
 
     ~LogDuration()
     {
-        using namespace std::chrono;
-        using namespace std::literals;
-
         const auto end_time = Clock::now();
-        const auto dur = end_time - start_time_;
-        //os_ << id_ << ": "s << duration_cast<milliseconds>(dur).count() << " ms"s << std::endl;
-        os_ << id_ << ": "s << duration_cast<nanoseconds>(dur).count() << " ns"s << std::endl;
+        sink_.Report(id_, end_time - start_time_);
     }
 
+    LogDuration(const LogDuration &) = delete;
+    LogDuration &operator=(const LogDuration &) = delete;
+
 private:
     const std::string id_;
+    std::optional<StreamDurationSink> stream_sink_;
+    DurationSink &sink_;
     const Clock::time_point start_time_ = Clock::now();
-    std::ostream &os_;
 };
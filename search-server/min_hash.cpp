@@ -0,0 +1,95 @@
+#include "min_hash.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+// finalizer of MurmurHash3
+uint64_t Mix(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+}
+
+MinHashSketch ComputeMinHashSketch(const WordFrequencies &word_frequencies, size_t hash_count)
+{
+    MinHashSketch sketch(hash_count, numeric_limits<uint32_t>::max());
+    for (const TermFrequency *entry = word_frequencies.TermsBegin(); entry != word_frequencies.TermsEnd(); ++entry)
+    {
+        // hash i is first + i * step, so one 64-bit hash per term serves
+        // all the hash functions
+        const uint64_t hash = Mix(static_cast<uint32_t>(entry->term_id) + 0x9e3779b97f4a7c15ULL);
+        const auto first = static_cast<uint32_t>(hash);
+        const auto step = static_cast<uint32_t>(hash >> 32) | 1u;
+        uint32_t value = first;
+        for (uint32_t &min_value : sketch)
+        {
+            // a bijective scramble breaks the linearity of the family
+            uint32_t scrambled = value * 0x9e3779b1u;
+            scrambled ^= scrambled >> 16;
+            min_value = min(min_value, scrambled);
+            value += step;
+        }
+    }
+    return sketch;
+}
+
+double EstimateJaccard(const MinHashSketch &lhs, const MinHashSketch &rhs)
+{
+    if (lhs.size() != rhs.size())
+    {
+        throw invalid_argument("Sketches of different sizes"s);
+    }
+    if (lhs.empty())
+    {
+        return 1;
+    }
+    size_t equal_count = 0;
+    for (size_t i = 0; i < lhs.size(); ++i)
+    {
+        equal_count += lhs[i] == rhs[i];
+    }
+    return static_cast<double>(equal_count) / lhs.size();
+}
+
+double ComputeJaccard(const WordFrequencies &lhs, const WordFrequencies &rhs)
+{
+    if (lhs.empty() && rhs.empty())
+    {
+        return 1;
+    }
+    // both are sorted by term id
+    size_t common_count = 0;
+    const TermFrequency *left = lhs.TermsBegin();
+    const TermFrequency *right = rhs.TermsBegin();
+    while (left != lhs.TermsEnd() && right != rhs.TermsEnd())
+    {
+        if (left->term_id < right->term_id)
+        {
+            ++left;
+        }
+        else if (right->term_id < left->term_id)
+        {
+            ++right;
+        }
+        else
+        {
+            ++common_count;
+            ++left;
+            ++right;
+        }
+    }
+    return static_cast<double>(common_count) / (lhs.size() + rhs.size() - common_count);
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "forward_index.h"
+
+// MinHash sketch of the term set of a document: for each of the hash
+// functions, the smallest hash of the document's term ids. The share of
+// equal values in two sketches estimates the Jaccard similarity of the
+// term sets. Term ids are local to an index, so sketches of different
+// indexes cannot be compared.
+using MinHashSketch = std::vector<uint32_t>;
+
+MinHashSketch ComputeMinHashSketch(const WordFrequencies &word_frequencies, size_t hash_count);
+// sketches must have the same size
+double EstimateJaccard(const MinHashSketch &lhs, const MinHashSketch &rhs);
+// exact Jaccard similarity of the term sets, 1 for two empty sets
+double ComputeJaccard(const WordFrequencies &lhs, const WordFrequencies &rhs);
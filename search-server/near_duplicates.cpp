@@ -0,0 +1,314 @@
+#include "near_duplicates.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <execution>
+#include <stdexcept>
+#include <string>
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+uint64_t Mix(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+// sketches of the documents in id order, borrowed from the server when it
+// keeps them
+class Sketches
+{
+public:
+    Sketches(const SearchServer &search_server, const vector<int> &document_ids)
+    {
+        sketches_.resize(document_ids.size());
+        if (search_server.GetMinHashSize() > 0)
+        {
+            for (size_t i = 0; i < document_ids.size(); ++i)
+            {
+                sketches_[i] = &search_server.GetMinHashSketch(document_ids[i]);
+            }
+            hash_count_ = search_server.GetMinHashSize();
+            return;
+        }
+        computed_.resize(document_ids.size());
+        transform(
+            execution::par,
+            document_ids.begin(), document_ids.end(),
+            computed_.begin(),
+            [&search_server](int document_id) {
+                return ComputeMinHashSketch(search_server.GetWordFrequencies(document_id), DEFAULT_MIN_HASH_SIZE);
+            }
+        );
+        for (size_t i = 0; i < computed_.size(); ++i)
+        {
+            sketches_[i] = &computed_[i];
+        }
+        hash_count_ = DEFAULT_MIN_HASH_SIZE;
+    }
+
+    size_t GetHashCount() const
+    {
+        return hash_count_;
+    }
+
+    const MinHashSketch &operator[](size_t index) const
+    {
+        return *sketches_[index];
+    }
+
+private:
+    vector<MinHashSketch> computed_;
+    vector<const MinHashSketch *> sketches_;
+    size_t hash_count_ = 0;
+};
+
+// Documents with equal term sets, whose sketches and similarities to all
+// other documents are equal too. Groups hold document indexes in ascending
+// order and are ordered by their first one.
+vector<vector<uint32_t>> GroupEqualTermSets(const SearchServer &search_server, const vector<int> &document_ids)
+{
+    vector<pair<uint64_t, uint32_t>> keys(document_ids.size());
+    transform(
+        execution::par,
+        document_ids.begin(), document_ids.end(),
+        keys.begin(),
+        [&](const int &document_id) {
+            const WordFrequencies word_frequencies = search_server.GetWordFrequencies(document_id);
+            uint64_t key = word_frequencies.size();
+            for (const TermFrequency *term = word_frequencies.TermsBegin(); term != word_frequencies.TermsEnd(); ++term)
+            {
+                key = Mix(key ^ static_cast<uint32_t>(term->term_id));
+            }
+            return pair{key, static_cast<uint32_t>(&document_id - document_ids.data())};
+        }
+    );
+    sort(execution::par, keys.begin(), keys.end());
+    const auto is_equal = [&](uint32_t lhs, uint32_t rhs) {
+        const WordFrequencies lhs_words = search_server.GetWordFrequencies(document_ids[lhs]);
+        const WordFrequencies rhs_words = search_server.GetWordFrequencies(document_ids[rhs]);
+        return equal(
+            lhs_words.TermsBegin(), lhs_words.TermsEnd(),
+            rhs_words.TermsBegin(), rhs_words.TermsEnd(),
+            [](const TermFrequency &lhs_term, const TermFrequency &rhs_term) {
+                return lhs_term.term_id == rhs_term.term_id;
+            }
+        );
+    };
+    vector<vector<uint32_t>> groups;
+    for (size_t run_begin = 0; run_begin < keys.size();)
+    {
+        size_t run_end = run_begin + 1;
+        while (run_end < keys.size() && keys[run_end].first == keys[run_begin].first)
+        {
+            ++run_end;
+        }
+        // the groups of the run, a run holds more than one on a key collision
+        const size_t first_group = groups.size();
+        for (size_t i = run_begin; i < run_end; ++i)
+        {
+            const uint32_t document = keys[i].second;
+            auto group = groups.begin() + first_group;
+            while (group != groups.end() && !is_equal(group->front(), document))
+            {
+                ++group;
+            }
+            if (group == groups.end())
+            {
+                groups.push_back({document});
+            }
+            else
+            {
+                group->push_back(document);
+            }
+        }
+        run_begin = run_end;
+    }
+    sort(groups.begin(), groups.end());
+    return groups;
+}
+
+// Candidate pairs of group indexes, lhs < rhs: every two groups whose first
+// documents share a bucket in some band. Copies of a document form one
+// group, so a bucket of spam costs work linear in its copies.
+vector<pair<uint32_t, uint32_t>> FindCandidates(
+    const Sketches &sketches,
+    const vector<vector<uint32_t>> &groups,
+    LshBanding banding
+)
+{
+    vector<pair<uint32_t, uint32_t>> candidates;
+    vector<pair<uint64_t, uint32_t>> keys(groups.size());
+    for (size_t band = 0; band < banding.band_count; ++band)
+    {
+        const size_t first_row = band * banding.rows_per_band;
+        for (size_t i = 0; i < groups.size(); ++i)
+        {
+            const MinHashSketch &sketch = sketches[groups[i].front()];
+            uint64_t key = band;
+            for (size_t row = first_row; row < first_row + banding.rows_per_band; ++row)
+            {
+                key = Mix(key ^ sketch[row]) + row;
+            }
+            keys[i] = {key, static_cast<uint32_t>(i)};
+        }
+        sort(execution::par, keys.begin(), keys.end());
+        for (size_t run_begin = 0; run_begin < keys.size();)
+        {
+            size_t run_end = run_begin + 1;
+            while (run_end < keys.size() && keys[run_end].first == keys[run_begin].first)
+            {
+                ++run_end;
+            }
+            // sorted by group within the run, so every pair comes as lhs < rhs
+            for (size_t lhs = run_begin; lhs < run_end; ++lhs)
+            {
+                for (size_t rhs = lhs + 1; rhs < run_end; ++rhs)
+                {
+                    candidates.emplace_back(keys[lhs].second, keys[rhs].second);
+                }
+            }
+            run_begin = run_end;
+        }
+        // a pair found in many bands is kept once
+        sort(execution::par, candidates.begin(), candidates.end());
+        candidates.erase(unique(candidates.begin(), candidates.end()), candidates.end());
+    }
+    return candidates;
+}
+
+// groups of documents with equal term sets and the pairs of them at least
+// threshold similar
+struct SimilarGroups {
+    vector<int> document_ids;
+    vector<vector<uint32_t>> groups;
+    // pairs of group indexes, lhs < rhs, in ascending order
+    vector<pair<uint32_t, uint32_t>> similar_pairs;
+};
+
+SimilarGroups FindSimilarGroups(const SearchServer &search_server, double threshold)
+{
+    if (!(threshold > 0 && threshold <= 1))
+    {
+        throw invalid_argument("Similarity threshold must be in (0, 1]"s);
+    }
+    SimilarGroups result;
+    result.document_ids.assign(search_server.cbegin(), search_server.cend());
+    const vector<int> &document_ids = result.document_ids;
+    result.groups = GroupEqualTermSets(search_server, document_ids);
+    const Sketches sketches(search_server, document_ids);
+    const auto candidates = FindCandidates(
+        sketches, result.groups, ChooseLshBanding(sketches.GetHashCount(), threshold)
+    );
+
+    vector<char> is_similar(candidates.size());
+    transform(
+        execution::par,
+        candidates.begin(), candidates.end(),
+        is_similar.begin(),
+        [&](const pair<uint32_t, uint32_t> &candidate) -> char {
+            return ComputeJaccard(
+                search_server.GetWordFrequencies(document_ids[result.groups[candidate.first].front()]),
+                search_server.GetWordFrequencies(document_ids[result.groups[candidate.second].front()])
+            ) >= threshold;
+        }
+    );
+    for (size_t i = 0; i < candidates.size(); ++i)
+    {
+        if (is_similar[i])
+        {
+            result.similar_pairs.push_back(candidates[i]);
+        }
+    }
+    return result;
+}
+
+}
+
+LshBanding ChooseLshBanding(size_t hash_count, double threshold)
+{
+    if (hash_count == 0)
+    {
+        throw invalid_argument("Sketches are empty"s);
+    }
+    LshBanding best{hash_count, 1};
+    for (size_t rows = 1; rows <= hash_count; ++rows)
+    {
+        if (hash_count % rows != 0)
+        {
+            continue;
+        }
+        const size_t bands = hash_count / rows;
+        if (pow(1.0 / bands, 1.0 / rows) <= threshold)
+        {
+            best = {bands, rows};
+        }
+    }
+    return best;
+}
+
+vector<pair<int, int>> FindNearDuplicates(const SearchServer &search_server, double threshold)
+{
+    const SimilarGroups similar = FindSimilarGroups(search_server, threshold);
+    const auto &document_ids = similar.document_ids;
+    vector<pair<int, int>> near_duplicates;
+    // documents with equal term sets have the similarity 1
+    for (const vector<uint32_t> &group : similar.groups)
+    {
+        for (size_t lhs = 0; lhs < group.size(); ++lhs)
+        {
+            for (size_t rhs = lhs + 1; rhs < group.size(); ++rhs)
+            {
+                near_duplicates.emplace_back(document_ids[group[lhs]], document_ids[group[rhs]]);
+            }
+        }
+    }
+    for (const auto &[lhs_group, rhs_group] : similar.similar_pairs)
+    {
+        for (uint32_t lhs : similar.groups[lhs_group])
+        {
+            for (uint32_t rhs : similar.groups[rhs_group])
+            {
+                near_duplicates.emplace_back(
+                    document_ids[min(lhs, rhs)], document_ids[max(lhs, rhs)]
+                );
+            }
+        }
+    }
+    sort(near_duplicates.begin(), near_duplicates.end());
+    return near_duplicates;
+}
+
+void RemoveNearDuplicates(SearchServer &search_server, double threshold)
+{
+    const SimilarGroups similar = FindSimilarGroups(search_server, threshold);
+    const auto &groups = similar.groups;
+    // groups come in the order of their first, smallest, document, which is
+    // the only one of a group that may be kept
+    vector<char> is_kept(groups.size(), true);
+    for (const auto &[lhs_group, rhs_group] : similar.similar_pairs)
+    {
+        // pairs come in ascending order, so lhs_group is settled already
+        if (is_kept[lhs_group])
+        {
+            is_kept[rhs_group] = false;
+        }
+    }
+    vector<int> duplicates;
+    for (size_t i = 0; i < groups.size(); ++i)
+    {
+        for (size_t j = is_kept[i] ? 1 : 0; j < groups[i].size(); ++j)
+        {
+            duplicates.push_back(similar.document_ids[groups[i][j]]);
+        }
+    }
+    search_server.RemoveDocuments(duplicates);
+}
@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "search_server.h"
+
+// sketch size used when the server keeps no sketches of its own
+inline constexpr size_t DEFAULT_MIN_HASH_SIZE = 128;
+
+// Locality-sensitive hashing of sketches: documents whose sketches agree
+// on all rows of at least one band become candidate pairs.
+struct LshBanding {
+    size_t band_count;
+    size_t rows_per_band;
+};
+
+// Splits hash_count rows into bands so that pairs at the threshold
+// similarity become candidates with high probability: the similarity
+// (1 / band_count)^(1 / rows_per_band), where the candidate probability
+// rises steepest, is the largest one not above the threshold.
+LshBanding ChooseLshBanding(size_t hash_count, double threshold);
+
+// Pairs (lhs, rhs), lhs < rhs, of documents whose word sets have a Jaccard
+// similarity of at least threshold, in ascending order. Candidates come
+// from LSH over MinHash sketches: every two documents sharing a bucket in
+// some band are verified exactly, so a pair is missed only when their
+// sketches agree on no band, which has a small probability at the
+// threshold. Documents with equal word sets are banded and verified once,
+// so copies of a document cost only the pairs they add to the result.
+// Uses the sketches kept by the server or computes them in parallel.
+std::vector<std::pair<int, int>> FindNearDuplicates(const SearchServer &search_server, double threshold);
+
+// Goes through the documents in ascending id order and removes those whose
+// similarity to a kept document reaches the threshold, as RemoveDuplicates
+// does for equal word sets. A document similar only to removed ones stays.
+void RemoveNearDuplicates(SearchServer &search_server, double threshold);
@@ -0,0 +1,33 @@
+#include "socket_utils.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <iterator>
+#include <string>
+
+using namespace std;
+
+// Sends the requests read from stdin to the server at once, pipelined,
+// and prints the responses in order.
+int main(int argc, char *argv[])
+{
+    if (argc != 2)
+    {
+        cerr << "Usage: search_client unix:<path> | <host>:<port> < requests" << endl;
+        return 1;
+    }
+    const int fd = ConnectTo(argv[1]);
+    const string requests((istreambuf_iterator<char>(cin)), istreambuf_iterator<char>());
+    WriteAll(fd, requests);
+    shutdown(fd, SHUT_WR);
+    char buffer[1 << 16];
+    ssize_t received = 0;
+    while ((received = read(fd, buffer, sizeof(buffer))) > 0)
+    {
+        cout.write(buffer, received);
+    }
+    close(fd);
+    return 0;
+}
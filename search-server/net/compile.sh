@@ -0,0 +1,4 @@
+LIB="../document.cpp ../forward_index.cpp ../impact_index.cpp ../latency_histogram.cpp ../min_hash.cpp ../near_duplicates.cpp ../perf_counters.cpp ../query_executor.cpp ../query_stats.cpp ../scoring_model.cpp ../search_cursor.cpp ../search_server.cpp ../signature_index.cpp ../string_processing.cpp ../term_set_signature.cpp ../text_storage.cpp ../tracing.cpp ../versioned_search_server.cpp"
+g++ -std=c++17 ${OPT:--O2} server_main.cpp replication.cpp request_server.cpp protocol.cpp socket_utils.cpp $LIB -ltbb -lpthread -o search_server
+g++ -std=c++17 ${OPT:--O2} client_main.cpp socket_utils.cpp -o search_client
+g++ -std=c++17 ${OPT:--O2} coordinator_main.cpp coordinator.cpp protocol.cpp replication.cpp socket_utils.cpp ../sharded_search_server.cpp $LIB -ltbb -lpthread -o search_coordinator
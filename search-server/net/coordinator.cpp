@@ -0,0 +1,469 @@
+#include "coordinator.h"
+#include "protocol.h"
+#include "socket_utils.h"
+#include "../sharded_search_server.h"
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <exception>
+#include <iostream>
+#include <set>
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+using Clock = chrono::steady_clock;
+
+// one copy of a request sent to one replica
+struct Attempt {
+    size_t partition;
+    string address;
+    int fd;
+    string response;
+};
+
+}
+
+Coordinator::Coordinator(const CoordinatorConfig &config)
+    : config_(config)
+{
+}
+
+Coordinator::~Coordinator()
+{
+    for (const auto &[address, fd] : connections_)
+    {
+        close(fd);
+    }
+}
+
+std::string Coordinator::Handle(std::string_view request)
+{
+    std::string_view arguments = request;
+    const std::string_view command = CutToken(arguments);
+    if (command == "FIND"sv)
+    {
+        const std::string_view status = CutToken(arguments);
+        return HandleFind(status, arguments);
+    }
+    if (command == "COUNT"sv)
+    {
+        return HandleCount();
+    }
+    if (command == "ADD"sv || command == "REMOVE"sv)
+    {
+        return HandleWrite(request);
+    }
+    if (command == "MATCH"sv)
+    {
+        return HandleMatch(request);
+    }
+    if (command == "PAGE"sv && config_.partitions.size() > 1)
+    {
+        // cursors of different partitions rank by different IDF
+        string output;
+        AppendError("PAGE is not supported over several partitions"sv, output);
+        return output;
+    }
+    return HandleAny(request);
+}
+
+std::string Coordinator::HandleFind(std::string_view status, std::string_view query)
+{
+    set<std::string_view> plus_words;
+    for (std::string_view word : SplitIntoWords(query))
+    {
+        if (word[0] != '-')
+        {
+            plus_words.insert(word);
+        }
+    }
+    string stats_request = "STATS"s;
+    for (std::string_view word : plus_words)
+    {
+        stats_request += ' ';
+        stats_request += word;
+    }
+    const auto stats = ScatterGather(
+        config_.partitions,
+        vector<string>(config_.partitions.size(), stats_request)
+    );
+    int document_count = 0;
+    double total_length = 0;
+    vector<int> document_freqs(plus_words.size(), 0);
+    bool has_stats = false;
+    for (const auto &response : stats)
+    {
+        std::string_view line = response ? std::string_view(*response) : ""sv;
+        if (CutToken(line) != "OK"sv)
+        {
+            continue;
+        }
+        has_stats = true;
+        document_count += stoi(string(CutToken(line)));
+        total_length += stod(string(CutToken(line)));
+        for (int &document_freq : document_freqs)
+        {
+            document_freq += stoi(string(CutToken(line)));
+        }
+    }
+    if (!has_stats)
+    {
+        return "ERR No backend answered"s;
+    }
+
+    string find_request = "FINDG "s + string(status) + ' ' + to_string(document_count) + ' ';
+    AppendDouble(total_length, find_request);
+    find_request += ' ' + to_string(plus_words.size());
+    size_t word_index = 0;
+    for (std::string_view word : plus_words)
+    {
+        find_request += ' ';
+        find_request += word;
+        find_request += ' ';
+        find_request += to_string(document_freqs[word_index++]);
+    }
+    find_request += ' ';
+    find_request += query;
+    const auto responses = ScatterGather(
+        config_.partitions,
+        vector<string>(config_.partitions.size(), find_request)
+    );
+
+    vector<Document> documents;
+    for (const auto &response : responses)
+    {
+        if (!response)
+        {
+            continue;
+        }
+        const auto partition_documents = ParseDocuments(*response);
+        if (!partition_documents)
+        {
+            // every partition parses the same query, so the error is shared
+            return *response;
+        }
+        documents.insert(documents.end(), partition_documents->begin(), partition_documents->end());
+    }
+    const size_t result_size = min<size_t>(documents.size(), MAX_RESULT_DOCUMENT_COUNT);
+    partial_sort(
+        documents.begin(),
+        documents.begin() + result_size,
+        documents.end(),
+        SearchServer::IsMoreRelevant
+    );
+    documents.resize(result_size);
+    string output;
+    AppendDocuments(documents, output);
+    output.pop_back();
+    return output;
+}
+
+std::string Coordinator::HandleCount()
+{
+    const auto responses = ScatterGather(
+        config_.partitions,
+        vector<string>(config_.partitions.size(), "STATS"s)
+    );
+    int document_count = 0;
+    for (const auto &response : responses)
+    {
+        std::string_view line = response ? std::string_view(*response) : ""sv;
+        if (CutToken(line) == "OK"sv)
+        {
+            document_count += stoi(string(CutToken(line)));
+        }
+    }
+    return "OK "s + to_string(document_count);
+}
+
+std::optional<size_t> Coordinator::FindOwningPartition(std::string_view request) const
+{
+    std::string_view arguments = request;
+    CutToken(arguments);
+    int document_id = 0;
+    try
+    {
+        document_id = stoi(string(CutToken(arguments)));
+    }
+    catch (const exception &)
+    {
+        return nullopt;
+    }
+    if (document_id < 0)
+    {
+        return nullopt;
+    }
+    return GetPartitionIndex(document_id, config_.partitions.size());
+}
+
+std::string Coordinator::HandleWrite(std::string_view request)
+{
+    const auto partition_index = FindOwningPartition(request);
+    if (!partition_index)
+    {
+        return "ERR Invalid document_id"s;
+    }
+    // every replica gets the write, none is hedged: a replica which misses
+    // it would drift from the others for good
+    const Partition &partition = config_.partitions[*partition_index];
+    vector<Partition> replicas;
+    for (const string &address : partition.replicas)
+    {
+        replicas.push_back({{address}});
+    }
+    const auto responses = ScatterGather(
+        replicas,
+        vector<string>(replicas.size(), string(request))
+    );
+    size_t acknowledged = 0;
+    optional<string> error;
+    for (size_t i = 0; i < responses.size(); ++i)
+    {
+        if (responses[i] && responses[i]->rfind("OK"s, 0) == 0)
+        {
+            ++acknowledged;
+        }
+        else if (!error)
+        {
+            error = responses[i].value_or("ERR Replica "s + replicas[i].replicas[0] + " did not answer"s);
+        }
+    }
+    if (acknowledged == responses.size())
+    {
+        return "OK"s;
+    }
+    if (acknowledged == 0)
+    {
+        return *error;
+    }
+    // some replicas applied the write, the partition is inconsistent
+    return *error + " ("s + to_string(acknowledged) + " of "s + to_string(responses.size())
+        + " replicas applied the write)"s;
+}
+
+std::string Coordinator::HandleMatch(std::string_view request)
+{
+    const auto partition_index = FindOwningPartition(request);
+    if (!partition_index)
+    {
+        return "ERR Invalid document_id"s;
+    }
+    const auto responses = ScatterGather(
+        {config_.partitions[*partition_index]},
+        {string(request)}
+    );
+    return responses[0].value_or("ERR No backend answered"s);
+}
+
+std::string Coordinator::HandleAny(std::string_view request)
+{
+    const auto responses = ScatterGather(
+        config_.partitions,
+        vector<string>(config_.partitions.size(), string(request))
+    );
+    optional<string> error;
+    for (const auto &response : responses)
+    {
+        if (!response)
+        {
+            continue;
+        }
+        if (response->rfind("OK"s, 0) == 0)
+        {
+            return *response;
+        }
+        if (!error)
+        {
+            error = *response;
+        }
+    }
+    return error.value_or("ERR No backend answered"s);
+}
+
+std::vector<std::optional<std::string>> Coordinator::ScatterGather(
+    const std::vector<Partition> &partitions,
+    const std::vector<std::string> &requests
+)
+{
+    const size_t partition_count = partitions.size();
+    vector<optional<string>> responses(partition_count);
+    vector<size_t> next_replica(partition_count, 0);
+    vector<size_t> active_attempts(partition_count, 0);
+    vector<Clock::time_point> hedge_time(partition_count);
+    vector<Attempt> attempts;
+    const auto deadline = Clock::now() + config_.timeout;
+
+    // sends the request to the next replica which accepts it
+    auto launch = [&](size_t partition) {
+        const auto &replicas = partitions[partition].replicas;
+        while (next_replica[partition] < replicas.size())
+        {
+            const string &address = replicas[next_replica[partition]++];
+            const int fd = AcquireConnection(address);
+            if (fd < 0)
+            {
+                continue;
+            }
+            try
+            {
+                WriteAll(fd, requests[partition] + '\n');
+            }
+            catch (const exception &)
+            {
+                DropConnection(address);
+                continue;
+            }
+            attempts.push_back({partition, address, fd, {}});
+            ++active_attempts[partition];
+            hedge_time[partition] = Clock::now() + config_.hedge_delay;
+            return;
+        }
+    };
+    // the backend did not answer the request, its connection is out of sync
+    auto abandon = [&](Attempt &attempt) {
+        DropConnection(attempt.address);
+        attempt.fd = -1;
+        --active_attempts[attempt.partition];
+    };
+
+    for (size_t partition = 0; partition < partition_count; ++partition)
+    {
+        launch(partition);
+    }
+    vector<pollfd> poll_fds;
+    vector<size_t> polled_attempts;
+    while (true)
+    {
+        const auto now = Clock::now();
+        auto wake_time = deadline;
+        bool is_waiting = false;
+        for (size_t partition = 0; partition < partition_count; ++partition)
+        {
+            if (responses[partition] || active_attempts[partition] == 0)
+            {
+                continue;
+            }
+            is_waiting = true;
+            if (next_replica[partition] < partitions[partition].replicas.size())
+            {
+                if (now >= hedge_time[partition])
+                {
+                    launch(partition);
+                }
+                wake_time = min(wake_time, hedge_time[partition]);
+            }
+        }
+        if (!is_waiting || now >= deadline)
+        {
+            break;
+        }
+
+        poll_fds.clear();
+        polled_attempts.clear();
+        for (size_t i = 0; i < attempts.size(); ++i)
+        {
+            if (attempts[i].fd >= 0)
+            {
+                poll_fds.push_back({attempts[i].fd, POLLIN, 0});
+                polled_attempts.push_back(i);
+            }
+        }
+        const auto wait = chrono::duration_cast<chrono::milliseconds>(wake_time - now) + 1ms;
+        if (poll(poll_fds.data(), poll_fds.size(), static_cast<int>(wait.count())) < 0 && errno != EINTR)
+        {
+            break;
+        }
+        for (size_t i = 0; i < poll_fds.size(); ++i)
+        {
+            if (poll_fds[i].revents == 0)
+            {
+                continue;
+            }
+            Attempt &attempt = attempts[polled_attempts[i]];
+            if (attempt.fd < 0)
+            {
+                continue;
+            }
+            char buffer[1 << 16];
+            const ssize_t received = recv(attempt.fd, buffer, sizeof(buffer), 0);
+            if (received <= 0)
+            {
+                abandon(attempt);
+                if (active_attempts[attempt.partition] == 0 && !responses[attempt.partition])
+                {
+                    // fail over at once instead of waiting for the hedge delay
+                    launch(attempt.partition);
+                }
+                continue;
+            }
+            attempt.response.append(buffer, received);
+            const size_t line_end = attempt.response.find('\n');
+            if (line_end == string::npos)
+            {
+                continue;
+            }
+            attempt.response.resize(line_end);
+            responses[attempt.partition] = move(attempt.response);
+            attempt.fd = -1;
+            --active_attempts[attempt.partition];
+            for (Attempt &other : attempts)
+            {
+                if (other.partition == attempt.partition && other.fd >= 0)
+                {
+                    abandon(other);
+                }
+            }
+        }
+    }
+    for (Attempt &attempt : attempts)
+    {
+        if (attempt.fd >= 0)
+        {
+            abandon(attempt);
+        }
+    }
+    for (size_t partition = 0; partition < partition_count; ++partition)
+    {
+        if (!responses[partition])
+        {
+            cerr << "No answer from partition "s << partition << endl;
+        }
+    }
+    return responses;
+}
+
+int Coordinator::AcquireConnection(const std::string &address)
+{
+    const auto it = connections_.find(address);
+    if (it != connections_.end())
+    {
+        return it->second;
+    }
+    try
+    {
+        const int fd = ConnectTo(address);
+        connections_[address] = fd;
+        return fd;
+    }
+    catch (const exception &)
+    {
+        return -1;
+    }
+}
+
+void Coordinator::DropConnection(const std::string &address)
+{
+    const auto it = connections_.find(address);
+    if (it != connections_.end())
+    {
+        close(it->second);
+        connections_.erase(it);
+    }
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <chrono>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// backends holding the same part of the corpus
+struct Partition {
+    std::vector<std::string> replicas;
+};
+
+struct CoordinatorConfig {
+    std::vector<Partition> partitions;
+    // a request unanswered for this long is also sent to the next replica
+    std::chrono::milliseconds hedge_delay{20};
+    // a partition unanswered for this long is left out of the result
+    std::chrono::milliseconds timeout{500};
+};
+
+// Serves the line protocol of protocol.h over a set of search-server
+// backends, each holding a part of the corpus. FIND is answered in two
+// rounds: STATS gathers the corpus-wide document count, total document
+// length and document frequencies, then FINDG searches every partition with
+// them, so the merged top documents and their relevance equal those of a
+// single server. Slow backends of reads are hedged with their replicas, and failed
+// partitions are left out after the timeout. ADD and REMOVE go to every
+// replica of the partition owning the document and succeed only if all of
+// them apply it.
+// A Coordinator keeps its own backend connections and serves one client
+// connection at a time.
+class Coordinator
+{
+public:
+    explicit Coordinator(const CoordinatorConfig &config);
+    ~Coordinator();
+
+    Coordinator(const Coordinator &) = delete;
+    Coordinator &operator=(const Coordinator &) = delete;
+
+    // returns the response line to the request, without the line break
+    std::string Handle(std::string_view request);
+
+private:
+    const CoordinatorConfig &config_;
+    std::unordered_map<std::string, int> connections_;
+
+    std::string HandleFind(std::string_view status, std::string_view query);
+    std::string HandleCount();
+    // the partition of the document id following the command, nullopt if
+    // the id is invalid
+    std::optional<size_t> FindOwningPartition(std::string_view request) const;
+    // sends an ADD or REMOVE to every replica of the owning partition,
+    // OK only if all of them applied it
+    std::string HandleWrite(std::string_view request);
+    // asks the owning partition, hedging its replicas
+    std::string HandleMatch(std::string_view request);
+    // sends the request to every partition and returns the first OK response,
+    // or the first error if there is none
+    std::string HandleAny(std::string_view request);
+
+    // sends requests[i] to partitions[i], hedging slow replicas; a partition
+    // which did not answer in time gets nullopt
+    std::vector<std::optional<std::string>> ScatterGather(
+        const std::vector<Partition> &partitions,
+        const std::vector<std::string> &requests
+    );
+
+    int AcquireConnection(const std::string &address);
+    void DropConnection(const std::string &address);
+};
@@ -0,0 +1,145 @@
+#include "coordinator.h"
+#include "socket_utils.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+void PrintUsage()
+{
+    cerr << "Usage: search_coordinator [--port <port>] [--unix <path>]\n"
+            "                          --backend <address>[,<replica address>]... ...\n"
+            "                          [--hedge-ms <ms>] [--timeout-ms <ms>]\n"
+            "Every --backend is one partition of the corpus; an address is\n"
+            "unix:<path> or <host>:<port>.\n";
+}
+
+// answers the requests of one client in order until it disconnects
+void ServeClient(int fd, const CoordinatorConfig &config)
+{
+    Coordinator coordinator(config);
+    string input;
+    char buffer[1 << 16];
+    ssize_t received = 0;
+    while ((received = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+    {
+        input.append(buffer, received);
+        string output;
+        size_t line_start = 0;
+        for (size_t line_end = input.find('\n'); line_end != string::npos;
+             line_end = input.find('\n', line_start))
+        {
+            string_view request(input.data() + line_start, line_end - line_start);
+            if (!request.empty() && request.back() == '\r')
+            {
+                request.remove_suffix(1);
+            }
+            output += coordinator.Handle(request);
+            output += '\n';
+            line_start = line_end + 1;
+        }
+        input.erase(0, line_start);
+        try
+        {
+            WriteAll(fd, output);
+        }
+        catch (const exception &)
+        {
+            break;
+        }
+    }
+    close(fd);
+}
+
+void AcceptClients(int listen_fd, const CoordinatorConfig &config)
+{
+    while (true)
+    {
+        const int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            continue;
+        }
+        thread(ServeClient, fd, cref(config)).detach();
+    }
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    int port = -1;
+    string unix_path;
+    CoordinatorConfig config;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 1;
+        }
+        const string value = argv[++i];
+        if (arg == "--port")
+        {
+            port = stoi(value);
+        }
+        else if (arg == "--unix")
+        {
+            unix_path = value;
+        }
+        else if (arg == "--backend")
+        {
+            Partition partition;
+            size_t start = 0;
+            while (start <= value.size())
+            {
+                const size_t comma = min(value.find(',', start), value.size());
+                partition.replicas.push_back(value.substr(start, comma - start));
+                start = comma + 1;
+            }
+            config.partitions.push_back(move(partition));
+        }
+        else if (arg == "--hedge-ms")
+        {
+            config.hedge_delay = chrono::milliseconds(stoi(value));
+        }
+        else if (arg == "--timeout-ms")
+        {
+            config.timeout = chrono::milliseconds(stoi(value));
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ((port < 0 && unix_path.empty()) || config.partitions.empty())
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    vector<thread> listeners;
+    if (port >= 0)
+    {
+        listeners.emplace_back(AcceptClients, ListenTcp(static_cast<uint16_t>(port)), cref(config));
+    }
+    if (!unix_path.empty())
+    {
+        listeners.emplace_back(AcceptClients, ListenUnix(unix_path), cref(config));
+    }
+    for (thread &listener : listeners)
+    {
+        listener.join();
+    }
+    return 0;
+}
@@ -0,0 +1,323 @@
+#include "protocol.h"
+#include "replication.h"
+#include <charconv>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+int ParseInt(std::string_view text)
+{
+    int value = 0;
+    const auto [end, error] = from_chars(text.data(), text.data() + text.size(), value);
+    if (error != errc{} || end != text.data() + text.size())
+    {
+        throw invalid_argument("Invalid number "s + string(text));
+    }
+    return value;
+}
+
+double ParseDouble(std::string_view text)
+{
+    try
+    {
+        size_t length = 0;
+        const double value = stod(string(text), &length);
+        if (length == text.size())
+        {
+            return value;
+        }
+    }
+    catch (const exception &)
+    {
+    }
+    throw invalid_argument("Invalid number "s + string(text));
+}
+
+DocumentStatus ParseStatusOrThrow(std::string_view text)
+{
+    const auto status = ParseStatus(text);
+    if (!status)
+    {
+        throw invalid_argument("Invalid status "s + string(text));
+    }
+    return *status;
+}
+
+vector<int> ParseRatings(std::string_view text)
+{
+    vector<int> ratings;
+    if (text == "-"sv)
+    {
+        return ratings;
+    }
+    while (!text.empty())
+    {
+        const size_t comma = text.find(',');
+        ratings.push_back(ParseInt(text.substr(0, comma)));
+        text.remove_prefix(comma == text.npos ? text.size() : comma + 1);
+    }
+    return ratings;
+}
+
+bool IsWrite(std::string_view request)
+{
+    const std::string_view command = CutToken(request);
+    return command == "ADD"sv || command == "REMOVE"sv;
+}
+
+void HandleRead(const SearchServer &search_server, std::string_view request, std::string &output)
+{
+    const std::string_view command = CutToken(request);
+    if (command == "FIND"sv)
+    {
+        const DocumentStatus status = ParseStatusOrThrow(CutToken(request));
+        AppendDocuments(search_server.FindTopDocuments(request, status), output);
+    }
+    else if (command == "PAGE"sv)
+    {
+        const DocumentStatus status = ParseStatusOrThrow(CutToken(request));
+        const int page_size = ParseInt(CutToken(request));
+        if (page_size <= 0)
+        {
+            throw invalid_argument("Invalid page size"s);
+        }
+        const SearchCursor cursor = SearchCursor::Parse(CutToken(request));
+        const SearchPage page = search_server.FindPage(request, status, cursor, page_size);
+        string documents;
+        AppendDocuments(page.documents, documents);
+        output += "OK "sv;
+        output += page.next ? page.next->Serialize() : "-"s;
+        // " <n> [<id> <relevance> <rating>]..." after the "OK" of documents
+        output += std::string_view(documents).substr(2);
+    }
+    else if (command == "MATCH"sv)
+    {
+        const int document_id = ParseInt(CutToken(request));
+        const auto [words, status] = search_server.MatchDocument(request, document_id);
+        output += "OK "sv;
+        output += GetStatusName(status);
+        for (std::string_view word : words)
+        {
+            output += ' ';
+            output += word;
+        }
+        output += '\n';
+    }
+    else if (command == "FINDG"sv)
+    {
+        const DocumentStatus status = ParseStatusOrThrow(CutToken(request));
+        CorpusStatistics corpus;
+        corpus.document_count = ParseInt(CutToken(request));
+        corpus.total_length = ParseDouble(CutToken(request));
+        const int word_count = ParseInt(CutToken(request));
+        map<string, int, less<>> document_freqs;
+        for (int i = 0; i < word_count; ++i)
+        {
+            const std::string_view word = CutToken(request);
+            document_freqs[string(word)] = ParseInt(CutToken(request));
+        }
+        corpus.document_freq = [&search_server, &document_freqs](std::string_view word) {
+            const auto it = document_freqs.find(word);
+            return it == document_freqs.end()
+                ? search_server.GetDocumentFreq(word)
+                : it->second;
+        };
+        QueryContext context;
+        context.corpus = &corpus;
+        AppendDocuments(
+            search_server.FindTopDocuments(
+                context,
+                request,
+                [status](int document_id, DocumentStatus document_status, int rating) {
+                    return document_status == status;
+                }
+            ),
+            output
+        );
+    }
+    else if (command == "STATS"sv)
+    {
+        output += "OK "s + to_string(search_server.GetDocumentCount()) + ' ';
+        AppendDouble(search_server.GetTotalDocumentLength(), output);
+        for (std::string_view word = CutToken(request); !word.empty(); word = CutToken(request))
+        {
+            output += ' ';
+            output += to_string(search_server.GetDocumentFreq(word));
+        }
+        output += '\n';
+    }
+    else if (command == "COUNT"sv)
+    {
+        output += "OK "s + to_string(search_server.GetDocumentCount()) + '\n';
+    }
+    else
+    {
+        throw invalid_argument("Unknown command "s + string(command));
+    }
+}
+
+}
+
+void ApplyWrite(SearchServer &search_server, std::string_view request)
+{
+    const std::string_view command = CutToken(request);
+    if (command == "ADD"sv)
+    {
+        const int document_id = ParseInt(CutToken(request));
+        const DocumentStatus status = ParseStatusOrThrow(CutToken(request));
+        const vector<int> ratings = ParseRatings(CutToken(request));
+        search_server.AddDocument(document_id, string(request), status, ratings);
+    }
+    else if (command == "REMOVE"sv)
+    {
+        search_server.RemoveDocument(ParseInt(CutToken(request)));
+    }
+    else
+    {
+        throw invalid_argument("Unknown command "s + string(command));
+    }
+}
+
+std::string_view CutToken(std::string_view &line)
+{
+    line.remove_prefix(min(line.find_first_not_of(' '), line.size()));
+    const size_t space = min(line.find(' '), line.size());
+    const std::string_view token = line.substr(0, space);
+    line.remove_prefix(space);
+    line.remove_prefix(min(line.find_first_not_of(' '), line.size()));
+    return token;
+}
+
+size_t SplitLines(std::string_view buffer, std::vector<std::string_view> &lines)
+{
+    size_t consumed = 0;
+    for (size_t end = buffer.find('\n'); end != buffer.npos; end = buffer.find('\n', consumed))
+    {
+        std::string_view line = buffer.substr(consumed, end - consumed);
+        if (!line.empty() && line.back() == '\r')
+        {
+            line.remove_suffix(1);
+        }
+        lines.push_back(line);
+        consumed = end + 1;
+    }
+    return consumed;
+}
+
+void HandleRequests(
+    VersionedSearchServer &search_server,
+    const std::vector<std::string_view> &requests,
+    std::string &output,
+    const WritePolicy &policy
+)
+{
+    size_t i = 0;
+    while (i < requests.size())
+    {
+        if (IsWrite(requests[i]) && policy.is_read_only)
+        {
+            AppendError("Read-only replica"sv, output);
+            ++i;
+            continue;
+        }
+        if (IsWrite(requests[i]))
+        {
+            size_t last = i;
+            while (last < requests.size() && IsWrite(requests[last]))
+            {
+                ++last;
+            }
+            search_server.Update([&](SearchServer &server) {
+                for (; i < last; ++i)
+                {
+                    try
+                    {
+                        ApplyWrite(server, requests[i]);
+                        if (policy.log != nullptr)
+                        {
+                            policy.log->Append(server.GetGeneration(), requests[i]);
+                        }
+                        output += "OK\n"sv;
+                    }
+                    catch (const exception &error)
+                    {
+                        AppendError(error.what(), output);
+                    }
+                }
+            });
+            continue;
+        }
+        const auto snapshot = search_server.GetSnapshot();
+        for (; i < requests.size() && !IsWrite(requests[i]); ++i)
+        {
+            try
+            {
+                HandleRead(*snapshot, requests[i], output);
+            }
+            catch (const exception &error)
+            {
+                AppendError(error.what(), output);
+            }
+        }
+    }
+}
+
+void AppendDocuments(const std::vector<Document> &documents, std::string &output)
+{
+    output += "OK "s + to_string(documents.size());
+    for (const Document &document : documents)
+    {
+        output += ' ';
+        output += to_string(document.id);
+        output += ' ';
+        AppendDouble(document.relevance, output);
+        output += ' ';
+        output += to_string(document.rating);
+    }
+    output += '\n';
+}
+
+void AppendDouble(double value, std::string &output)
+{
+    char text[32];
+    snprintf(text, sizeof(text), "%.17g", value);
+    output += text;
+}
+
+std::optional<std::vector<Document>> ParseDocuments(std::string_view response)
+{
+    if (CutToken(response) != "OK"sv)
+    {
+        return nullopt;
+    }
+    try
+    {
+        vector<Document> documents(ParseInt(CutToken(response)));
+        for (Document &document : documents)
+        {
+            document.id = ParseInt(CutToken(response));
+            document.relevance = stod(string(CutToken(response)));
+            document.rating = ParseInt(CutToken(response));
+        }
+        return documents;
+    }
+    catch (const exception &)
+    {
+        return nullopt;
+    }
+}
+
+void AppendError(std::string_view message, std::string &output)
+{
+    output += "ERR "sv;
+    for (char c : message)
+    {
+        output += c == '\n' ? ' ' : c;
+    }
+    output += '\n';
+}
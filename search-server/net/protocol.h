@@ -0,0 +1,67 @@
+#pragma once
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "../document.h"
+#include "../versioned_search_server.h"
+
+// Line protocol of the search server. Every request is one line, every
+// request gets one response line, and responses come in request order, so
+// a client may pipeline any number of requests.
+//
+//   FIND <status> <query>                -> OK <n> [<id> <relevance> <rating>]...
+//   PAGE <status> <size> <cursor> <query> -> OK <next cursor> <n> [<id> <relevance> <rating>]...
+//   MATCH <id> <query>                   -> OK <status> [<word>]...
+//   ADD <id> <status> <ratings> <text>   -> OK
+//   REMOVE <id>                          -> OK
+//   COUNT                                -> OK <document count>
+//   STATS [<word>]...                    -> OK <document count> <total length> [<document freq>]...
+//   FINDG <status> <document count> <total length> <k> [<word> <document freq>]{k} <query>
+//                                        -> as FIND, with IDF and the average
+//                                           document length taken from the
+//                                           given corpus-wide statistics
+//
+// <status> is ACTUAL, IRRELEVANT, BANNED or REMOVED; <ratings> is a comma
+// separated list of integers or "-" for none. A <cursor> is "-" for the
+// first page and the <next cursor> of the previous page after it; the last
+// page has the next cursor "-". A failed request gets
+// ERR <message>.
+
+// cuts the first space separated token off the line
+std::string_view CutToken(std::string_view &line);
+
+// appends views of the complete lines at the front of buffer to lines
+// and returns the number of bytes they take
+size_t SplitLines(std::string_view buffer, std::vector<std::string_view> &lines);
+
+class MutationLog;
+
+// how HandleRequests treats ADD and REMOVE
+struct WritePolicy {
+    // writes are refused, as on a replication follower
+    bool is_read_only = false;
+    // applied writes are appended here, as on a replication leader
+    MutationLog *log = nullptr;
+};
+
+// Executes a pipelined batch of requests and appends their responses to
+// output. Requests see the effect of the writes before them in the batch;
+// consecutive writes are published as one version of the index.
+void HandleRequests(
+    VersionedSearchServer &search_server,
+    const std::vector<std::string_view> &requests,
+    std::string &output,
+    const WritePolicy &policy = {}
+);
+// applies an ADD or REMOVE request, throws on a malformed or failed one
+void ApplyWrite(SearchServer &search_server, std::string_view request);
+
+void AppendDocuments(const std::vector<Document> &documents, std::string &output);
+// appends the number with enough digits to parse back to the same double
+void AppendDouble(double value, std::string &output);
+// parses a response to FIND, nullopt if it is an error or malformed
+std::optional<std::vector<Document>> ParseDocuments(std::string_view response);
+void AppendError(std::string_view message, std::string &output);
@@ -0,0 +1,501 @@
+#include "replication.h"
+#include "protocol.h"
+#include "socket_utils.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <iostream>
+#include <stdexcept>
+#include <system_error>
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+// entries sent to a follower in one write
+const size_t MAX_BATCH_SIZE = 4096;
+const auto LOG_WAIT = 100ms;
+const auto RECONNECT_DELAY = 1s;
+
+string GetPeerName(int fd)
+{
+    sockaddr_storage address{};
+    socklen_t length = sizeof(address);
+    if (getpeername(fd, reinterpret_cast<sockaddr *>(&address), &length) != 0
+        || address.ss_family != AF_INET)
+    {
+        return "fd "s + to_string(fd);
+    }
+    const auto &ipv4 = reinterpret_cast<const sockaddr_in &>(address);
+    char host[INET_ADDRSTRLEN];
+    inet_ntop(AF_INET, &ipv4.sin_addr, host, sizeof(host));
+    return string(host) + ':' + to_string(ntohs(ipv4.sin_port));
+}
+
+uint64_t ParseOffset(std::string_view text)
+{
+    return stoull(string(text));
+}
+
+}
+
+MutationLog::MutationLog(size_t retention)
+    : retention_(max<size_t>(1, retention))
+{
+}
+
+void MutationLog::Append(uint64_t offset, std::string_view request)
+{
+    {
+        lock_guard guard(mx_);
+        if (offset != first_offset_ + entries_.size())
+        {
+            // followers behind the gap fall back to a snapshot
+            entries_.clear();
+            first_offset_ = offset;
+        }
+        entries_.emplace_back(request);
+        if (entries_.size() > retention_)
+        {
+            entries_.pop_front();
+            ++first_offset_;
+        }
+    }
+    appended_.notify_all();
+}
+
+uint64_t MutationLog::GetLastOffset() const
+{
+    lock_guard guard(mx_);
+    return first_offset_ + entries_.size() - 1;
+}
+
+bool MutationLog::Read(
+    uint64_t offset,
+    size_t max_count,
+    std::chrono::milliseconds wait,
+    std::vector<Entry> &entries
+) const
+{
+    unique_lock lock(mx_);
+    appended_.wait_for(lock, wait, [&] {
+        return first_offset_ + entries_.size() - 1 > offset;
+    });
+    const uint64_t last_offset = first_offset_ + entries_.size() - 1;
+    if (offset + 1 < first_offset_ || offset > last_offset)
+    {
+        return false;
+    }
+    for (uint64_t next = offset + 1; next <= last_offset && max_count > 0; ++next, --max_count)
+    {
+        entries.emplace_back(next, entries_[next - first_offset_]);
+    }
+    return true;
+}
+
+ReplicationLeader::ReplicationLeader(
+    const VersionedSearchServer &search_server,
+    const MutationLog &log
+)
+    : search_server_(search_server),
+      log_(log)
+{
+}
+
+ReplicationLeader::~ReplicationLeader()
+{
+    is_stopping_ = true;
+    if (listen_fd_ >= 0)
+    {
+        shutdown(listen_fd_, SHUT_RDWR);
+    }
+    if (accept_thread_.joinable())
+    {
+        accept_thread_.join();
+    }
+    if (listen_fd_ >= 0)
+    {
+        close(listen_fd_);
+    }
+    {
+        lock_guard guard(followers_mx_);
+        for (const auto &[fd, follower] : followers_)
+        {
+            shutdown(fd, SHUT_RDWR);
+        }
+    }
+    for (auto &[id, follower_thread] : follower_threads_)
+    {
+        follower_thread.join();
+    }
+}
+
+void ReplicationLeader::ListenTcp(uint16_t port)
+{
+    listen_fd_ = ::ListenTcp(port);
+    accept_thread_ = thread([this] { AcceptFollowers(); });
+}
+
+std::vector<ReplicationLeader::Follower> ReplicationLeader::GetFollowers() const
+{
+    lock_guard guard(followers_mx_);
+    vector<Follower> followers;
+    for (const auto &[fd, follower] : followers_)
+    {
+        followers.push_back(follower);
+    }
+    return followers;
+}
+
+void ReplicationLeader::AcceptFollowers()
+{
+    while (!is_stopping_)
+    {
+        const int fd = accept(listen_fd_, nullptr, nullptr);
+        if (fd < 0)
+        {
+            continue;
+        }
+        JoinFinishedThreads();
+        lock_guard guard(followers_mx_);
+        followers_[fd] = Follower{GetPeerName(fd), nullopt};
+        thread follower_thread([this, fd] { ServeFollower(fd); });
+        const thread::id id = follower_thread.get_id();
+        follower_threads_.emplace(id, move(follower_thread));
+    }
+}
+
+void ReplicationLeader::JoinFinishedThreads()
+{
+    vector<thread> finished_threads;
+    {
+        lock_guard guard(followers_mx_);
+        for (const thread::id &id : finished_threads_)
+        {
+            const auto it = follower_threads_.find(id);
+            finished_threads.push_back(move(it->second));
+            follower_threads_.erase(it);
+        }
+        finished_threads_.clear();
+    }
+    // the threads are past their last use of followers_mx_
+    for (thread &finished_thread : finished_threads)
+    {
+        finished_thread.join();
+    }
+}
+
+void ReplicationLeader::ServeFollower(int fd)
+{
+    try
+    {
+        string input;
+        char buffer[4096];
+        size_t line_end = string::npos;
+        while ((line_end = input.find('\n')) == string::npos)
+        {
+            const ssize_t received = recv(fd, buffer, sizeof(buffer), 0);
+            if (received <= 0)
+            {
+                throw runtime_error("Follower disconnected before SYNC"s);
+            }
+            input.append(buffer, received);
+        }
+        std::string_view request(input.data(), line_end);
+        if (CutToken(request) != "SYNC"sv)
+        {
+            throw runtime_error("Expected SYNC"s);
+        }
+        const std::string_view requested_offset = CutToken(request);
+        optional<uint64_t> offset;
+        if (requested_offset != "-"sv)
+        {
+            offset = ParseOffset(requested_offset);
+        }
+        input.erase(0, line_end + 1);
+
+        vector<MutationLog::Entry> entries;
+        string output;
+        while (!is_stopping_)
+        {
+            if (!offset)
+            {
+                offset = SendSnapshot(fd);
+            }
+            entries.clear();
+            if (!log_.Read(*offset, MAX_BATCH_SIZE, LOG_WAIT, entries))
+            {
+                offset.reset();
+                continue;
+            }
+            if (!entries.empty())
+            {
+                output.clear();
+                for (const auto &[entry_offset, entry] : entries)
+                {
+                    output += "LOG "s + to_string(entry_offset) + ' ';
+                    output += entry;
+                    output += '\n';
+                }
+                WriteAll(fd, output);
+                offset = entries.back().first;
+            }
+            ReadAcks(fd, input);
+        }
+    }
+    catch (const exception &error)
+    {
+        if (!is_stopping_)
+        {
+            cerr << "Replication to follower stopped: "s << error.what() << endl;
+        }
+    }
+    lock_guard guard(followers_mx_);
+    followers_.erase(fd);
+    close(fd);
+    // the thread was registered before it could take the lock
+    finished_threads_.push_back(this_thread::get_id());
+}
+
+uint64_t ReplicationLeader::SendSnapshot(int fd)
+{
+    const VersionedSearchServer::Snapshot snapshot = search_server_.GetSnapshot();
+    const uint64_t offset = snapshot->GetGeneration();
+    const string index = snapshot->SerializeIndex();
+    WriteAll(fd, "SNAPSHOT "s + to_string(offset) + ' ' + to_string(index.size()) + '\n');
+    WriteAll(fd, index);
+    return offset;
+}
+
+void ReplicationLeader::ReadAcks(int fd, std::string &input)
+{
+    char buffer[4096];
+    while (true)
+    {
+        const ssize_t received = recv(fd, buffer, sizeof(buffer), MSG_DONTWAIT);
+        if (received == 0)
+        {
+            throw runtime_error("Follower disconnected"s);
+        }
+        if (received < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                break;
+            }
+            throw system_error(errno, generic_category(), "recv"s);
+        }
+        input.append(buffer, received);
+    }
+    vector<std::string_view> lines;
+    const size_t consumed = SplitLines(input, lines);
+    optional<uint64_t> applied_offset;
+    for (std::string_view line : lines)
+    {
+        if (CutToken(line) == "ACK"sv)
+        {
+            applied_offset = ParseOffset(CutToken(line));
+        }
+    }
+    input.erase(0, consumed);
+    if (applied_offset)
+    {
+        lock_guard guard(followers_mx_);
+        followers_[fd].applied_offset = applied_offset;
+    }
+}
+
+ReplicationFollower::ReplicationFollower(
+    VersionedSearchServer &search_server,
+    std::string leader_address
+)
+    : search_server_(search_server),
+      leader_address_(move(leader_address))
+{
+}
+
+ReplicationFollower::~ReplicationFollower()
+{
+    {
+        lock_guard guard(mx_);
+        is_stopping_ = true;
+        if (fd_ >= 0)
+        {
+            shutdown(fd_, SHUT_RDWR);
+        }
+    }
+    wake_up_.notify_all();
+    if (thread_.joinable())
+    {
+        thread_.join();
+    }
+}
+
+void ReplicationFollower::Start()
+{
+    thread_ = thread([this] { Run(); });
+}
+
+std::optional<uint64_t> ReplicationFollower::GetAppliedOffset() const
+{
+    lock_guard guard(offset_mx_);
+    return applied_offset_;
+}
+
+void ReplicationFollower::Run()
+{
+    while (!is_stopping_)
+    {
+        try
+        {
+            const int fd = ConnectTo(leader_address_);
+            {
+                lock_guard guard(mx_);
+                fd_ = fd;
+            }
+            if (!is_stopping_)
+            {
+                Follow(fd);
+            }
+        }
+        catch (const exception &error)
+        {
+            if (!is_stopping_)
+            {
+                cerr << "Replication from "s << leader_address_ << " stopped: "s
+                     << error.what() << endl;
+            }
+        }
+        unique_lock lock(mx_);
+        if (fd_ >= 0)
+        {
+            close(fd_);
+            fd_ = -1;
+        }
+        wake_up_.wait_for(lock, RECONNECT_DELAY, [this] { return is_stopping_.load(); });
+    }
+}
+
+void ReplicationFollower::Follow(int fd)
+{
+    const optional<uint64_t> applied_offset = GetAppliedOffset();
+    WriteAll(fd, "SYNC "s + (applied_offset ? to_string(*applied_offset) : "-"s) + '\n');
+
+    string input;
+    char buffer[1 << 16];
+    uint64_t snapshot_offset = 0;
+    // bytes of the snapshot being received, nullopt between snapshots
+    optional<size_t> snapshot_size;
+    vector<MutationLog::Entry> entries;
+    ssize_t received = 0;
+    while ((received = recv(fd, buffer, sizeof(buffer), 0)) > 0)
+    {
+        input.append(buffer, received);
+        size_t consumed = 0;
+        bool is_applied = false;
+        while (true)
+        {
+            if (snapshot_size)
+            {
+                if (input.size() - consumed < *snapshot_size)
+                {
+                    input.reserve(consumed + *snapshot_size);
+                    break;
+                }
+                ApplySnapshot(snapshot_offset, std::string_view(input).substr(consumed, *snapshot_size));
+                consumed += *snapshot_size;
+                snapshot_size.reset();
+                is_applied = true;
+                continue;
+            }
+            const size_t line_end = input.find('\n', consumed);
+            if (line_end == string::npos)
+            {
+                break;
+            }
+            std::string_view line(input.data() + consumed, line_end - consumed);
+            consumed = line_end + 1;
+            const std::string_view command = CutToken(line);
+            if (command == "SNAPSHOT"sv)
+            {
+                ApplyLog(entries);
+                entries.clear();
+                snapshot_offset = ParseOffset(CutToken(line));
+                snapshot_size = stoul(string(CutToken(line)));
+            }
+            else if (command == "LOG"sv)
+            {
+                const uint64_t offset = ParseOffset(CutToken(line));
+                entries.emplace_back(offset, string(line));
+            }
+            else
+            {
+                throw runtime_error("Unexpected replication message "s + string(command));
+            }
+        }
+        input.erase(0, consumed);
+        if (!entries.empty())
+        {
+            ApplyLog(entries);
+            entries.clear();
+            is_applied = true;
+        }
+        if (is_applied)
+        {
+            WriteAll(fd, "ACK "s + to_string(*GetAppliedOffset()) + '\n');
+        }
+    }
+    if (!is_stopping_)
+    {
+        throw runtime_error("Leader disconnected"s);
+    }
+}
+
+void ReplicationFollower::ApplySnapshot(uint64_t offset, std::string_view index)
+{
+    search_server_.Update([index](SearchServer &search_server) {
+        search_server.LoadIndex(index);
+    });
+    lock_guard guard(offset_mx_);
+    applied_offset_ = offset;
+}
+
+void ReplicationFollower::ApplyLog(const std::vector<MutationLog::Entry> &entries)
+{
+    if (entries.empty())
+    {
+        return;
+    }
+    uint64_t offset = 0;
+    {
+        lock_guard guard(offset_mx_);
+        if (!applied_offset_ || entries.front().first != *applied_offset_ + 1)
+        {
+            throw runtime_error("Replication log does not follow the applied offset"s);
+        }
+        offset = *applied_offset_;
+    }
+    try
+    {
+        search_server_.Update([&entries](SearchServer &search_server) {
+            for (const auto &[entry_offset, request] : entries)
+            {
+                ApplyWrite(search_server, request);
+            }
+        });
+    }
+    catch (const exception &)
+    {
+        // the replica diverged from the leader, start over from a snapshot
+        lock_guard guard(offset_mx_);
+        applied_offset_.reset();
+        throw;
+    }
+    lock_guard guard(offset_mx_);
+    applied_offset_ = offset + entries.size();
+}
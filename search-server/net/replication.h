@@ -0,0 +1,145 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "../versioned_search_server.h"
+
+// Replication of a leader server to read-only followers. The leader logs
+// every applied ADD/REMOVE request under the generation of the index it
+// produced, so a log offset names a version of the index. A follower
+// connects with the offset it has applied and receives the log entries
+// after it; a follower without state, or one further behind than the log
+// keeps, first receives a snapshot of the index.
+//
+// The snapshot is the built index of SearchServer::SerializeIndex, which
+// the follower loads without tokenizing or indexing the texts again. It
+// includes the stop words, so a follower uses those of its leader.
+//
+//   follower -> SYNC <offset> | SYNC -
+//   leader   -> SNAPSHOT <offset> <byte count>
+//               <serialized index>                     (byte count bytes)
+//   leader   -> LOG <offset> <request>                 (from then on)
+//   follower -> ACK <offset>                           (after every batch)
+
+// Bounded in-memory log of the writes applied on the leader.
+class MutationLog
+{
+public:
+    using Entry = std::pair<uint64_t, std::string>;
+
+    // keeps at most retention entries
+    explicit MutationLog(size_t retention = 1 << 20);
+
+    // offsets are expected to follow each other; a gap restarts the log
+    void Append(uint64_t offset, std::string_view request);
+    uint64_t GetLastOffset() const;
+    // Appends at most max_count entries following offset to entries, waiting
+    // up to wait for the first one. Returns false if the entries following
+    // offset are no longer kept.
+    bool Read(
+        uint64_t offset,
+        size_t max_count,
+        std::chrono::milliseconds wait,
+        std::vector<Entry> &entries
+    ) const;
+
+private:
+    const size_t retention_;
+    mutable std::mutex mx_;
+    mutable std::condition_variable appended_;
+    std::deque<std::string> entries_;
+    // offset of entries_.front()
+    uint64_t first_offset_ = 1;
+};
+
+// Serves the log of a leader to followers, one thread per follower.
+class ReplicationLeader
+{
+public:
+    struct Follower {
+        std::string peer;
+        // last offset the follower reported as applied
+        std::optional<uint64_t> applied_offset;
+    };
+
+    ReplicationLeader(const VersionedSearchServer &search_server, const MutationLog &log);
+    ~ReplicationLeader();
+
+    ReplicationLeader(const ReplicationLeader &) = delete;
+    ReplicationLeader &operator=(const ReplicationLeader &) = delete;
+
+    // starts accepting followers in the background
+    void ListenTcp(uint16_t port);
+    std::vector<Follower> GetFollowers() const;
+
+private:
+    const VersionedSearchServer &search_server_;
+    const MutationLog &log_;
+    std::atomic<bool> is_stopping_{false};
+    int listen_fd_ = -1;
+    std::thread accept_thread_;
+
+    mutable std::mutex followers_mx_;
+    std::map<int, Follower> followers_;
+    std::map<std::thread::id, std::thread> follower_threads_;
+    // threads which served their follower and wait to be joined
+    std::vector<std::thread::id> finished_threads_;
+
+    void AcceptFollowers();
+    void ServeFollower(int fd);
+    // joins the threads of disconnected followers
+    void JoinFinishedThreads();
+    // sends the index of the current version, returns its offset
+    uint64_t SendSnapshot(int fd);
+    void ReadAcks(int fd, std::string &input);
+};
+
+// Keeps a read-only replica in sync with a leader, reconnecting when the
+// connection breaks.
+class ReplicationFollower
+{
+public:
+    ReplicationFollower(VersionedSearchServer &search_server, std::string leader_address);
+    ~ReplicationFollower();
+
+    ReplicationFollower(const ReplicationFollower &) = delete;
+    ReplicationFollower &operator=(const ReplicationFollower &) = delete;
+
+    // starts following in the background
+    void Start();
+    // offset of the leader version the replica holds, nullopt before the
+    // first snapshot
+    std::optional<uint64_t> GetAppliedOffset() const;
+
+private:
+    VersionedSearchServer &search_server_;
+    const std::string leader_address_;
+    std::atomic<bool> is_stopping_{false};
+    std::thread thread_;
+    // guards fd_ and the pause between connection attempts
+    std::mutex mx_;
+    std::condition_variable wake_up_;
+    int fd_ = -1;
+
+    mutable std::mutex offset_mx_;
+    std::optional<uint64_t> applied_offset_;
+
+    void Run();
+    // follows the leader until the connection breaks
+    void Follow(int fd);
+    // replaces the replica with the serialized index
+    void ApplySnapshot(uint64_t offset, std::string_view index);
+    void ApplyLog(const std::vector<MutationLog::Entry> &entries);
+};
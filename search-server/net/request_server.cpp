@@ -0,0 +1,389 @@
+#include "request_server.h"
+#include "protocol.h"
+#include "socket_utils.h"
+
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <exception>
+#include <system_error>
+
+using namespace std;
+using namespace std::literals;
+
+RequestServer::RequestServer(
+    VersionedSearchServer &search_server,
+    QueryExecutor &executor,
+    WritePolicy write_policy
+)
+    : search_server_(search_server),
+      executor_(executor),
+      write_policy_(write_policy),
+      epoll_fd_(epoll_create1(EPOLL_CLOEXEC)),
+      wake_fd_(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)),
+      spare_fd_(OpenSpareFd())
+{
+    if (epoll_fd_ < 0 || wake_fd_ < 0)
+    {
+        throw system_error(errno, generic_category(), "epoll"s);
+    }
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLET;
+    event.data.fd = wake_fd_;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wake_fd_, &event);
+}
+
+RequestServer::~RequestServer()
+{
+    is_stopping_ = true;
+    {
+        // the batches refer to this server and their connections
+        unique_lock lock(completions_mx_);
+        batch_completed_.wait(lock, [this] { return batches_in_flight_ == 0; });
+    }
+    for (auto &[fd, connection] : connections_)
+    {
+        close(fd);
+    }
+    for (int fd : listeners_)
+    {
+        close(fd);
+    }
+    if (spare_fd_ >= 0)
+    {
+        close(spare_fd_);
+    }
+    close(wake_fd_);
+    close(epoll_fd_);
+}
+
+void RequestServer::ListenTcp(uint16_t port)
+{
+    AddListener(::ListenTcp(port));
+}
+
+void RequestServer::ListenUnix(const std::string &path)
+{
+    AddListener(::ListenUnix(path));
+}
+
+void RequestServer::AddListener(int fd)
+{
+    SetNonBlocking(fd);
+    // level-triggered: connections left in the backlog after a failed
+    // accept are reported again instead of waiting for the next one
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event);
+    listeners_.push_back(fd);
+}
+
+void RequestServer::Run()
+{
+    vector<epoll_event> events(64);
+    while (!is_stopping_)
+    {
+        const int count = epoll_wait(epoll_fd_, events.data(), events.size(), -1);
+        if (count < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            throw system_error(errno, generic_category(), "epoll_wait"s);
+        }
+        for (int i = 0; i < count; ++i)
+        {
+            const int fd = events[i].data.fd;
+            if (fd == wake_fd_)
+            {
+                DrainCompletions();
+                continue;
+            }
+            if (find(listeners_.begin(), listeners_.end(), fd) != listeners_.end())
+            {
+                Accept(fd);
+                continue;
+            }
+            auto it = connections_.find(fd);
+            if (it == connections_.end())
+            {
+                continue;
+            }
+            Connection &connection = *it->second;
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+            {
+                Read(connection);
+            }
+            if (events[i].events & EPOLLOUT)
+            {
+                Flush(connection);
+            }
+            Dispatch(connection);
+            CloseIfDone(connection);
+        }
+    }
+}
+
+void RequestServer::Stop()
+{
+    is_stopping_ = true;
+    Wake();
+}
+
+void RequestServer::Wake()
+{
+    const uint64_t one = 1;
+    [[maybe_unused]] const ssize_t written = write(wake_fd_, &one, sizeof(one));
+}
+
+int RequestServer::OpenSpareFd()
+{
+    return open("/dev/null", O_RDONLY | O_CLOEXEC);
+}
+
+void RequestServer::Accept(int listener_fd)
+{
+    while (true)
+    {
+        const int fd = accept4(listener_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED)
+            {
+                continue;
+            }
+            if ((errno == EMFILE || errno == ENFILE) && RejectConnection(listener_fd))
+            {
+                continue;
+            }
+            // EAGAIN: the backlog is drained; otherwise the listener stays
+            // readable and the next Run iteration tries again
+            return;
+        }
+        auto connection = make_unique<Connection>();
+        connection->fd = fd;
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        event.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &event) != 0)
+        {
+            close(fd);
+            continue;
+        }
+        connections_[fd] = move(connection);
+    }
+}
+
+bool RequestServer::RejectConnection(int listener_fd)
+{
+    if (spare_fd_ < 0)
+    {
+        // another thread took the descriptor freed last time
+        spare_fd_ = OpenSpareFd();
+        return false;
+    }
+    close(spare_fd_);
+    const int fd = accept4(listener_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd >= 0)
+    {
+        close(fd);
+    }
+    spare_fd_ = OpenSpareFd();
+    return fd >= 0;
+}
+
+void RequestServer::Read(Connection &connection)
+{
+    char buffer[1 << 16];
+    while (!connection.is_read_closed)
+    {
+        if (connection.input.size() >= MAX_PENDING_INPUT)
+        {
+            if (connection.input.find('\n') == connection.input.npos)
+            {
+                // the request line can never be handed to a batch
+                connection.is_broken = true;
+            }
+            else if (!connection.is_read_paused)
+            {
+                SetReadPaused(connection, true);
+            }
+            return;
+        }
+        const ssize_t received = recv(connection.fd, buffer, sizeof(buffer), 0);
+        if (received > 0)
+        {
+            connection.input.append(buffer, received);
+        }
+        else if (received == 0)
+        {
+            connection.is_read_closed = true;
+            // the last request may come without a line break
+            if (!connection.input.empty() && connection.input.back() != '\n')
+            {
+                connection.input += '\n';
+            }
+        }
+        else if (errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                connection.is_broken = true;
+            }
+            return;
+        }
+    }
+}
+
+void RequestServer::SetReadPaused(Connection &connection, bool is_paused)
+{
+    epoll_event event{};
+    event.events = EPOLLOUT | EPOLLRDHUP | EPOLLET | (is_paused ? 0 : EPOLLIN);
+    event.data.fd = connection.fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, connection.fd, &event);
+    connection.is_read_paused = is_paused;
+}
+
+void RequestServer::Flush(Connection &connection)
+{
+    while (connection.output_offset < connection.output.size())
+    {
+        const ssize_t sent = send(
+            connection.fd,
+            connection.output.data() + connection.output_offset,
+            connection.output.size() - connection.output_offset,
+            MSG_NOSIGNAL
+        );
+        if (sent >= 0)
+        {
+            connection.output_offset += sent;
+        }
+        else if (errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                connection.is_broken = true;
+            }
+            return;
+        }
+    }
+    connection.output.clear();
+    connection.output_offset = 0;
+}
+
+void RequestServer::Dispatch(Connection &connection)
+{
+    if (
+        connection.is_busy
+        || connection.is_broken
+        || connection.output.size() - connection.output_offset > MAX_PENDING_OUTPUT
+    )
+    {
+        return;
+    }
+    const size_t batch_end = connection.input.rfind('\n');
+    if (batch_end == connection.input.npos)
+    {
+        return;
+    }
+    // the batch takes the whole buffer, only an incomplete last line goes back
+    swap(connection.batch, connection.input);
+    connection.input.assign(connection.batch, batch_end + 1);
+    connection.batch.resize(batch_end + 1);
+    connection.is_busy = true;
+    {
+        lock_guard guard(completions_mx_);
+        ++batches_in_flight_;
+    }
+    executor_.Submit([this, &connection](QueryContext &) {
+        vector<string_view> requests;
+        SplitLines(connection.batch, requests);
+        Completion completion{connection.fd, {}};
+        try
+        {
+            if (!is_stopping_)
+            {
+                HandleRequests(search_server_, requests, completion.output, write_policy_);
+            }
+        }
+        catch (const exception &error)
+        {
+            // keep one response per request even when the batch breaks down
+            completion.output.clear();
+            for (size_t i = 0; i < requests.size(); ++i)
+            {
+                AppendError(error.what(), completion.output);
+            }
+        }
+        // the server may be destroyed as soon as the count drops, so this
+        // is the last use of it
+        lock_guard guard(completions_mx_);
+        completions_.push_back(move(completion));
+        Wake();
+        --batches_in_flight_;
+        batch_completed_.notify_all();
+    });
+    if (connection.is_read_paused)
+    {
+        // at most an incomplete line is left, catch up with what arrived
+        // while paused
+        SetReadPaused(connection, false);
+        Read(connection);
+    }
+}
+
+void RequestServer::DrainCompletions()
+{
+    uint64_t value = 0;
+    while (read(wake_fd_, &value, sizeof(value)) > 0)
+    {
+    }
+    vector<Completion> completions;
+    {
+        lock_guard guard(completions_mx_);
+        swap(completions, completions_);
+    }
+    for (Completion &completion : completions)
+    {
+        Connection &connection = *connections_.at(completion.fd);
+        connection.is_busy = false;
+        connection.output += completion.output;
+        Flush(connection);
+        Dispatch(connection);
+        CloseIfDone(connection);
+    }
+}
+
+void RequestServer::CloseIfDone(Connection &connection)
+{
+    if (connection.is_busy)
+    {
+        return;
+    }
+    const bool is_finished = connection.is_read_closed
+        && connection.input.empty()
+        && connection.output.empty();
+    if (!is_finished && !connection.is_broken)
+    {
+        return;
+    }
+    const int fd = connection.fd;
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, fd, nullptr);
+    close(fd);
+    connections_.erase(fd);
+}
@@ -0,0 +1,108 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "protocol.h"
+#include "../query_executor.h"
+#include "../versioned_search_server.h"
+
+// Edge-triggered epoll front end serving the line protocol of protocol.h.
+// The event loop thread only moves bytes. All complete lines received on a
+// connection form a pipelined batch which runs on the executor. A
+// connection has at most one batch in flight, which keeps its responses in
+// request order. Requests are parsed in place as string_views into the
+// batch buffer. A connection stops being read while its unhandled input is
+// at the limit, so a client pipelining faster than its batches run is held
+// back by TCP flow control instead of growing the buffer.
+class RequestServer
+{
+public:
+    RequestServer(
+        VersionedSearchServer &search_server,
+        QueryExecutor &executor,
+        WritePolicy write_policy = {}
+    );
+    // waits for the batches in flight; the ones not started yet skip
+    // their requests
+    ~RequestServer();
+
+    RequestServer(const RequestServer &) = delete;
+    RequestServer &operator=(const RequestServer &) = delete;
+
+    void ListenTcp(uint16_t port);
+    void ListenUnix(const std::string &path);
+
+    // serves connections until Stop is called
+    void Run();
+    // may be called from any thread
+    void Stop();
+
+private:
+    struct Connection {
+        int fd = -1;
+        // bytes received and not yet handed to a batch
+        std::string input;
+        // requests of the batch in flight
+        std::string batch;
+        std::string output;
+        size_t output_offset = 0;
+        bool is_busy = false;
+        // EPOLLIN is off because input is at MAX_PENDING_INPUT
+        bool is_read_paused = false;
+        bool is_read_closed = false;
+        bool is_broken = false;
+    };
+
+    // responses of finished batches waiting for the event loop
+    struct Completion {
+        int fd;
+        std::string output;
+    };
+
+    // stop handing out batches while this much output is unsent
+    static constexpr size_t MAX_PENDING_OUTPUT = 1 << 20;
+    // stop reading while this much input waits for a batch, a longer
+    // request line breaks the connection
+    static constexpr size_t MAX_PENDING_INPUT = 1 << 20;
+
+    VersionedSearchServer &search_server_;
+    QueryExecutor &executor_;
+    const WritePolicy write_policy_;
+    int epoll_fd_ = -1;
+    int wake_fd_ = -1;
+    // kept open to be closed when the descriptors run out, see
+    // RejectConnection
+    int spare_fd_ = -1;
+    std::vector<int> listeners_;
+    std::unordered_map<int, std::unique_ptr<Connection>> connections_;
+    std::mutex completions_mx_;
+    std::vector<Completion> completions_;
+    // batches submitted and not completed, guarded by completions_mx_
+    size_t batches_in_flight_ = 0;
+    std::condition_variable batch_completed_;
+    std::atomic<bool> is_stopping_{false};
+
+    void AddListener(int fd);
+    void Accept(int listener_fd);
+    // Out of descriptors: accepts one connection on the spare descriptor
+    // and closes it, so that the client is refused instead of waiting in
+    // the backlog. Returns false if there was nothing to accept or no
+    // spare descriptor.
+    bool RejectConnection(int listener_fd);
+    static int OpenSpareFd();
+    void Read(Connection &connection);
+    // turns EPOLLIN of the connection off or back on
+    void SetReadPaused(Connection &connection, bool is_paused);
+    void Flush(Connection &connection);
+    void Dispatch(Connection &connection);
+    void DrainCompletions();
+    // closes the connection if nothing is left to do on it
+    void CloseIfDone(Connection &connection);
+    void Wake();
+};
@@ -0,0 +1,6 @@
+./search_server --unix /tmp/search_server.sock --stop-words "and with" &
+SERVER_PID=$!
+sleep 1
+printf 'ADD 1 ACTUAL 1,2 white cat and yellow hat\nADD 2 ACTUAL 3 curly cat curly tail\nFIND ACTUAL curly cat\nMATCH 1 white cat -tail\nREMOVE 1\nCOUNT\n' \
+    | ./search_client unix:/tmp/search_server.sock
+kill $SERVER_PID
@@ -0,0 +1,145 @@
+#include "protocol.h"
+#include "replication.h"
+#include "request_server.h"
+
+#include <csignal>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace {
+
+RequestServer *running_server = nullptr;
+
+void HandleStopSignal(int)
+{
+    if (running_server != nullptr)
+    {
+        running_server->Stop();
+    }
+}
+
+void PrintUsage()
+{
+    cerr << "Usage: search_server [--port <port>] [--unix <path>] [--threads <count>]\n"
+            "                     [--stop-words <words>] [--load <requests file>]\n"
+            "                     [--replication-port <port> | --follow <leader address>]\n"
+            "The requests file holds protocol lines, usually ADD requests.\n"
+            "A leader serves its writes to followers on the replication port; a\n"
+            "follower is read-only and takes its index, stop words included,\n"
+            "from the leader.\n";
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    int port = -1;
+    string unix_path;
+    string stop_words;
+    string load_path;
+    int replication_port = -1;
+    string leader_address;
+    QueryExecutor::Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const string arg = argv[i];
+        if (i + 1 >= argc)
+        {
+            PrintUsage();
+            return 1;
+        }
+        const string value = argv[++i];
+        if (arg == "--port")
+        {
+            port = stoi(value);
+        }
+        else if (arg == "--unix")
+        {
+            unix_path = value;
+        }
+        else if (arg == "--threads")
+        {
+            options.thread_count = stoul(value);
+        }
+        else if (arg == "--stop-words")
+        {
+            stop_words = value;
+        }
+        else if (arg == "--load")
+        {
+            load_path = value;
+        }
+        else if (arg == "--replication-port")
+        {
+            replication_port = stoi(value);
+        }
+        else if (arg == "--follow")
+        {
+            leader_address = value;
+        }
+        else
+        {
+            PrintUsage();
+            return 1;
+        }
+    }
+    if ((port < 0 && unix_path.empty()) || (replication_port >= 0 && !leader_address.empty()))
+    {
+        PrintUsage();
+        return 1;
+    }
+
+    auto executor = make_shared<QueryExecutor>(options);
+    SearchServer initial_server(stop_words);
+    initial_server.SetExecutor(executor);
+    VersionedSearchServer search_server(move(initial_server));
+    MutationLog log;
+    WritePolicy write_policy;
+    write_policy.is_read_only = !leader_address.empty();
+    if (replication_port >= 0)
+    {
+        write_policy.log = &log;
+    }
+    if (!load_path.empty())
+    {
+        ifstream input(load_path);
+        string content((istreambuf_iterator<char>(input)), istreambuf_iterator<char>());
+        content += '\n';
+        vector<string_view> requests;
+        SplitLines(content, requests);
+        string output;
+        HandleRequests(search_server, requests, output, WritePolicy{false, write_policy.log});
+        cerr << "Loaded "s << search_server.GetDocumentCount() << " documents"s << endl;
+    }
+
+    ReplicationLeader leader(search_server, log);
+    if (replication_port >= 0)
+    {
+        leader.ListenTcp(static_cast<uint16_t>(replication_port));
+    }
+    ReplicationFollower follower(search_server, leader_address);
+    if (!leader_address.empty())
+    {
+        follower.Start();
+    }
+
+    RequestServer server(search_server, *executor, write_policy);
+    if (port >= 0)
+    {
+        server.ListenTcp(static_cast<uint16_t>(port));
+    }
+    if (!unix_path.empty())
+    {
+        server.ListenUnix(unix_path);
+    }
+    running_server = &server;
+    signal(SIGINT, HandleStopSignal);
+    signal(SIGTERM, HandleStopSignal);
+    server.Run();
+    return 0;
+}
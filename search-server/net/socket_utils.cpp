@@ -0,0 +1,171 @@
+#include "socket_utils.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+[[noreturn]] void ThrowSystemError(const string &what)
+{
+    throw system_error(errno, generic_category(), what);
+}
+
+sockaddr_un MakeUnixAddress(const string &path)
+{
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path))
+    {
+        throw invalid_argument("Unix socket path is too long: "s + path);
+    }
+    strncpy(address.sun_path, path.c_str(), sizeof(address.sun_path) - 1);
+    return address;
+}
+
+}
+
+int ListenTcp(uint16_t port, int backlog)
+{
+    const int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        ThrowSystemError("socket"s);
+    }
+    const int enable = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+    if (bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) < 0
+        || listen(fd, backlog) < 0)
+    {
+        close(fd);
+        ThrowSystemError("listen on port "s + to_string(port));
+    }
+    return fd;
+}
+
+int ListenUnix(const std::string &path, int backlog)
+{
+    const sockaddr_un address = MakeUnixAddress(path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        ThrowSystemError("socket"s);
+    }
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0
+        || listen(fd, backlog) < 0)
+    {
+        close(fd);
+        ThrowSystemError("listen on "s + path);
+    }
+    return fd;
+}
+
+int ConnectTcp(const std::string &host, uint16_t port)
+{
+    addrinfo hints{};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo *addresses = nullptr;
+    const int error = getaddrinfo(host.c_str(), to_string(port).c_str(), &hints, &addresses);
+    if (error != 0)
+    {
+        throw runtime_error("Cannot resolve "s + host + ": "s + gai_strerror(error));
+    }
+    int fd = -1;
+    for (addrinfo *address = addresses; address != nullptr; address = address->ai_next)
+    {
+        fd = socket(address->ai_family, address->ai_socktype | SOCK_CLOEXEC, address->ai_protocol);
+        if (fd < 0)
+        {
+            continue;
+        }
+        if (connect(fd, address->ai_addr, address->ai_addrlen) == 0)
+        {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(addresses);
+    if (fd < 0)
+    {
+        ThrowSystemError("connect to "s + host + ':' + to_string(port));
+    }
+    const int enable = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+    return fd;
+}
+
+int ConnectUnix(const std::string &path)
+{
+    const sockaddr_un address = MakeUnixAddress(path);
+    const int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        ThrowSystemError("socket"s);
+    }
+    if (connect(fd, reinterpret_cast<const sockaddr *>(&address), sizeof(address)) < 0)
+    {
+        close(fd);
+        ThrowSystemError("connect to "s + path);
+    }
+    return fd;
+}
+
+int ConnectTo(const std::string &address)
+{
+    if (address.rfind("unix:"s, 0) == 0)
+    {
+        return ConnectUnix(address.substr(5));
+    }
+    const size_t colon = address.rfind(':');
+    if (colon == address.npos)
+    {
+        throw invalid_argument("Address must be unix:<path> or <host>:<port>"s);
+    }
+    return ConnectTcp(address.substr(0, colon), static_cast<uint16_t>(stoi(address.substr(colon + 1))));
+}
+
+void SetNonBlocking(int fd)
+{
+    const int flags = fcntl(fd, F_GETFL, 0);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        ThrowSystemError("fcntl"s);
+    }
+}
+
+void WriteAll(int fd, std::string_view data)
+{
+    while (!data.empty())
+    {
+        const ssize_t written = send(fd, data.data(), data.size(), MSG_NOSIGNAL);
+        if (written < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            ThrowSystemError("send"s);
+        }
+        data.remove_prefix(written);
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Thin wrappers over the BSD socket calls; failures throw std::system_error.
+
+int ListenTcp(uint16_t port, int backlog = 128);
+// removes a stale socket file at path first
+int ListenUnix(const std::string &path, int backlog = 128);
+int ConnectTcp(const std::string &host, uint16_t port);
+int ConnectUnix(const std::string &path);
+// connects to "unix:<path>" or "<host>:<port>"
+int ConnectTo(const std::string &address);
+
+void SetNonBlocking(int fd);
+// blocks until all of data is written
+void WriteAll(int fd, std::string_view data);
@@ -0,0 +1,61 @@
+# Writes through a coordinator must reach every replica of a partition.
+# Starts two replicas of one partition behind a coordinator, adds and
+# removes documents through it, then asks each replica directly. Then a
+# follower must load the index of its leader and apply the later writes.
+# Run from net after compile.sh.
+set -e
+DIR=$(mktemp -d)
+./search_server --unix $DIR/a.sock &
+A_PID=$!
+./search_server --unix $DIR/b.sock &
+B_PID=$!
+# a hedged write would reach the second replica only if the first one is
+# slower than the hedge delay
+./search_coordinator --unix $DIR/coordinator.sock --backend unix:$DIR/a.sock,unix:$DIR/b.sock &
+COORDINATOR_PID=$!
+trap 'kill $A_PID $B_PID $COORDINATOR_PID 2>/dev/null || true; rm -rf $DIR' EXIT
+sleep 1
+
+RESPONSES=$(printf 'ADD 1 ACTUAL 1 white cat\nADD 2 ACTUAL 2 curly cat\nREMOVE 1\nREMOVE 1\n' \
+    | ./search_client unix:$DIR/coordinator.sock)
+EXPECTED=$(printf 'OK\nOK\nOK\nERR Invalid document_id')
+if [ "$RESPONSES" != "$EXPECTED" ]; then
+    echo "coordinator answered:"; echo "$RESPONSES"
+    exit 1
+fi
+for REPLICA in a b; do
+    RESPONSES=$(printf 'COUNT\nMATCH 2 curly\n' | ./search_client unix:$DIR/$REPLICA.sock)
+    if [ "$RESPONSES" != "$(printf 'OK 1\nOK ACTUAL curly')" ]; then
+        echo "replica $REPLICA answered:"; echo "$RESPONSES"
+        exit 1
+    fi
+done
+
+# a write is acknowledged only if every replica applied it
+kill $B_PID
+wait $B_PID 2>/dev/null || true
+RESPONSE=$(printf 'ADD 3 ACTUAL 3 grey dog\n' | ./search_client unix:$DIR/coordinator.sock)
+case "$RESPONSE" in
+    ERR*) ;;
+    *) echo "write with a replica down answered: $RESPONSE"; exit 1 ;;
+esac
+
+# the follower uses the stop words of the leader, not its own
+printf 'ADD 1 ACTUAL 1 white cat and hat\nADD 2 BANNED 2 curly cat\nADD 3 ACTUAL 3 grey dog\nREMOVE 3\n' > $DIR/load.txt
+REPLICATION_PORT=$((20000 + $$ % 20000))
+./search_server --unix $DIR/leader.sock --stop-words and --load $DIR/load.txt \
+    --replication-port $REPLICATION_PORT &
+LEADER_PID=$!
+sleep 1
+./search_server --unix $DIR/follower.sock --stop-words cat --follow 127.0.0.1:$REPLICATION_PORT &
+FOLLOWER_PID=$!
+trap 'kill $A_PID $COORDINATOR_PID $LEADER_PID $FOLLOWER_PID 2>/dev/null || true; rm -rf $DIR' EXIT
+sleep 1
+printf 'ADD 4 ACTUAL 4 yellow cat\n' | ./search_client unix:$DIR/leader.sock > /dev/null
+sleep 1
+RESPONSES=$(printf 'COUNT\nMATCH 1 cat and hat\nMATCH 2 curly\nMATCH 4 cat\n' | ./search_client unix:$DIR/follower.sock)
+if [ "$RESPONSES" != "$(printf 'OK 3\nOK ACTUAL cat hat\nOK BANNED curly\nOK ACTUAL cat')" ]; then
+    echo "follower answered:"; echo "$RESPONSES"
+    exit 1
+fi
+echo "OK"
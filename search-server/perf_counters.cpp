@@ -0,0 +1,194 @@
+#include "perf_counters.h"
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <cstring>
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+#ifdef __linux__
+
+struct EventConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+constexpr uint64_t CacheMiss(uint64_t cache)
+{
+    return cache
+        | (static_cast<uint64_t>(PERF_COUNT_HW_CACHE_OP_READ) << 8)
+        | (static_cast<uint64_t>(PERF_COUNT_HW_CACHE_RESULT_MISS) << 16);
+}
+
+// in the order of PerfEvent
+constexpr array<EventConfig, PERF_EVENT_COUNT> EVENT_CONFIGS = {{
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_L1D)},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {PERF_TYPE_HW_CACHE, CacheMiss(PERF_COUNT_HW_CACHE_DTLB)},
+}};
+
+int OpenEvent(const EventConfig &event_config)
+{
+    perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = event_config.type;
+    attr.config = event_config.config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    // the calling thread on any cpu
+    return static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC));
+}
+
+#endif
+
+}
+
+string_view GetPerfEventName(PerfEvent event)
+{
+    switch (event)
+    {
+    case PerfEvent::CYCLES:
+        return "cycles"sv;
+    case PerfEvent::INSTRUCTIONS:
+        return "instructions"sv;
+    case PerfEvent::L1D_MISSES:
+        return "l1d_misses"sv;
+    case PerfEvent::LLC_MISSES:
+        return "llc_misses"sv;
+    case PerfEvent::BRANCH_MISSES:
+        return "branch_misses"sv;
+    case PerfEvent::DTLB_MISSES:
+        return "dtlb_misses"sv;
+    }
+    return "unknown"sv;
+}
+
+bool PerfCounts::Has(PerfEvent event) const
+{
+    return (available >> static_cast<size_t>(event)) & 1;
+}
+
+uint64_t PerfCounts::Get(PerfEvent event) const
+{
+    return values[static_cast<size_t>(event)];
+}
+
+PerfCounts &PerfCounts::operator+=(const PerfCounts &other)
+{
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i)
+    {
+        values[i] += other.values[i];
+    }
+    available |= other.available;
+    return *this;
+}
+
+PerfCounts &PerfCounts::operator-=(const PerfCounts &other)
+{
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i)
+    {
+        // scaled counts of multiplexed events may step back a little
+        values[i] = values[i] > other.values[i] ? values[i] - other.values[i] : 0;
+    }
+    available &= other.available;
+    return *this;
+}
+
+PerfCounts operator-(PerfCounts lhs, const PerfCounts &rhs)
+{
+    lhs -= rhs;
+    return lhs;
+}
+
+ostream &operator<<(ostream &os, const PerfCounts &counts)
+{
+    os << "{ "s;
+    bool is_first = true;
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i)
+    {
+        const auto event = static_cast<PerfEvent>(i);
+        if (!counts.Has(event))
+        {
+            continue;
+        }
+        os << (is_first ? ""s : ", "s) << GetPerfEventName(event) << " = "s << counts.Get(event);
+        is_first = false;
+    }
+    return os << (is_first ? "}"s : " }"s);
+}
+
+PerfCounters::PerfCounters()
+{
+    fds_.fill(-1);
+#ifdef __linux__
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i)
+    {
+        fds_[i] = OpenEvent(EVENT_CONFIGS[i]);
+    }
+#endif
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (int fd : fds_)
+    {
+        if (fd >= 0)
+        {
+            close(fd);
+        }
+    }
+#endif
+}
+
+bool PerfCounters::IsAvailable() const
+{
+    for (int fd : fds_)
+    {
+        if (fd >= 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+PerfCounts PerfCounters::Read() const
+{
+    PerfCounts counts;
+#ifdef __linux__
+    for (size_t i = 0; i < PERF_EVENT_COUNT; ++i)
+    {
+        // value, time enabled, time running
+        uint64_t data[3];
+        if (fds_[i] < 0 || read(fds_[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data)) || data[2] == 0)
+        {
+            continue;
+        }
+        counts.values[i] = data[2] == data[1]
+            ? data[0]
+            : static_cast<uint64_t>(static_cast<double>(data[0]) * data[1] / data[2]);
+        counts.available |= 1u << i;
+    }
+#endif
+    return counts;
+}
+
+PerfCounters &GetThreadPerfCounters()
+{
+    thread_local PerfCounters counters;
+    return counters;
+}
@@ -0,0 +1,88 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string_view>
+
+enum class PerfEvent {
+    CYCLES,
+    INSTRUCTIONS,
+    L1D_MISSES,
+    LLC_MISSES,
+    BRANCH_MISSES,
+    DTLB_MISSES,
+};
+
+inline constexpr size_t PERF_EVENT_COUNT = 6;
+
+std::string_view GetPerfEventName(PerfEvent event);
+
+// Hardware event counts. An event the kernel or the CPU does not provide
+// is marked unavailable instead of being reported as 0.
+struct PerfCounts {
+    std::array<uint64_t, PERF_EVENT_COUNT> values{};
+    // bit i is set if the count of event i is valid
+    uint32_t available = 0;
+
+    bool Has(PerfEvent event) const;
+    uint64_t Get(PerfEvent event) const;
+
+    // sums keep the events available in either, so an empty PerfCounts
+    // accumulates anything; differences keep those available in both
+    PerfCounts &operator+=(const PerfCounts &other);
+    PerfCounts &operator-=(const PerfCounts &other);
+};
+
+PerfCounts operator-(PerfCounts lhs, const PerfCounts &rhs);
+
+// { cycles = ..., instructions = ..., ... }, unavailable events omitted
+std::ostream &operator<<(std::ostream &os, const PerfCounts &counts);
+
+// Counters of the calling thread read through perf_event_open. The events
+// count user-space work of the thread that opened them only, so work done
+// by pool threads (e.g. execution::par) is not included. Counters are
+// unavailable when perf_event_open is missing or refused, for example
+// under a high kernel.perf_event_paranoid or in a container.
+class PerfCounters
+{
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool IsAvailable() const;
+    // counts since the counters were opened, scaled up for the time the
+    // kernel multiplexed them out
+    PerfCounts Read() const;
+
+private:
+    std::array<int, PERF_EVENT_COUNT> fds_;
+};
+
+// counters of the calling thread, opened on first use
+PerfCounters &GetThreadPerfCounters();
+
+// adds the counts of the calling thread during the lifetime of the scope
+// to counts; scopes may be nested
+class PerfScope
+{
+public:
+    explicit PerfScope(PerfCounts &counts)
+        : counts_(counts), counters_(GetThreadPerfCounters()), start_(counters_.Read()) {}
+
+    ~PerfScope()
+    {
+        counts_ += counters_.Read() - start_;
+    }
+
+    PerfScope(const PerfScope &) = delete;
+    PerfScope &operator=(const PerfScope &) = delete;
+
+private:
+    PerfCounts &counts_;
+    const PerfCounters &counters_;
+    const PerfCounts start_;
+};
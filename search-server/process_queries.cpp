@@ -1,18 +1,112 @@
 #include "process_queries.h"
-#include <list>
-#include  <iterator>
+#include "read_input_functions.h"
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <numeric>
+
+namespace {
+
+// queries of one pipeline window together with their results
+struct QueryWindow {
+    size_t first_index = 0;
+    std::vector<std::string> queries;
+    std::vector<std::vector<Document>> documents_lists;
+};
+
+struct WindowSearch {
+    std::atomic<size_t> remaining{0};
+    std::mutex mx;
+    std::exception_ptr error;
+    std::promise<void> done;
+};
+
+void ReadWindow(
+    const QuerySource& source,
+    size_t first_index,
+    size_t window_size,
+    QueryWindow& window
+) {
+    window.first_index = first_index;
+    window.queries.resize(window_size);
+    size_t size = 0;
+    while (size < window_size && source(window.queries[size])) {
+        ++size;
+    }
+    window.queries.resize(size);
+}
+
+// searches the window on the executor without waiting for the results
+std::future<void> StartWindowSearch(
+    const SearchServer& search_server,
+    QueryWindow& window
+) {
+    QueryExecutor& executor = search_server.GetExecutor();
+    const size_t count = window.queries.size();
+    const size_t grain_size = executor.GetGrainSize();
+    window.documents_lists.resize(count);
+
+    auto search = std::make_shared<WindowSearch>();
+    std::future<void> result = search->done.get_future();
+    search->remaining = (count + grain_size - 1) / grain_size;
+    if (count == 0) {
+        search->done.set_value();
+        return result;
+    }
+    for (size_t first = 0; first < count; first += grain_size) {
+        const size_t last = std::min(count, first + grain_size);
+        executor.Submit(
+            [&search_server, &window, search, first, last](QueryContext& context) {
+                try {
+                    for (size_t index = first; index < last; ++index) {
+                        window.documents_lists[index] = search_server.FindTopDocuments(
+                            context, window.queries[index]
+                        );
+                    }
+                } catch (...) {
+                    std::lock_guard guard(search->mx);
+                    if (!search->error) {
+                        search->error = std::current_exception();
+                    }
+                }
+                if (search->remaining.fetch_sub(1) == 1) {
+                    if (search->error) {
+                        search->done.set_exception(search->error);
+                    } else {
+                        search->done.set_value();
+                    }
+                }
+            }
+        );
+    }
+    return result;
+}
+
+void EmitWindow(const QueryWindow& window, const ResultSink& sink) {
+    for (size_t i = 0; i < window.queries.size(); ++i) {
+        sink(window.first_index + i, window.queries[i], window.documents_lists[i]);
+    }
+}
+
+}
 
 std::vector<std::vector<Document>> ProcessQueries(
     const SearchServer& search_server,
     const std::vector<std::string>& queries
 ) {
+    LOG_LATENCY(LatencyOperation::PROCESS_QUERIES);
+    TRACE_SCOPE("ProcessQueries");
     std::vector<std::vector<Document>> documents_lists(queries.size());
-    std::transform(
-        std::execution::par,
-        queries.begin(), queries.end(),
-        documents_lists.begin(),
-        [&search_server](const std::string &s) {
-            return search_server.FindTopDocuments(s);
+    search_server.GetExecutor().ParallelFor(
+        queries.size(),
+        [&](QueryContext &context, size_t index) {
+            documents_lists[index] = search_server.FindTopDocuments(
+                context, queries[index]
+            );
         }
     );
     return documents_lists;
@@ -23,43 +117,99 @@ std::vector<Document> ProcessQueriesJoined(
     const std::vector<std::string>& queries
 )
 {
-    std::vector<std::vector<Document>> response = ProcessQueries(search_server,queries);
-    std::vector<Document> result;
-    result = std::accumulate(
-        response.begin(),
-        response.end(),
-        decltype(response)::value_type{},
-        [](auto &acc, auto &items) {
-            acc.insert(acc.end(), items.begin(), items.end());
-            return acc;
+    const std::vector<std::vector<Document>> documents_lists = ProcessQueries(
+        search_server, queries
+    );
+    // offsets[i] is the position of the i-th list in the joined result
+    std::vector<size_t> offsets(documents_lists.size() + 1, 0);
+    std::transform_inclusive_scan(
+        documents_lists.begin(), documents_lists.end(),
+        std::next(offsets.begin()),
+        std::plus<>{},
+        [](const std::vector<Document>& documents) {
+            return documents.size();
         }
     );
-    /*std::for_each(
-        std::execution::par,
-        response.begin(),
-        response.end(),
-        [&result](const std::vector<Document>& docs){
-            std::copy(
-                docs.begin(),
-                docs.end(),
-                std::back_inserter(result)
-            );
-            //result.insert(
-            //    result.end(), 
-            //    docs.begin(), 
-            //    docs.end()
-            //);
+    std::vector<Document> result(offsets.back());
+    QueryExecutor& executor = search_server.GetExecutor();
+    const size_t chunk_count = executor.GetThreadCount();
+    const size_t chunk_size = (documents_lists.size() + chunk_count - 1) / chunk_count;
+    executor.ParallelFor(
+        chunk_count,
+        [&](QueryContext&, size_t chunk) {
+            TRACE_SCOPE("merge");
+            const size_t first = std::min(chunk * chunk_size, documents_lists.size());
+            const size_t last = std::min(first + chunk_size, documents_lists.size());
+            for (size_t index = first; index < last; ++index) {
+                std::copy(
+                    documents_lists[index].begin(),
+                    documents_lists[index].end(),
+                    result.begin() + offsets[index]
+                );
+            }
         }
-    );*/
+    );
     return result;
-   // std::list<Document> result;
-    /*std::reduce(
-        std::execution::par,
-        response.begin(), response.end(),
-        result.begin(),
-        [&search_server](const std::vector<Document> &resp) {
-            //return search_server.FindTopDocuments(s);
-            a.insert(a.end(), resp.begin(), resp.end());
+}
+
+size_t ProcessQueriesStream(
+    const SearchServer& search_server,
+    const QuerySource& source,
+    const ResultSink& sink,
+    size_t window_size
+)
+{
+    if (window_size == 0) {
+        window_size = 64 * search_server.GetExecutor().GetThreadCount();
+    }
+    // the search tasks keep references to the windows, so the two windows
+    // only exchange their roles and are never moved
+    QueryWindow windows[2];
+    size_t current = 0;
+    ReadWindow(source, 0, window_size, windows[current]);
+    std::future<void> current_search = StartWindowSearch(search_server, windows[current]);
+    while (!windows[current].queries.empty()) {
+        QueryWindow& next = windows[1 - current];
+        const size_t next_index = windows[current].first_index + windows[current].queries.size();
+        if (windows[current].queries.size() == window_size) {
+            try {
+                ReadWindow(source, next_index, window_size, next);
+            } catch (...) {
+                current_search.wait();
+                throw;
+            }
+        } else {
+            next.first_index = next_index;
+            next.queries.clear();
+        }
+        current_search.get();
+        std::future<void> next_search = StartWindowSearch(search_server, next);
+        try {
+            EmitWindow(windows[current], sink);
+        } catch (...) {
+            next_search.wait();
+            throw;
         }
-    );*/
+        current = 1 - current;
+        current_search = std::move(next_search);
+    }
+    current_search.get();
+    return windows[current].first_index;
+}
+
+size_t ProcessQueriesStream(
+    const SearchServer& search_server,
+    std::istream& input,
+    const ResultSink& sink,
+    size_t window_size
+)
+{
+    return ProcessQueriesStream(
+        search_server,
+        [&input](std::string& query) {
+            return ReadLine(input, query);
+        },
+        sink,
+        window_size
+    );
 }
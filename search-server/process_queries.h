@@ -1,6 +1,9 @@
+#pragma once
 #include <vector>
 #include <string>
 #include <execution>
+#include <functional>
+#include <istream>
 #include <list>
 
 #include "document.h"
@@ -16,3 +19,34 @@ std::vector<Document> ProcessQueriesJoined(
     const SearchServer& search_server,
     const std::vector<std::string>& queries
 ); 
+
+
+// stores the next query into its argument, returns false when there are no more
+using QuerySource = std::function<bool(std::string&)>;
+// receives the results of the query with the given number
+using ResultSink = std::function<void(
+    size_t index,
+    const std::string& query,
+    const std::vector<Document>& documents
+)>;
+
+// Streams queries through a read -> search -> emit pipeline. At most two
+// windows of window_size queries are held at once: one is searched on the
+// executor while the next one is read and the previous one is emitted.
+// Results reach the sink in input order; a slow sink stalls the reading.
+// window_size 0 picks a size from the executor thread count.
+// Returns the number of processed queries.
+size_t ProcessQueriesStream(
+    const SearchServer& search_server,
+    const QuerySource& source,
+    const ResultSink& sink,
+    size_t window_size = 0
+);
+
+// reads one query per line
+size_t ProcessQueriesStream(
+    const SearchServer& search_server,
+    std::istream& input,
+    const ResultSink& sink,
+    size_t window_size = 0
+);
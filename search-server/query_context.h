@@ -0,0 +1,35 @@
+#pragma once
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "document.h"
+#include "query_stats.h"
+
+class CancellationToken;
+
+// Statistics of a corpus the searched index is a part of, used to keep
+// IDF and the BM25 length normalization equal to those of a single index
+// over the whole corpus.
+struct CorpusStatistics {
+    int document_count = 0;
+    // sum of SearchServer::GetTotalDocumentLength over the corpus
+    double total_length = 0;
+    // number of documents of the corpus containing the word
+    std::function<int(std::string_view word)> document_freq;
+};
+
+// Scratch buffers of a single search. A context is reused by the queries
+// running one after another on the same thread, so their buffers keep the
+// capacity grown by previous queries instead of being reallocated.
+struct QueryContext {
+    std::unordered_map<int, double> document_to_relevance;
+    std::vector<Document> matched_documents;
+    // checked while the search runs, nullptr if it cannot be cancelled
+    const CancellationToken *cancellation = nullptr;
+    // IDF source, nullptr to use the statistics of the searched index
+    const CorpusStatistics *corpus = nullptr;
+    // receives the work done by the search, nullptr to skip counting
+    QueryStats *stats = nullptr;
+};
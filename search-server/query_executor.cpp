@@ -0,0 +1,216 @@
+#include "query_executor.h"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+// index of the executor worker running on this thread, if any
+thread_local const QueryExecutor *current_executor = nullptr;
+thread_local size_t current_worker_index = 0;
+
+size_t DefaultThreadCount()
+{
+    return max<size_t>(1, thread::hardware_concurrency());
+}
+}
+
+QueryCancelled::QueryCancelled()
+    : runtime_error("Query was cancelled"s)
+{
+}
+
+CancellationToken::CancellationToken()
+    : cancelled_(make_shared<atomic<bool>>(false))
+{
+}
+
+void CancellationToken::Cancel()
+{
+    *cancelled_ = true;
+}
+
+bool CancellationToken::IsCancelled() const
+{
+    return cancelled_->load();
+}
+
+void CancellationToken::ThrowIfCancelled() const
+{
+    if (IsCancelled())
+    {
+        throw QueryCancelled();
+    }
+}
+
+QueryExecutor::QueryExecutor()
+    : QueryExecutor(Options{})
+{
+}
+
+QueryExecutor::QueryExecutor(Options options)
+    : options_(options),
+      grain_size_(max<size_t>(1, options.grain_size))
+{
+    const size_t thread_count = options_.thread_count == 0
+        ? DefaultThreadCount()
+        : options_.thread_count;
+    workers_.reserve(thread_count);
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        workers_.push_back(make_unique<Worker>());
+    }
+}
+
+QueryExecutor::~QueryExecutor()
+{
+    {
+        lock_guard guard(sleep_mx_);
+        stopping_ = true;
+    }
+    wake_up_.notify_all();
+    for (thread &worker_thread : threads_)
+    {
+        worker_thread.join();
+    }
+}
+
+size_t QueryExecutor::GetThreadCount() const
+{
+    return workers_.size();
+}
+
+size_t QueryExecutor::GetGrainSize() const
+{
+    return grain_size_.load();
+}
+
+void QueryExecutor::SetGrainSize(size_t grain_size)
+{
+    grain_size_ = max<size_t>(1, grain_size);
+}
+
+void QueryExecutor::Submit(Task task)
+{
+    call_once(start_flag_, [this] { Start(); });
+    const size_t worker_index = current_executor == this
+        ? current_worker_index
+        : next_worker_.fetch_add(1) % workers_.size();
+    Push(worker_index, move(task));
+    {
+        lock_guard guard(sleep_mx_);
+    }
+    wake_up_.notify_one();
+}
+
+void QueryExecutor::Start()
+{
+    threads_.reserve(workers_.size());
+    for (size_t i = 0; i < workers_.size(); ++i)
+    {
+        threads_.emplace_back([this, i] { WorkerLoop(i); });
+    }
+}
+
+void QueryExecutor::Push(size_t worker_index, Task task)
+{
+    Worker &worker = *workers_[worker_index];
+    lock_guard guard(worker.mx_);
+    worker.tasks_.push_back(move(task));
+    ++queued_;
+}
+
+void QueryExecutor::PushBatch(std::vector<Task> tasks)
+{
+    call_once(start_flag_, [this] { Start(); });
+    const size_t first_worker = next_worker_.fetch_add(1);
+    for (size_t i = 0; i < tasks.size(); ++i)
+    {
+        Push((first_worker + i) % workers_.size(), move(tasks[i]));
+    }
+    {
+        lock_guard guard(sleep_mx_);
+    }
+    wake_up_.notify_all();
+}
+
+bool QueryExecutor::PopOwn(size_t worker_index, Task &task)
+{
+    Worker &worker = *workers_[worker_index];
+    lock_guard guard(worker.mx_);
+    if (worker.tasks_.empty())
+    {
+        return false;
+    }
+    task = move(worker.tasks_.front());
+    worker.tasks_.pop_front();
+    --queued_;
+    return true;
+}
+
+bool QueryExecutor::Steal(size_t thief_index, Task &task)
+{
+    const size_t worker_count = workers_.size();
+    for (size_t shift = 1; shift <= worker_count; ++shift)
+    {
+        const size_t victim_index = (thief_index + shift) % worker_count;
+        if (victim_index == thief_index)
+        {
+            continue;
+        }
+        Worker &victim = *workers_[victim_index];
+        lock_guard guard(victim.mx_);
+        if (victim.tasks_.empty())
+        {
+            continue;
+        }
+        task = move(victim.tasks_.back());
+        victim.tasks_.pop_back();
+        --queued_;
+        return true;
+    }
+    return false;
+}
+
+void QueryExecutor::WorkerLoop(size_t worker_index)
+{
+#ifdef __linux__
+    if (options_.pin_threads)
+    {
+        const unsigned cpu_count = max(1u, thread::hardware_concurrency());
+        cpu_set_t cpu_set;
+        CPU_ZERO(&cpu_set);
+        CPU_SET(worker_index % cpu_count, &cpu_set);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+    }
+#endif
+    current_executor = this;
+    current_worker_index = worker_index;
+    QueryContext &context = workers_[worker_index]->context_;
+    while (true)
+    {
+        Task task;
+        if (PopOwn(worker_index, task) || Steal(worker_index, task))
+        {
+            try
+            {
+                task(context);
+            }
+            catch (...)
+            {
+                // a submitted task has nobody to report to
+            }
+            continue;
+        }
+        unique_lock lock(sleep_mx_);
+        wake_up_.wait(lock, [this] { return stopping_ || queued_.load() > 0; });
+        if (stopping_ && queued_.load() == 0)
+        {
+            return;
+        }
+    }
+}
@@ -0,0 +1,179 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "query_context.h"
+
+// thrown by a search whose CancellationToken was cancelled
+class QueryCancelled : public std::runtime_error
+{
+public:
+    QueryCancelled();
+};
+
+// Shared flag through which the submitter cancels a queued or running search.
+// Copies of a token refer to the same flag.
+class CancellationToken
+{
+public:
+    CancellationToken();
+
+    void Cancel();
+    bool IsCancelled() const;
+    void ThrowIfCancelled() const;
+
+private:
+    std::shared_ptr<std::atomic<bool>> cancelled_;
+};
+
+// Work-stealing thread pool for search tasks. Every worker owns a task deque
+// and a QueryContext reused by all tasks it runs. A worker takes tasks from
+// the front of its own deque and, when it runs dry, steals from the back of
+// the others, so a single expensive task never holds up queued ones.
+// Threads are started on first use.
+class QueryExecutor
+{
+public:
+    using Task = std::function<void(QueryContext &)>;
+
+    struct Options {
+        // 0 means std::thread::hardware_concurrency()
+        size_t thread_count = 0;
+        // number of consecutive indexes handled by one ParallelFor task
+        size_t grain_size = 1;
+        // bind worker i to cpu i, ignored where unsupported
+        bool pin_threads = false;
+    };
+
+    QueryExecutor();
+    explicit QueryExecutor(Options options);
+    ~QueryExecutor();
+
+    QueryExecutor(const QueryExecutor &) = delete;
+    QueryExecutor &operator=(const QueryExecutor &) = delete;
+
+    size_t GetThreadCount() const;
+    size_t GetGrainSize() const;
+    void SetGrainSize(size_t grain_size);
+
+    // runs task on one of the workers, does not wait for it
+    void Submit(Task task);
+
+    // calls func(context, index) for every index in [0, count) and waits;
+    // the calling thread helps to run the tasks. The first exception thrown
+    // by func is rethrown after all tasks have finished.
+    template <typename Func>
+    void ParallelFor(size_t count, Func func);
+
+private:
+    struct Worker {
+        std::mutex mx_;
+        std::deque<Task> tasks_;
+        QueryContext context_;
+    };
+
+    struct Batch {
+        std::atomic<size_t> remaining{0};
+        std::mutex mx_;
+        std::condition_variable done_;
+        std::exception_ptr error;
+    };
+
+    const Options options_;
+    std::atomic<size_t> grain_size_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+    std::once_flag start_flag_;
+
+    std::mutex sleep_mx_;
+    std::condition_variable wake_up_;
+    std::atomic<size_t> queued_{0};
+    std::atomic<size_t> next_worker_{0};
+    bool stopping_ = false;
+
+    void Start();
+    void Push(size_t worker_index, Task task);
+    void PushBatch(std::vector<Task> tasks);
+    bool PopOwn(size_t worker_index, Task &task);
+    bool Steal(size_t thief_index, Task &task);
+    void WorkerLoop(size_t worker_index);
+};
+
+template <typename Func>
+void QueryExecutor::ParallelFor(size_t count, Func func)
+{
+    if (count == 0)
+    {
+        return;
+    }
+    const size_t grain_size = std::max<size_t>(1, grain_size_.load());
+    const size_t task_count = (count + grain_size - 1) / grain_size;
+    auto batch = std::make_shared<Batch>();
+    batch->remaining = task_count;
+
+    std::vector<Task> tasks;
+    tasks.reserve(task_count);
+    for (size_t first = 0; first < count; first += grain_size)
+    {
+        const size_t last = std::min(count, first + grain_size);
+        tasks.push_back(
+            [batch, &func, first, last](QueryContext &context) {
+                try
+                {
+                    for (size_t index = first; index < last; ++index)
+                    {
+                        func(context, index);
+                    }
+                }
+                catch (...)
+                {
+                    std::lock_guard guard(batch->mx_);
+                    if (!batch->error)
+                    {
+                        batch->error = std::current_exception();
+                    }
+                }
+                if (batch->remaining.fetch_sub(1) == 1)
+                {
+                    std::lock_guard guard(batch->mx_);
+                    batch->done_.notify_all();
+                }
+            }
+        );
+    }
+    PushBatch(std::move(tasks));
+
+    QueryContext context;
+    while (batch->remaining.load() > 0)
+    {
+        Task task;
+        if (Steal(workers_.size(), task))
+        {
+            try
+            {
+                task(context);
+            }
+            catch (...)
+            {
+                // tasks of this batch keep their errors in the batch
+            }
+            continue;
+        }
+        std::unique_lock lock(batch->mx_);
+        batch->done_.wait(lock, [&batch] { return batch->remaining.load() == 0; });
+    }
+    if (batch->error)
+    {
+        std::rethrow_exception(batch->error);
+    }
+}
@@ -0,0 +1,33 @@
+#include "query_stats.h"
+
+using namespace std;
+
+QueryStats &QueryStats::operator+=(const QueryStats &other)
+{
+    terms_resolved += other.terms_resolved;
+    postings_scanned += other.postings_scanned;
+    predicate_evaluations += other.predicate_evaluations;
+    documents_scored += other.documents_scored;
+    documents_excluded += other.documents_excluded;
+    candidates_sorted += other.candidates_sorted;
+    parse_time += other.parse_time;
+    scan_time += other.scan_time;
+    filter_time += other.filter_time;
+    top_k_time += other.top_k_time;
+    return *this;
+}
+
+std::ostream &operator<<(std::ostream &os, const QueryStats &stats)
+{
+    os << "{ terms_resolved = "s << stats.terms_resolved
+       << ", postings_scanned = "s << stats.postings_scanned
+       << ", predicate_evaluations = "s << stats.predicate_evaluations
+       << ", documents_scored = "s << stats.documents_scored
+       << ", documents_excluded = "s << stats.documents_excluded
+       << ", candidates_sorted = "s << stats.candidates_sorted
+       << ", parse = "s << stats.parse_time.count()
+       << " ns, scan = "s << stats.scan_time.count()
+       << " ns, filter = "s << stats.filter_time.count()
+       << " ns, top_k = "s << stats.top_k_time.count() << " ns }"s;
+    return os;
+}
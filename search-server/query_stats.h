@@ -0,0 +1,60 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+
+// Work done by searches, filled in when QueryContext::stats is set.
+// Counters are added to, so one QueryStats may sum a series of searches.
+struct QueryStats {
+    // query words found in the index
+    uint64_t terms_resolved = 0;
+    // postings of the plus words visited
+    uint64_t postings_scanned = 0;
+    uint64_t predicate_evaluations = 0;
+    // documents that got a relevance before the minus words were applied
+    uint64_t documents_scored = 0;
+    uint64_t documents_excluded = 0;
+    // documents the top documents were selected from
+    uint64_t candidates_sorted = 0;
+
+    std::chrono::nanoseconds parse_time{0};
+    std::chrono::nanoseconds scan_time{0};
+    std::chrono::nanoseconds filter_time{0};
+    std::chrono::nanoseconds top_k_time{0};
+
+    QueryStats &operator+=(const QueryStats &other);
+};
+
+std::ostream &operator<<(std::ostream &os, const QueryStats &stats);
+
+// adds the lifetime of the scope to *duration, does nothing if duration is
+// nullptr, so untracked searches do not read the clock
+class PhaseTimer
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    explicit PhaseTimer(std::chrono::nanoseconds *duration)
+        : duration_(duration)
+    {
+        if (duration_ != nullptr)
+        {
+            start_time_ = Clock::now();
+        }
+    }
+
+    ~PhaseTimer()
+    {
+        if (duration_ != nullptr)
+        {
+            *duration_ += Clock::now() - start_time_;
+        }
+    }
+
+    PhaseTimer(const PhaseTimer &) = delete;
+    PhaseTimer &operator=(const PhaseTimer &) = delete;
+
+private:
+    std::chrono::nanoseconds *const duration_;
+    Clock::time_point start_time_;
+};
@@ -16,3 +16,8 @@ int ReadLineWithNumber()
     ReadLine();
     return result;
 }
+
+bool ReadLine(istream &input, string &line)
+{
+    return static_cast<bool>(getline(input, line));
+}
@@ -3,3 +3,5 @@
 
 std::string ReadLine();
 int ReadLineWithNumber();
+// reads the next line of input, returns false at the end of the input
+bool ReadLine(std::istream &input, std::string &line);
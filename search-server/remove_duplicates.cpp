@@ -1,29 +1,49 @@
 #include "remove_duplicates.h"
-#include <sstream>
+#include "term_set_signature.h"
+
+#include <algorithm>
+#include <execution>
+#include <unordered_map>
+#include <vector>
 
 using namespace std;
 
 void RemoveDuplicates(SearchServer &search_server)
 {
-    set<set<std::string> > passed;
-    set<int> duplicates;
-    for (int doc_id : search_server)
-    {
-        set<string> bag_of_words;
-        for (const auto &[word, _] : search_server.GetWordFrequencies(doc_id))
-        {
-            bag_of_words.insert(string(word));
+    const vector<int> document_ids(search_server.cbegin(), search_server.cend());
+    vector<TermSetSignature> signatures(document_ids.size());
+    transform(
+        execution::par,
+        document_ids.begin(), document_ids.end(),
+        signatures.begin(),
+        [&search_server](int document_id) {
+            return ComputeTermSetSignature(search_server.GetWordFrequencies(document_id));
         }
-        if (passed.find(bag_of_words) == passed.end())
+    );
+
+    // documents kept for a signature; more than one only if the signatures
+    // of different word sets collide
+    unordered_map<TermSetSignature, vector<int>, TermSetSignatureHasher> kept;
+    kept.reserve(document_ids.size());
+    vector<int> duplicates;
+    for (size_t i = 0; i < document_ids.size(); ++i)
+    {
+        const WordFrequencies word_frequencies = search_server.GetWordFrequencies(document_ids[i]);
+        vector<int> &same_signature = kept[signatures[i]];
+        const bool is_duplicate = any_of(
+            same_signature.begin(), same_signature.end(),
+            [&](int kept_id) {
+                return HaveSameTerms(search_server.GetWordFrequencies(kept_id), word_frequencies);
+            }
+        );
+        if (is_duplicate)
         {
-            passed.insert(bag_of_words);
+            duplicates.push_back(document_ids[i]);
         }
         else
         {
-            duplicates.insert(doc_id);
+            same_signature.push_back(document_ids[i]);
         }
     }
-    for(int doc_id: duplicates){
-        search_server.RemoveDocument(doc_id);
-    }
+    search_server.RemoveDocuments(duplicates);
 }
@@ -1,4 +1,7 @@
 #pragma once
 #include "search_server.h"
 
+// Removes every document whose set of words equals that of a document
+// with a smaller id. Word sets are compared by their signatures, computed
+// in parallel, and compared exactly only when the signatures are equal.
 void RemoveDuplicates(SearchServer &search_server);
@@ -2,46 +2,65 @@
 
 using namespace std;
 
-RequestQueue::RequestQueue(const SearchServer &search_server)
-    : search_server_(search_server) {}
+namespace {
+// shard of the counters the calling thread writes to
+size_t GetThreadShard()
+{
+    static atomic<size_t> next_shard{0};
+    thread_local const size_t shard = next_shard.fetch_add(1);
+    return shard;
+}
+}
+
+RequestQueue::RequestQueue(
+    const SearchServer &search_server,
+    size_t window_size,
+    SlowQueryLog *slow_query_log
+)
+    : search_server_(search_server),
+      window_size_(max<size_t>(1, window_size)),
+      slow_query_log_(slow_query_log),
+      is_empty_(make_unique<atomic<bool>[]>(window_size_))
+{
+}
 
 vector<Document> RequestQueue::AddFindRequest(const string &raw_query, DocumentStatus status)
 {
-    FreeUpPlaceInQueue();
-    vector<Document> documents = search_server_.FindTopDocuments(raw_query, status);
-    if (documents.empty())
-    {
-        n_empty_requests_++;
-    }
-    requests_.push_back({documents, raw_query});
+    vector<Document> documents = Find(
+        raw_query,
+        status,
+        [status](int, DocumentStatus document_status, int) {
+            return document_status == status;
+        }
+    );
+    Record(documents.empty());
     return documents;
 }
 
 vector<Document> RequestQueue::AddFindRequest(const string &raw_query)
 {
-    FreeUpPlaceInQueue();
-    vector<Document> documents = search_server_.FindTopDocuments(raw_query);
-    if (documents.empty())
-    {
-        n_empty_requests_++;
-    }
-    requests_.push_back({documents, raw_query});
-    return documents;
+    return AddFindRequest(raw_query, DocumentStatus::ACTUAL);
 }
 
 int RequestQueue::GetNoResultRequests() const
 {
-    return n_empty_requests_;
+    int count = 0;
+    for (const CounterShard &shard : no_result_counts_)
+    {
+        count += shard.count.load(memory_order_relaxed);
+    }
+    return count;
 }
 
-void RequestQueue::FreeUpPlaceInQueue()
+void RequestQueue::Record(bool is_empty)
 {
-    while (min_in_day_ <= requests_.size())
+    const uint64_t request = next_request_.fetch_add(1, memory_order_relaxed);
+    // the slot holds the request leaving the window; the sum of the shards
+    // stays equal to the number of set flags whatever order threads race in
+    const bool was_empty = is_empty_[request % window_size_].exchange(is_empty, memory_order_relaxed);
+    const int delta = static_cast<int>(is_empty) - static_cast<int>(was_empty);
+    if (delta != 0)
     {
-        if (requests_.front().documents.empty())
-        {
-            --n_empty_requests_;
-        }
-        requests_.pop_front();
+        no_result_counts_[GetThreadShard() % SHARD_COUNT].count.fetch_add(delta, memory_order_relaxed);
     }
-}
\ No newline at end of file
+}
@@ -1,12 +1,29 @@
 #pragma once
 #include "search_server.h"
+#include "slow_query_log.h"
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <vector>
-#include <deque>
 
+// Counts the requests without results among the last window_size ones.
+// A request is recorded as one flag in a fixed ring buffer, and the count
+// is spread over cache-line sized shards, so recording from many threads
+// takes no lock and allocates nothing.
+// Given a SlowQueryLog, the queue also times every request and records
+// the slow ones with their QueryStats.
 class RequestQueue
 {
 public:
-    explicit RequestQueue(const SearchServer &search_server);
+    static const size_t MIN_IN_DAY = 1440;
+
+    explicit RequestQueue(
+        const SearchServer &search_server,
+        size_t window_size = MIN_IN_DAY,
+        SlowQueryLog *slow_query_log = nullptr
+    );
 
     // сделаем "обёртки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
     template <typename DocumentPredicate>
@@ -16,37 +33,67 @@ public:
     );
     std::vector<Document> AddFindRequest(const std::string &raw_query, DocumentStatus status);
     std::vector<Document> AddFindRequest(const std::string &raw_query);
+    // exact once the recording threads are done
     int GetNoResultRequests() const;
 
 private:
-    struct QueryResult
+    struct alignas(64) CounterShard
     {
-        // определите, что должно быть в структуре
-        std::vector<Document> documents;
-        std::string raw_query;
+        std::atomic<int> count{0};
     };
-    std::deque<QueryResult> requests_;
-    const static int min_in_day_ = 1440;
-    // возможно, здесь вам понадобится что-то ещё
-    int n_empty_requests_ = 0;
+    static const size_t SHARD_COUNT = 16;
+
     const SearchServer &search_server_;
+    const size_t window_size_;
+    SlowQueryLog *const slow_query_log_;
+    // is_empty flags of the last window_size_ requests
+    std::unique_ptr<std::atomic<bool>[]> is_empty_;
+    std::atomic<uint64_t> next_request_{0};
+    std::array<CounterShard, SHARD_COUNT> no_result_counts_;
 
-    void FreeUpPlaceInQueue();
+    void Record(bool is_empty);
+    template <typename DocumentPredicate>
+    std::vector<Document> Find(
+        const std::string &raw_query,
+        std::optional<DocumentStatus> status,
+        DocumentPredicate document_predicate
+    ) const;
 };
 
-// сделаем "обёртки" для всех методов поиска, чтобы сохранять результаты для нашей статистики
 template <typename DocumentPredicate>
 std::vector<Document> RequestQueue::AddFindRequest(
     const std::string &raw_query,
     DocumentPredicate document_predicate)
 {
-    // напишите реализацию
-    FreeUpPlaceInQueue();
-    std::vector<Document> documents = search_server_.FindTopDocuments(raw_query, document_predicate);
-    if (documents.empty())
+    std::vector<Document> documents = Find(raw_query, std::nullopt, document_predicate);
+    Record(documents.empty());
+    return documents;
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> RequestQueue::Find(
+    const std::string &raw_query,
+    std::optional<DocumentStatus> status,
+    DocumentPredicate document_predicate
+) const
+{
+    QueryContext context;
+    if (slow_query_log_ == nullptr)
     {
-        n_empty_requests_++;
+        return search_server_.FindTopDocuments(context, raw_query, document_predicate);
     }
-    requests_.push_back({documents, raw_query});
+    QueryStats stats;
+    context.stats = &stats;
+    const auto start_time = std::chrono::steady_clock::now();
+    std::vector<Document> documents = search_server_.FindTopDocuments(
+        context, raw_query, document_predicate
+    );
+    slow_query_log_->Record(
+        raw_query,
+        status,
+        std::chrono::steady_clock::now() - start_time,
+        search_server_.GetGeneration(),
+        stats
+    );
     return documents;
 }
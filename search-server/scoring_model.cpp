@@ -0,0 +1,55 @@
+#include "scoring_model.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+const int STEPS_PER_DOUBLING = 8;
+
+}
+
+uint8_t EncodeLengthNorm(uint32_t length)
+{
+    if (length < EXACT_LENGTH_LIMIT)
+    {
+        return static_cast<uint8_t>(length);
+    }
+    const double steps = floor(STEPS_PER_DOUBLING * log2(length * 1.0 / EXACT_LENGTH_LIMIT));
+    return static_cast<uint8_t>(min<double>(255, EXACT_LENGTH_LIMIT + steps));
+}
+
+double DecodeLengthNorm(uint8_t length_norm)
+{
+    if (length_norm < EXACT_LENGTH_LIMIT)
+    {
+        return length_norm;
+    }
+    // the geometric middle of the lengths of the step
+    const double steps = length_norm - EXACT_LENGTH_LIMIT + 0.5;
+    return EXACT_LENGTH_LIMIT * exp2(steps / STEPS_PER_DOUBLING);
+}
+
+TfIdfScorer TfIdf::MakeScorer(double) const
+{
+    return {};
+}
+
+Bm25Scorer::Bm25Scorer(double k1, double b, double average_length)
+    : k1_(k1)
+{
+    length_factors_[0] = 0;
+    for (size_t norm = 1; norm < length_factors_.size(); ++norm)
+    {
+        const double length = DecodeLengthNorm(static_cast<uint8_t>(norm));
+        length_factors_[norm] = average_length > 0
+            ? k1 * ((1 - b) / length + b / average_length)
+            : k1 / length;
+    }
+}
+
+Bm25Scorer Bm25::MakeScorer(double average_length) const
+{
+    return {k1, b, average_length};
+}
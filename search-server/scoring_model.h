@@ -0,0 +1,72 @@
+#pragma once
+#include <array>
+#include <cmath>
+#include <cstdint>
+#include <variant>
+
+// Document lengths in words, kept in one byte per document. Lengths below
+// EXACT_LENGTH_LIMIT are exact, longer ones are rounded to one of eight
+// steps per doubling.
+inline constexpr uint32_t EXACT_LENGTH_LIMIT = 24;
+
+uint8_t EncodeLengthNorm(uint32_t length);
+// the length a norm stands for
+double DecodeLengthNorm(uint8_t length_norm);
+
+// A scoring model makes a scorer for every search. The scorer gives the
+// weight of a query word from the number of documents and the number of
+// documents containing it, and the score of one posting from its
+// normalized term frequency (occurrences / document length), the length
+// norm of the document and the word weight. The scorers are plain types,
+// so the posting loop is compiled and inlined for each model.
+
+class TfIdfScorer
+{
+public:
+    double GetTermWeight(int document_count, int document_freq) const
+    {
+        return std::log(document_count * 1.0 / document_freq);
+    }
+
+    double operator()(double term_freq, uint8_t, double term_weight) const
+    {
+        return term_freq * term_weight;
+    }
+};
+
+struct TfIdf {
+    TfIdfScorer MakeScorer(double average_length) const;
+};
+
+class Bm25Scorer
+{
+public:
+    Bm25Scorer(double k1, double b, double average_length);
+
+    double GetTermWeight(int document_count, int document_freq) const
+    {
+        return std::log(1.0 + (document_count - document_freq + 0.5) / (document_freq + 0.5));
+    }
+
+    // occurrences * (k1 + 1) / (occurrences + k1 * (1 - b + b * length /
+    // average length)), divided through by the length, which the term
+    // frequency already is
+    double operator()(double term_freq, uint8_t length_norm, double term_weight) const
+    {
+        return term_weight * term_freq * (k1_ + 1) / (term_freq + length_factors_[length_norm]);
+    }
+
+private:
+    double k1_;
+    // k1 * ((1 - b) / length + b / average length) by length norm
+    std::array<double, 256> length_factors_;
+};
+
+struct Bm25 {
+    double k1 = 1.2;
+    double b = 0.75;
+
+    Bm25Scorer MakeScorer(double average_length) const;
+};
+
+using ScoringModel = std::variant<TfIdf, Bm25>;
@@ -0,0 +1,89 @@
+#include "search_cursor.h"
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+using namespace std::literals;
+
+SearchCursor SearchCursor::After(const Document &document)
+{
+    SearchCursor cursor;
+    cursor.last_document_ = document;
+    return cursor;
+}
+
+bool SearchCursor::IsStart() const
+{
+    return !last_document_;
+}
+
+bool SearchCursor::IsBefore(const Document &document) const
+{
+    return !last_document_ || IsRankedBefore(*last_document_, document);
+}
+
+bool SearchCursor::IsRankedBefore(const Document &lhs, const Document &rhs)
+{
+    if (lhs.relevance != rhs.relevance)
+    {
+        return lhs.relevance > rhs.relevance;
+    }
+    if (lhs.rating != rhs.rating)
+    {
+        return lhs.rating > rhs.rating;
+    }
+    return lhs.id < rhs.id;
+}
+
+string SearchCursor::Serialize() const
+{
+    if (!last_document_)
+    {
+        return "-"s;
+    }
+    // the bits of the relevance keep it exact
+    uint64_t relevance_bits;
+    memcpy(&relevance_bits, &last_document_->relevance, sizeof(relevance_bits));
+    char text[64];
+    snprintf(
+        text, sizeof(text), "%016llx.%d.%d",
+        static_cast<unsigned long long>(relevance_bits), last_document_->rating, last_document_->id
+    );
+    return text;
+}
+
+SearchCursor SearchCursor::Parse(string_view text)
+{
+    if (text == "-"sv)
+    {
+        return {};
+    }
+    unsigned long long relevance_bits = 0;
+    int rating = 0;
+    int id = 0;
+    int length = 0;
+    const string copy(text);
+    if (sscanf(copy.c_str(), "%16llx.%d.%d%n", &relevance_bits, &rating, &id, &length) != 3
+        || static_cast<size_t>(length) != copy.size())
+    {
+        throw invalid_argument("Invalid search cursor: "s + copy);
+    }
+    double relevance;
+    const uint64_t bits = relevance_bits;
+    memcpy(&relevance, &bits, sizeof(relevance));
+    return After(Document(id, relevance, rating));
+}
+
+bool SearchCursor::operator==(const SearchCursor &other) const
+{
+    if (!last_document_ || !other.last_document_)
+    {
+        return !last_document_ && !other.last_document_;
+    }
+    return last_document_->id == other.last_document_->id
+        && last_document_->rating == other.last_document_->rating
+        && last_document_->relevance == other.last_document_->relevance;
+}
@@ -0,0 +1,47 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+
+// Position in the results of a search: the (relevance, rating, id) of the
+// last document of a page. The next page holds the documents ranked below
+// it, so paging costs the same at any depth and the server keeps no state
+// between pages. Pages may shift if the index changes between them.
+// Pages are ranked by IsRankedBefore rather than SearchServer::IsMoreRelevant,
+// whose relevance tolerance is not transitive and could make a cursor skip
+// or repeat documents of nearly equal relevance.
+class SearchCursor
+{
+public:
+    // the start of the results
+    SearchCursor() = default;
+    // the position right after the document
+    static SearchCursor After(const Document &document);
+
+    bool IsStart() const;
+    // true if the document is ranked below the position
+    bool IsBefore(const Document &document) const;
+    // strict total order of pages: by exact relevance, then by rating,
+    // then by id
+    static bool IsRankedBefore(const Document &lhs, const Document &rhs);
+
+    // opaque text for clients, round-trips exactly
+    std::string Serialize() const;
+    // throws invalid_argument for text Serialize did not produce
+    static SearchCursor Parse(std::string_view text);
+
+    bool operator==(const SearchCursor &other) const;
+
+private:
+    std::optional<Document> last_document_;
+};
+
+struct SearchPage {
+    // in the order of SearchCursor::IsRankedBefore
+    std::vector<Document> documents;
+    // nullopt on the last page
+    std::optional<SearchCursor> next;
+};
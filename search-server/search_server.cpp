@@ -1,9 +1,11 @@
 #include "search_server.h"
+#include "index_serialization.h"
 #include <cmath>
 #include <numeric>
 #include <deque>
 #include <stdexcept>
 #include <sstream>
+#include <unordered_map>
 
 using namespace std;
 using namespace std::literals;
@@ -74,11 +76,157 @@ std::vector<Document> SearchServer::FindTopDocuments(
 }
 
 
+std::vector<Document> SearchServer::FindTopDocuments(
+    QueryContext &context,
+    std::string_view raw_query
+) const
+{
+    return FindTopDocuments(
+        context, raw_query, [](
+            int document_id, 
+            DocumentStatus document_status, 
+            int rating
+        )
+        { return document_status == DocumentStatus::ACTUAL; }
+    );
+}
+
+
+std::vector<Document> SearchServer::FindTopDocuments(
+    std::string_view raw_query,
+    DocumentStatus status,
+    QueryStats &stats
+) const
+{
+    QueryContext context;
+    context.stats = &stats;
+    return FindTopDocuments(
+        context, raw_query, [status](
+            int document_id, 
+            DocumentStatus document_status, 
+            int rating
+        )
+        { return document_status == status; }
+    );
+}
+
+
+std::future<std::vector<Document>> SearchServer::FindTopDocumentsAsync(
+    std::string raw_query,
+    DocumentStatus status,
+    CancellationToken token,
+    SearchCallback on_done
+) const
+{
+    return FindTopDocumentsAsync(
+        move(raw_query),
+        [status](
+            int document_id, 
+            DocumentStatus document_status, 
+            int rating
+        )
+        { return document_status == status; },
+        move(token),
+        move(on_done)
+    );
+}
+
+
+std::vector<Document> SearchServer::SelectTopDocuments(
+    std::vector<Document> &matched_documents
+)
+{
+    TRACE_SCOPE("top-k");
+    const size_t result_size = std::min<size_t>(
+        matched_documents.size(), MAX_RESULT_DOCUMENT_COUNT
+    );
+    std::partial_sort(
+        matched_documents.begin(),
+        matched_documents.begin() + result_size,
+        matched_documents.end(),
+        IsMoreRelevant
+    );
+    return {
+        matched_documents.begin(),
+        matched_documents.begin() + result_size
+    };
+}
+
+
+SearchPage SearchServer::SelectPage(
+    const std::vector<Document> &matched_documents,
+    const SearchCursor &cursor,
+    size_t page_size
+)
+{
+    TRACE_SCOPE("top-k");
+    SearchPage page;
+    // heap with the least relevant document of the page on top
+    vector<Document> &documents = page.documents;
+    documents.reserve(min(page_size, matched_documents.size()));
+    size_t after_cursor_count = 0;
+    for (const Document &document : matched_documents)
+    {
+        if (!cursor.IsBefore(document))
+        {
+            continue;
+        }
+        ++after_cursor_count;
+        if (documents.size() < page_size)
+        {
+            documents.push_back(document);
+            push_heap(documents.begin(), documents.end(), SearchCursor::IsRankedBefore);
+        }
+        else if (SearchCursor::IsRankedBefore(document, documents.front()))
+        {
+            pop_heap(documents.begin(), documents.end(), SearchCursor::IsRankedBefore);
+            documents.back() = document;
+            push_heap(documents.begin(), documents.end(), SearchCursor::IsRankedBefore);
+        }
+    }
+    sort_heap(documents.begin(), documents.end(), SearchCursor::IsRankedBefore);
+    if (after_cursor_count > documents.size())
+    {
+        page.next = SearchCursor::After(documents.back());
+    }
+    return page;
+}
+
+
+SearchPage SearchServer::FindPage(
+    std::string_view raw_query,
+    const SearchCursor &cursor,
+    size_t page_size
+) const
+{
+    return FindPage(raw_query, DocumentStatus::ACTUAL, cursor, page_size);
+}
+
+
+SearchPage SearchServer::FindPage(
+    std::string_view raw_query,
+    DocumentStatus status,
+    const SearchCursor &cursor,
+    size_t page_size
+) const
+{
+    return FindPage(
+        raw_query,
+        [status](int, DocumentStatus document_status, int) {
+            return document_status == status;
+        },
+        cursor,
+        page_size
+    );
+}
+
+
 MatchType SearchServer::MatchDocument(
     std::string_view raw_query,
     int document_id
 ) const
 {
+    LOG_LATENCY(LatencyOperation::MATCH_DOCUMENT);
     const auto query = ParseQuery(raw_query);
     for (const string_view &word : query.minus_words)
     {
@@ -127,15 +275,19 @@ MatchType SearchServer::MatchDocument(
     int document_id
 ) const
 {
+    LOG_LATENCY(LatencyOperation::MATCH_DOCUMENT);
     const auto query = ParseQuery(raw_query, false);
+    // words of the query may be missing from the index
+    const auto is_in_document = [&](string_view word) {
+        const auto it = word_to_document_freqs_.find(word);
+        return it != word_to_document_freqs_.end() && it->second.count(document_id) > 0;
+    };
     if(
         any_of(
             policy, 
             query.minus_words.begin(), 
             query.minus_words.end(),
-            [&](string_view word){
-                return word_to_document_freqs_.at(word).count(document_id);
-            }
+            is_in_document
         )
     )
     {
@@ -148,9 +300,7 @@ MatchType SearchServer::MatchDocument(
             query.plus_words.begin(),
             query.plus_words.end(),
             matched_words.begin(),
-            [&](string_view word){
-                return word_to_document_freqs_.at(word).count(document_id);
-            }
+            is_in_document
         );
         matched_words.erase(it_end, matched_words.end());
     }
@@ -176,22 +326,62 @@ void SearchServer::AddDocument(
     DocumentStatus status,
     const std::vector<int>& ratings
 ) {
+    LOG_LATENCY(LatencyOperation::ADD_DOCUMENT);
     if ((document_id < 0) || (documents_.count(document_id) > 0)) {
         throw invalid_argument("Invalid document_id"s);
     }
-    auto it = words_.insert(document);
-    map<string_view, double> freqs;
-    const auto words = SplitIntoWordsNoStop(*(it.first));
+    bool is_duplicate = false;
+    if (duplicate_policy_ != DuplicatePolicy::ALLOW) {
+        if (const auto original_id = FindDuplicate(document)) {
+            if (duplicate_policy_ == DuplicatePolicy::REJECT) {
+                throw DuplicateDocumentError(document_id, *original_id);
+            }
+            is_duplicate = true;
+        }
+    }
+    const string_view text = words_->Store(document);
+    const int rating = ComputeAverageRating(ratings);
+    IndexDocument(document_id, text, status, rating, is_duplicate);
+    Record([=](SearchServer &server) {
+        server.IndexDocument(document_id, text, status, rating, is_duplicate);
+    });
+}
+
+
+void SearchServer::IndexDocument(
+    int document_id,
+    std::string_view text,
+    DocumentStatus status,
+    int rating,
+    bool is_duplicate
+) {
+    const auto words = SplitIntoWordsNoStop(text);
     const double inv_word_count = 1.0 / words.size();
+    vector<TermFrequency> freqs;
+    freqs.reserve(words.size());
     for (string_view word : words) {
         word_to_document_freqs_[word][document_id] += inv_word_count;
-        freqs[word] += 1;
+        freqs.push_back({forward_index_.GetTermId(word), inv_word_count});
+    }
+    forward_index_.Add(document_id, move(freqs));
+    const uint8_t length_norm = EncodeLengthNorm(words.size());
+    MinHashSketch min_hash;
+    if (min_hash_size_ > 0) {
+        min_hash = ComputeMinHashSketch(forward_index_.Get(document_id), min_hash_size_);
     }
     documents_.emplace(
         document_id, 
-        DocumentData{ComputeAverageRating(ratings), status, freqs}
+        DocumentData{rating, status, length_norm, text, move(min_hash)}
     );
+    total_length_ += DecodeLengthNorm(length_norm);
     document_ids_.insert(document_id);
+    if (duplicate_policy_ != DuplicatePolicy::ALLOW) {
+        signatures_.Insert(ComputeTermSetSignature(forward_index_.Get(document_id)), document_id);
+        if (is_duplicate) {
+            flagged_duplicates_.insert(document_id);
+        }
+    }
+    ++generation_;
 }
 
 
@@ -200,6 +390,119 @@ int SearchServer::GetDocumentCount() const {
 }
 
 
+int SearchServer::GetDocumentFreq(std::string_view word) const {
+    const auto it = word_to_document_freqs_.find(word);
+    return it == word_to_document_freqs_.end() ? 0 : it->second.size();
+}
+
+
+uint64_t SearchServer::GetGeneration() const {
+    return generation_;
+}
+
+
+void SearchServer::SetMinHashSize(size_t hash_count) {
+    vector<pair<int, DocumentData*>> documents;
+    documents.reserve(documents_.size());
+    for (auto &[document_id, data] : documents_) {
+        documents.emplace_back(document_id, &data);
+    }
+    for_each(
+        execution::par,
+        documents.begin(), documents.end(),
+        [this, hash_count](const pair<int, DocumentData*> &document) {
+            document.second->min_hash = hash_count > 0
+                ? ComputeMinHashSketch(forward_index_.Get(document.first), hash_count)
+                : MinHashSketch{};
+        }
+    );
+    min_hash_size_ = hash_count;
+    Record([hash_count](SearchServer &server) { server.SetMinHashSize(hash_count); });
+}
+
+
+size_t SearchServer::GetMinHashSize() const {
+    return min_hash_size_;
+}
+
+
+const MinHashSketch& SearchServer::GetMinHashSketch(int document_id) const {
+    return documents_.at(document_id).min_hash;
+}
+
+
+void SearchServer::SetDuplicatePolicy(DuplicatePolicy policy) {
+    if (policy == DuplicatePolicy::ALLOW) {
+        signatures_.Clear();
+        flagged_duplicates_.clear();
+    } else if (duplicate_policy_ == DuplicatePolicy::ALLOW) {
+        const vector<int> document_ids(document_ids_.begin(), document_ids_.end());
+        for_each(
+            execution::par,
+            document_ids.begin(), document_ids.end(),
+            [this](int document_id) {
+                signatures_.Insert(ComputeTermSetSignature(forward_index_.Get(document_id)), document_id);
+            }
+        );
+    }
+    duplicate_policy_ = policy;
+    Record([policy](SearchServer &server) { server.SetDuplicatePolicy(policy); });
+}
+
+
+DuplicatePolicy SearchServer::GetDuplicatePolicy() const {
+    return duplicate_policy_;
+}
+
+
+const set<int>& SearchServer::GetFlaggedDuplicates() const {
+    return flagged_duplicates_;
+}
+
+
+optional<int> SearchServer::FindDuplicate(string_view text) const {
+    if (duplicate_policy_ == DuplicatePolicy::ALLOW) {
+        return nullopt;
+    }
+    vector<int> term_ids;
+    for (string_view word : SplitIntoWordsNoStop(text)) {
+        const int term_id = forward_index_.FindTermId(word);
+        if (term_id < 0) {
+            // a word no document has
+            return nullopt;
+        }
+        term_ids.push_back(term_id);
+    }
+    sort(term_ids.begin(), term_ids.end());
+    term_ids.erase(unique(term_ids.begin(), term_ids.end()), term_ids.end());
+    return signatures_.Find(
+        ComputeTermSetSignature(term_ids),
+        [this, &term_ids](int document_id) {
+            const WordFrequencies freqs = forward_index_.Get(document_id);
+            return equal(
+                term_ids.begin(), term_ids.end(), freqs.TermsBegin(), freqs.TermsEnd(),
+                [](int term_id, const TermFrequency &entry) { return term_id == entry.term_id; }
+            );
+        }
+    );
+}
+
+
+void SearchServer::ForgetSignature(int document_id) {
+    if (duplicate_policy_ != DuplicatePolicy::ALLOW) {
+        signatures_.Erase(ComputeTermSetSignature(forward_index_.Get(document_id)), document_id);
+        flagged_duplicates_.erase(document_id);
+    }
+}
+
+
+void SearchServer::ForgetDocument(int document_id) {
+    total_length_ -= DecodeLengthNorm(documents_.at(document_id).length_norm);
+    documents_.erase(document_id);
+    document_ids_.erase(document_id);
+}
+
+
 int SearchServer::ComputeAverageRating(const vector<int>& ratings) {
     if (ratings.empty()) {
         return 0;
@@ -285,8 +588,293 @@ SearchServer::Query SearchServer::ParseQuery(
 }
 
 
-double SearchServer::ComputeWordInverseDocumentFreq(std::string_view word) const {
-    return log(GetDocumentCount() * 1.0 / word_to_document_freqs_.at(word).size());
+void SearchServer::SetScoringModel(ScoringModel model) {
+    scoring_model_ = move(model);
+    impact_index_.reset();
+    Record([model = scoring_model_](SearchServer &server) { server.SetScoringModel(model); });
+}
+
+const ScoringModel& SearchServer::GetScoringModel() const {
+    return scoring_model_;
+}
+
+double SearchServer::GetAverageDocumentLength() const {
+    return documents_.empty() ? 0.0 : total_length_ / documents_.size();
+}
+
+double SearchServer::GetTotalDocumentLength() const {
+    return total_length_;
+}
+
+double SearchServer::ComputeAverageDocumentLength(const CorpusStatistics *corpus) const {
+    if (corpus == nullptr) {
+        return GetAverageDocumentLength();
+    }
+    return corpus->document_count == 0 ? 0.0 : corpus->total_length / corpus->document_count;
+}
+
+void SearchServer::BuildImpactIndex(ImpactPrecision precision) {
+    vector<ImpactIndex::DocumentInfo> documents;
+    documents.reserve(documents_.size());
+    unordered_map<int, uint32_t> positions;
+    for (const auto &[document_id, data] : documents_) {
+        positions.emplace(document_id, documents.size());
+        documents.push_back({document_id, data.status, data.rating});
+    }
+    map<string, vector<ImpactIndex::ScoredPosting>, less<>> postings;
+    visit(
+        [&](const auto &model) {
+            const auto scorer = model.MakeScorer(GetAverageDocumentLength());
+            for (const auto &[word, document_freqs] : word_to_document_freqs_) {
+                if (document_freqs.empty()) {
+                    continue;
+                }
+                const double term_weight = ComputeTermWeight(scorer, word);
+                auto &word_postings = postings[string(word)];
+                word_postings.reserve(document_freqs.size());
+                for (const auto &[document_id, term_freq] : document_freqs) {
+                    word_postings.push_back({
+                        positions.at(document_id),
+                        scorer(term_freq, documents_.at(document_id).length_norm, term_weight)
+                    });
+                }
+            }
+        },
+        scoring_model_
+    );
+    impact_index_ = make_shared<const ImpactIndex>(
+        precision, generation_, move(documents), move(postings)
+    );
+    // the index is immutable and fits the copies in the same state
+    Record([index = impact_index_](SearchServer &server) { server.impact_index_ = index; });
+}
+
+bool SearchServer::HasImpactIndex() const {
+    return impact_index_ && impact_index_->GetGeneration() == generation_;
+}
+
+vector<Document> SearchServer::FindTopDocumentsByImpact(
+    string_view raw_query,
+    DocumentStatus status,
+    const ImpactSearchOptions &options
+) const {
+    return FindTopDocumentsByImpact(
+        raw_query,
+        [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        },
+        options
+    );
+}
+
+QueryExecutor &SearchServer::GetExecutor() const {
+    return *executor_;
+}
+
+void SearchServer::SetExecutor(std::shared_ptr<QueryExecutor> executor) {
+    executor_ = move(executor);
+    Record([executor = executor_](SearchServer &server) { server.SetExecutor(executor); });
+}
+
+void SearchServer::SetChangeLog(std::vector<Change> *changes) {
+    change_log_ = changes;
+}
+
+void SearchServer::Replay(const std::vector<Change> &changes) {
+    for (const Change &change : changes) {
+        change(*this);
+    }
+}
+
+namespace {
+
+// "SSIX" read in the byte order of the machine, a reader of the other
+// byte order sees another number
+const uint32_t INDEX_MAGIC = 0x58495353;
+const uint32_t INDEX_VERSION = 1;
+
+}
+
+std::string SearchServer::SerializeIndex() const {
+    string data;
+    IndexWriter writer(data);
+    writer.Write(INDEX_MAGIC);
+    writer.Write(INDEX_VERSION);
+    writer.Write<uint64_t>(generation_);
+    writer.Write<uint64_t>(min_hash_size_);
+    writer.Write(duplicate_policy_);
+    writer.Write<uint8_t>(scoring_model_.index());
+    if (const auto *bm25 = get_if<Bm25>(&scoring_model_)) {
+        writer.Write(bm25->k1);
+        writer.Write(bm25->b);
+    }
+    writer.Write(total_length_);
+
+    writer.Write<uint64_t>(stop_words_.size());
+    for (string_view word : stop_words_) {
+        writer.WriteString(word);
+    }
+    // term ids of the forward index and the sketches are the positions
+    // in the dictionary
+    writer.Write<uint64_t>(forward_index_.GetTermCount());
+    for (size_t term_id = 0; term_id < forward_index_.GetTermCount(); ++term_id) {
+        writer.WriteString(forward_index_.GetTerm(term_id));
+    }
+
+    writer.Write<uint64_t>(documents_.size());
+    for (const auto &[document_id, data] : documents_) {
+        writer.Write(document_id);
+        writer.Write(data.rating);
+        writer.Write(data.status);
+        writer.Write(data.length_norm);
+        writer.WriteString(data.text);
+        writer.Write<uint64_t>(data.min_hash.size());
+        for (uint32_t hash : data.min_hash) {
+            writer.Write(hash);
+        }
+        const WordFrequencies freqs = forward_index_.Get(document_id);
+        writer.Write<uint64_t>(freqs.size());
+        for (auto entry = freqs.TermsBegin(); entry != freqs.TermsEnd(); ++entry) {
+            writer.Write(entry->term_id);
+            writer.Write(entry->term_freq);
+        }
+    }
+
+    writer.Write<uint64_t>(word_to_document_freqs_.size());
+    for (const auto &[word, document_freqs] : word_to_document_freqs_) {
+        writer.Write(forward_index_.FindTermId(word));
+        writer.Write<uint64_t>(document_freqs.size());
+        for (const auto &[document_id, term_freq] : document_freqs) {
+            writer.Write(document_id);
+            writer.Write(term_freq);
+        }
+    }
+
+    writer.Write<uint64_t>(flagged_duplicates_.size());
+    for (int document_id : flagged_duplicates_) {
+        writer.Write(document_id);
+    }
+    return data;
+}
+
+void SearchServer::LoadIndex(std::string_view data) {
+    IndexReader reader(data);
+    if (reader.Read<uint32_t>() != INDEX_MAGIC || reader.Read<uint32_t>() != INDEX_VERSION) {
+        throw invalid_argument("Not a serialized index of this version"s);
+    }
+    // built aside, so that a malformed index leaves the server unchanged;
+    // the texts go to the shared storage the versions of the server refer to
+    SearchServer loaded(vector<string_view>{});
+    loaded.words_ = words_;
+    loaded.executor_ = executor_;
+    loaded.generation_ = reader.Read<uint64_t>();
+    loaded.min_hash_size_ = reader.Read<uint64_t>();
+    const auto duplicate_policy = reader.Read<DuplicatePolicy>();
+    if (duplicate_policy > DuplicatePolicy::REJECT) {
+        throw invalid_argument("Invalid duplicate policy in index"s);
+    }
+    switch (reader.Read<uint8_t>()) {
+    case 0:
+        loaded.scoring_model_ = TfIdf{};
+        break;
+    case 1: {
+        Bm25 bm25;
+        bm25.k1 = reader.Read<double>();
+        bm25.b = reader.Read<double>();
+        loaded.scoring_model_ = bm25;
+        break;
+    }
+    default:
+        throw invalid_argument("Invalid scoring model in index"s);
+    }
+    loaded.total_length_ = reader.Read<double>();
+
+    for (size_t count = reader.ReadCount(sizeof(uint64_t)); count > 0; --count) {
+        const string_view word = reader.ReadString();
+        if (!IsValidWord(word)) {
+            throw invalid_argument("Invalid stop word in index"s);
+        }
+        loaded.stop_words_.insert(words_->Store(word));
+    }
+    const size_t term_count = reader.ReadCount(sizeof(uint64_t));
+    for (size_t term_id = 0; term_id < term_count; ++term_id) {
+        if (loaded.forward_index_.GetTermId(words_->Store(reader.ReadString())) != static_cast<int>(term_id)) {
+            throw invalid_argument("Repeated term in index"s);
+        }
+    }
+    const auto read_term = [&reader, term_count] {
+        const int term_id = reader.Read<int>();
+        if (term_id < 0 || static_cast<size_t>(term_id) >= term_count) {
+            throw invalid_argument("Invalid term id in index"s);
+        }
+        return term_id;
+    };
+
+    // a flat copy of document_ids_, in ascending order, for checking the
+    // postings without the cache misses of a tree
+    vector<int> document_ids;
+    vector<TermFrequency> freqs;
+    for (size_t count = reader.ReadCount(sizeof(int)); count > 0; --count) {
+        const int document_id = reader.Read<int>();
+        DocumentData document;
+        document.rating = reader.Read<int>();
+        document.status = reader.Read<DocumentStatus>();
+        if (document.status > DocumentStatus::REMOVED) {
+            throw invalid_argument("Invalid document status in index"s);
+        }
+        document.length_norm = reader.Read<uint8_t>();
+        document.text = words_->Store(reader.ReadString());
+        document.min_hash.resize(reader.ReadCount(sizeof(uint32_t)));
+        for (uint32_t &hash : document.min_hash) {
+            hash = reader.Read<uint32_t>();
+        }
+        freqs.resize(reader.ReadCount(sizeof(int) + sizeof(double)));
+        for (TermFrequency &entry : freqs) {
+            entry.term_id = read_term();
+            entry.term_freq = reader.Read<double>();
+        }
+        if (document_id < 0 || (!document_ids.empty() && document_id <= document_ids.back())) {
+            throw invalid_argument("Invalid document id in index"s);
+        }
+        document_ids.push_back(document_id);
+        loaded.forward_index_.Add(document_id, freqs);
+        // written in id order, so every insertion is at the end
+        loaded.documents_.emplace_hint(loaded.documents_.end(), document_id, move(document));
+        loaded.document_ids_.emplace_hint(loaded.document_ids_.end(), document_id);
+    }
+
+    for (size_t count = reader.ReadCount(sizeof(int)); count > 0; --count) {
+        const string_view word = loaded.forward_index_.GetTerm(read_term());
+        auto &document_freqs = loaded.word_to_document_freqs_.emplace_hint(
+            loaded.word_to_document_freqs_.end(), word, map<int, double>{}
+        )->second;
+        // the postings are in id order too, so each is looked for after
+        // the one before it
+        auto known_id = document_ids.begin();
+        for (size_t entries = reader.ReadCount(sizeof(int) + sizeof(double)); entries > 0; --entries) {
+            const int document_id = reader.Read<int>();
+            known_id = lower_bound(known_id, document_ids.end(), document_id);
+            if (known_id == document_ids.end() || *known_id != document_id) {
+                throw invalid_argument("Posting of an unknown document in index"s);
+            }
+            ++known_id;
+            document_freqs.emplace_hint(document_freqs.end(), document_id, reader.Read<double>());
+        }
+    }
+
+    for (size_t count = reader.ReadCount(sizeof(int)); count > 0; --count) {
+        loaded.flagged_duplicates_.insert(reader.Read<int>());
+    }
+    if (!reader.IsAtEnd()) {
+        throw invalid_argument("Trailing data after index"s);
+    }
+    // the signatures are hashes of the forward index, cheaper to compute
+    // than to ship
+    loaded.SetDuplicatePolicy(duplicate_policy);
+
+    loaded.change_log_ = change_log_;
+    *this = move(loaded);
+    Record([data = string(data)](SearchServer &server) { server.LoadIndex(data); });
 }
 
 set<int>::iterator SearchServer::begin() {
@@ -296,33 +884,38 @@ set<int>::iterator SearchServer::end() {
     return document_ids_.end();
 }
 
-set<int>::const_iterator SearchServer::cbegin() {
+set<int>::const_iterator SearchServer::cbegin() const {
     return document_ids_.cbegin();
 }
 
-set<int>::const_iterator SearchServer::cend() {
+set<int>::const_iterator SearchServer::cend() const {
     return document_ids_.cend();
 }
 
 
-const map<string_view, double> &SearchServer::GetWordFrequencies(int document_id) const
+WordFrequencies SearchServer::GetWordFrequencies(int document_id) const
 {
-    if (documents_.count(document_id))
-    {
-        return documents_.at(document_id).freqs;
-    }
-    else
-    {
-        static const map<string_view, double> empty_;
-        return empty_;
-    }
+    return forward_index_.Get(document_id);
+}
+
+IndexedDocument SearchServer::GetDocument(int document_id) const
+{
+    const DocumentData &data = documents_.at(document_id);
+    return {document_id, data.text, data.status, data.rating};
 }
 
 void SearchServer::RemoveDocument(int document_id) {
-    for ( const auto &[word, _]:  documents_.at(document_id).freqs)
+    LOG_LATENCY(LatencyOperation::REMOVE_DOCUMENT);
+    if (documents_.count(document_id) == 0) {
+        throw out_of_range("Invalid document_id"s);
+    }
+    for (const auto &[word, _] : forward_index_.Get(document_id))
         word_to_document_freqs_[word].erase(document_id);
-    documents_.erase(document_id);
-    document_ids_.erase(document_id);
+    ForgetSignature(document_id);
+    forward_index_.Remove(document_id);
+    ForgetDocument(document_id);
+    ++generation_;
+    Record([document_id](SearchServer &server) { server.RemoveDocuments({document_id}); });
 }
 
     
@@ -334,28 +927,60 @@ void SearchServer::RemoveDocument(
     RemoveDocument(document_id);
 }
 
+void SearchServer::RemoveDocuments(vector<int> document_ids) {
+    sort(document_ids.begin(), document_ids.end());
+    document_ids.erase(unique(document_ids.begin(), document_ids.end()), document_ids.end());
+    for (int document_id : document_ids) {
+        if (documents_.count(document_id) == 0) {
+            throw out_of_range("Invalid document_id"s);
+        }
+    }
+    unordered_map<int, vector<int>> term_documents;
+    for (int document_id : document_ids) {
+        const WordFrequencies freqs = forward_index_.Get(document_id);
+        for (auto entry = freqs.TermsBegin(); entry != freqs.TermsEnd(); ++entry) {
+            term_documents[entry->term_id].push_back(document_id);
+        }
+    }
+    for (const auto &[term_id, term_document_ids] : term_documents) {
+        auto &document_freqs = word_to_document_freqs_.at(forward_index_.GetTerm(term_id));
+        for (int document_id : term_document_ids) {
+            document_freqs.erase(document_id);
+        }
+    }
+    for (int document_id : document_ids) {
+        ForgetSignature(document_id);
+    }
+    forward_index_.Remove(document_ids);
+    for (int document_id : document_ids) {
+        ForgetDocument(document_id);
+    }
+    generation_ += document_ids.size();
+    Record([document_ids](SearchServer &server) { server.RemoveDocuments(document_ids); });
+}
+
 void SearchServer::RemoveDocument(
     const std::execution::parallel_policy& policy, 
     int document_id
 ) {
-    std::vector<const std::string_view*> words(documents_.at(document_id).freqs.size());
-    std::transform(
-        policy,
-        documents_.at(document_id).freqs.begin(),
-        documents_.at(document_id).freqs.end(),
-        words.begin(),
-        [](const auto &pair){return &pair.first;}
-    );
+    LOG_LATENCY(LatencyOperation::REMOVE_DOCUMENT);
+    if (documents_.count(document_id) == 0) {
+        throw out_of_range("Invalid document_id"s);
+    }
+    const WordFrequencies freqs = forward_index_.Get(document_id);
     std::for_each(
         policy,
-        words.begin(),
-        words.end(),
-        [&](const auto *word){
-            word_to_document_freqs_.at(*word).erase(document_id);
+        freqs.TermsBegin(),
+        freqs.TermsEnd(),
+        [&](const TermFrequency &entry){
+            word_to_document_freqs_.at(
+                forward_index_.GetTerm(entry.term_id)
+            ).erase(document_id);
         }
     );
-    documents_.erase(document_id);
-    document_ids_.erase(document_id);
+    ForgetSignature(document_id);
+    forward_index_.Remove(document_id);
+    ForgetDocument(document_id);
+    ++generation_;
+    Record([document_id](SearchServer &server) { server.RemoveDocuments({document_id}); });
 }
-
- 
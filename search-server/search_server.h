@@ -8,17 +8,48 @@
 #include <future>
 #include <sstream>
 #include <type_traits>
+#include <cstdint>
 
 #include "document.h"
 #include "string_processing.h"
 #include "paginator.h"
 #include "concurrent_map.h"
+#include "forward_index.h"
+#include "impact_index.h"
 #include "log_duration.h"
+#include "min_hash.h"
+#include "query_context.h"
+#include "query_executor.h"
+#include "scoring_model.h"
+#include "search_cursor.h"
+#include "signature_index.h"
+#include "text_storage.h"
+#include "tracing.h"
 
 #define EPS 1e-6
 const int MAX_RESULT_DOCUMENT_COUNT = 5;
 using MatchType = typename std::tuple<std::vector<std::string_view>, DocumentStatus>;
 
+// called on the worker thread when an asynchronous search completes,
+// error is set if the search failed or was cancelled
+using SearchCallback = std::function<void(
+    const std::vector<Document> &documents,
+    std::exception_ptr error
+)>;
+
+// a document as it was added to the index, with its ratings averaged
+struct IndexedDocument {
+    int id;
+    std::string_view text;
+    DocumentStatus status;
+    int rating;
+};
+
+template <typename Policy>
+using EnableIfExecutionPolicy = std::enable_if_t<
+    std::is_execution_policy_v<std::decay_t<Policy>>
+>;
+
 class SearchServer {
 public:
     explicit SearchServer(std::string const& str);
@@ -46,25 +77,93 @@ public:
         DocumentPredicate document_predicate
     ) const;
     
-    template <typename Policy>
+    template <typename Policy, typename = EnableIfExecutionPolicy<Policy>>
     std::vector<Document> FindTopDocuments(
         Policy policy,
         std::string_view raw_query
     ) const;
-    template <typename Policy>
+    template <typename Policy, typename = EnableIfExecutionPolicy<Policy>>
     std::vector<Document> FindTopDocuments(
         Policy policy,
         std::string_view raw_query,
         DocumentStatus status
     ) const;
-    template <typename Policy, typename DocumentPredicate>
+    template <
+        typename Policy,
+        typename DocumentPredicate,
+        typename = EnableIfExecutionPolicy<Policy>
+    >
     std::vector<Document> FindTopDocuments(
         Policy  policy,
         std::string_view raw_query,
         DocumentPredicate document_predicate
     ) const;
+
+    // the same searches reusing the buffers of context,
+    // used by the executor workers
+    std::vector<Document> FindTopDocuments(
+        QueryContext &context,
+        std::string_view raw_query
+    ) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(
+        QueryContext &context,
+        std::string_view raw_query,
+        DocumentPredicate document_predicate
+    ) const;
+    // adds the work done by the search to stats
+    std::vector<Document> FindTopDocuments(
+        std::string_view raw_query,
+        DocumentStatus status,
+        QueryStats &stats
+    ) const;
+    
+    // Page of up to page_size documents ranked after the cursor, in the
+    // order of SearchCursor::IsRankedBefore and without the result limit of
+    // FindTopDocuments. Selects the
+    // page with a heap of page_size documents, so a page costs
+    // O(postings * log(page_size)) at any depth.
+    SearchPage FindPage(
+        std::string_view raw_query,
+        const SearchCursor &cursor,
+        size_t page_size
+    ) const;
+    SearchPage FindPage(
+        std::string_view raw_query,
+        DocumentStatus status,
+        const SearchCursor &cursor,
+        size_t page_size
+    ) const;
+    template <typename DocumentPredicate>
+    SearchPage FindPage(
+        std::string_view raw_query,
+        DocumentPredicate document_predicate,
+        const SearchCursor &cursor,
+        size_t page_size
+    ) const;
+
+    // Queue the search on the executor and return at once. A search
+    // cancelled through token fails with QueryCancelled. The server must
+    // outlive the search.
+    std::future<std::vector<Document>> FindTopDocumentsAsync(
+        std::string raw_query,
+        DocumentStatus status = DocumentStatus::ACTUAL,
+        CancellationToken token = {},
+        SearchCallback on_done = {}
+    ) const;
+    template <typename DocumentPredicate>
+    std::future<std::vector<Document>> FindTopDocumentsAsync(
+        std::string raw_query,
+        DocumentPredicate document_predicate,
+        CancellationToken token = {},
+        SearchCallback on_done = {}
+    ) const;
     
     int GetDocumentCount() const;
+    // number of documents containing the word
+    int GetDocumentFreq(std::string_view word) const;
+    // number of AddDocument/RemoveDocument calls applied to the index
+    uint64_t GetGeneration() const;
     
     MatchType MatchDocument(
         std::string_view raw_query, 
@@ -83,11 +182,69 @@ public:
     
     std::set<int>::iterator begin();
     std::set<int>::iterator end();
-    std::set<int>::const_iterator cbegin();
-    std::set<int>::const_iterator cend();
+    std::set<int>::const_iterator cbegin() const;
+    std::set<int>::const_iterator cend() const;
     
-    const std::map<std::string_view, double> 
-    &GetWordFrequencies(int document_id) const;
+    // normalized term frequencies of the document, sorted by term id;
+    // the view is valid until the next AddDocument/RemoveDocument
+    WordFrequencies GetWordFrequencies(int document_id) const;
+    // the text stays valid while the server or any of its copies lives
+    IndexedDocument GetDocument(int document_id) const;
+
+    // Keeps a MinHash sketch of hash_count values per document, computed
+    // when the document is added; sketches of the documents already in the
+    // index are computed in parallel. 0, the default, keeps none.
+    void SetMinHashSize(size_t hash_count);
+    size_t GetMinHashSize() const;
+    // empty if sketches are not kept
+    const MinHashSketch &GetMinHashSketch(int document_id) const;
+
+    // Checks every added document against an index of the term-set
+    // signatures of the documents in the server, at an expected O(1) cost
+    // per document. Enabling it indexes the documents already added in
+    // parallel; ALLOW drops the index.
+    void SetDuplicatePolicy(DuplicatePolicy policy);
+    DuplicatePolicy GetDuplicatePolicy() const;
+    // documents added as duplicates under DuplicatePolicy::FLAG, until
+    // they are removed
+    const std::set<int> &GetFlaggedDuplicates() const;
+    // a document with the same words as the text, nullopt if there is none
+    // or the duplicate policy is ALLOW
+    std::optional<int> FindDuplicate(std::string_view text) const;
+
+    // Model ranking the documents of the following searches, TF-IDF by
+    // default. The search is compiled for every model, so a posting costs
+    // no more under a model than with the model hard-coded.
+    void SetScoringModel(ScoringModel model);
+    const ScoringModel &GetScoringModel() const;
+    // mean number of words of the documents, without stop words
+    double GetAverageDocumentLength() const;
+    // number of words of all documents as the scoring models see it, with
+    // each length rounded to its length norm
+    double GetTotalDocumentLength() const;
+
+    // Builds an impact index of the documents now in the server: the score
+    // of every posting under the scoring model, quantized to the precision.
+    // The index is shared by copies of the server and used until the next
+    // AddDocument/RemoveDocument or SetScoringModel.
+    void BuildImpactIndex(ImpactPrecision precision = ImpactPrecision::BITS_8);
+    // true if the impact index is built and up to date
+    bool HasImpactIndex() const;
+    // The top documents by quantized score, reading the postings of the
+    // highest impacts first and stopping once the rest cannot change the
+    // top, or after options.max_postings postings. Searches with
+    // FindTopDocuments while the impact index is missing or out of date.
+    std::vector<Document> FindTopDocumentsByImpact(
+        std::string_view raw_query,
+        DocumentStatus status = DocumentStatus::ACTUAL,
+        const ImpactSearchOptions &options = {}
+    ) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocumentsByImpact(
+        std::string_view raw_query,
+        DocumentPredicate document_predicate,
+        const ImpactSearchOptions &options = {}
+    ) const;
     
     void RemoveDocument(int document_id);
     void RemoveDocument(
@@ -98,25 +255,85 @@ public:
         const std::execution::sequenced_policy& policy, 
         int document_id
     );
+    // Removes the documents in one pass, visiting the posting list of each
+    // of their words once. Throws out_of_range and removes nothing if an id
+    // is unknown. Every removed document counts as one generation.
+    void RemoveDocuments(std::vector<int> document_ids);
+
+    // The built index as bytes: stop words, term dictionary, document
+    // table with the forward index, posting lists and settings, for
+    // LoadIndex on a machine with the same byte order.
+    std::string SerializeIndex() const;
+    // Replaces the index with one from SerializeIndex without parsing the
+    // texts again. The executor is kept; the impact index is not shipped
+    // and has to be built again. Throws invalid_argument and changes
+    // nothing if the data is not such an index.
+    void LoadIndex(std::string_view data);
+
+    // order of search results: by relevance, then by rating, then by id
+    static bool IsMoreRelevant(const Document &lhs, const Document &rhs);
+
+    // pool running ProcessQueries batches, shared by copies of the server
+    QueryExecutor &GetExecutor() const;
+    void SetExecutor(std::shared_ptr<QueryExecutor> executor);
+
+    // Brings a copy of the server to the state after one change, skipping
+    // the parsing and checks the change already passed.
+    using Change = std::function<void(SearchServer &)>;
+    // Appends the changes that succeed from now on to the log, nullptr
+    // stops recording. The log is not owned and is shared by copies.
+    void SetChangeLog(std::vector<Change> *changes);
+    // applies changes recorded on a server in the same state as this one
+    void Replay(const std::vector<Change> &changes);
 
 private:
-    std::set<std::string> words_;
+    std::shared_ptr<TextStorage> words_ = std::make_shared<TextStorage>();
     struct DocumentData {
         int rating;
         DocumentStatus status;
-        std::map<std::string_view,double> freqs;
+        // the number of words, see EncodeLengthNorm
+        uint8_t length_norm;
+        std::string_view text;
+        MinHashSketch min_hash;
     };
     std::set<std::string_view> stop_words_;
     
     std::map<std::string_view, std::map<int, double>> word_to_document_freqs_;
     std::map<int, DocumentData> documents_;
+    ForwardIndex forward_index_;
+    std::shared_ptr<QueryExecutor> executor_ = std::make_shared<QueryExecutor>();
     std::set<int> document_ids_;
+    uint64_t generation_ = 0;
+    size_t min_hash_size_ = 0;
+    ScoringModel scoring_model_;
+    // sum of the lengths the norms of the documents stand for
+    double total_length_ = 0;
+    std::shared_ptr<const ImpactIndex> impact_index_;
+    DuplicatePolicy duplicate_policy_ = DuplicatePolicy::ALLOW;
+    SignatureIndex signatures_;
+    std::set<int> flagged_duplicates_;
+    std::vector<Change> *change_log_ = nullptr;
 
     bool IsStopWord(std::string_view word) const;
     static bool IsValidWord(std::string_view word);
 
     std::vector<std::string_view> SplitIntoWordsNoStop(std::string_view text) const;
     static int ComputeAverageRating(const std::vector<int>& ratings);
+    // drops the document from the signature index, called before its
+    // forward index entry is removed
+    void ForgetSignature(int document_id);
+    // drops the document from the data kept for all documents
+    void ForgetDocument(int document_id);
+    // indexes a document whose text is already stored and checked
+    void IndexDocument(
+        int document_id,
+        std::string_view text,
+        DocumentStatus status,
+        int rating,
+        bool is_duplicate
+    );
+    template <typename Operation>
+    void Record(Operation operation);
 
     struct QueryWord {
         std::string_view data;
@@ -133,10 +350,29 @@ private:
     
     Query ParseQuery(std::string_view text, bool is_uniq=true) const;
     
-    double ComputeWordInverseDocumentFreq(std::string_view word) const;
+    // weight of the word for the scorer, counting the documents of corpus
+    // if it is set and of the server otherwise
+    template <typename Scorer>
+    double ComputeTermWeight(
+        const Scorer &scorer,
+        std::string_view word,
+        const CorpusStatistics *corpus = nullptr
+    ) const;
+    // average document length of corpus if it is set and of the server
+    // otherwise
+    double ComputeAverageDocumentLength(const CorpusStatistics *corpus) const;
     
+    // the posting loop of FindAllDocuments for one model
+    template <typename Scorer, typename DocumentPredicate>
+    void ScorePostings(
+        QueryContext &context,
+        const Query &query,
+        const Scorer &scorer,
+        DocumentPredicate document_predicate
+    ) const;
     template <typename DocumentPredicate>
-    std::vector<Document> FindAllDocuments(
+    void FindAllDocuments(
+        QueryContext &context,
         const Query &query,
         DocumentPredicate document_predicate
     ) const;
@@ -146,6 +382,17 @@ private:
         const Query &query,
         DocumentPredicate document_predicate
     ) const;
+
+    // moves the best MAX_RESULT_DOCUMENT_COUNT documents to the front
+    // in relevance order and returns them
+    static std::vector<Document> SelectTopDocuments(
+        std::vector<Document> &matched_documents
+    );
+    static SearchPage SelectPage(
+        const std::vector<Document> &matched_documents,
+        const SearchCursor &cursor,
+        size_t page_size
+    );
 };
 
 
@@ -160,9 +407,8 @@ void make_unique(
 template <typename StringContainer>
 SearchServer::SearchServer(const StringContainer &stop_words)
 {
-    for(std::string word: MakeUniqueNonEmptyStrings(stop_words)){
-        auto it = words_.insert(word);
-	stop_words_.insert(std::string_view(*(it.first)));
+    for(std::string_view word: MakeUniqueNonEmptyStrings(stop_words)){
+        stop_words_.insert(words_->Store(word));
     } 
     if (!std::all_of(stop_words_.begin(), stop_words_.end(), IsValidWord))
     {
@@ -170,7 +416,16 @@ SearchServer::SearchServer(const StringContainer &stop_words)
     }
 }
 
-template <typename Policy>
+template <typename Operation>
+void SearchServer::Record(Operation operation)
+{
+    if (change_log_ != nullptr)
+    {
+        change_log_->push_back(std::move(operation));
+    }
+}
+
+template <typename Policy, typename>
 std::vector<Document> SearchServer::FindTopDocuments(
     Policy policy,
     std::string_view raw_query
@@ -179,7 +434,7 @@ std::vector<Document> SearchServer::FindTopDocuments(
     return FindTopDocuments(policy, raw_query, DocumentStatus::ACTUAL);
 }
 
-template <typename Policy>
+template <typename Policy, typename>
 std::vector<Document> SearchServer::FindTopDocuments(
     Policy policy,
     std::string_view raw_query,
@@ -201,117 +456,314 @@ std::vector<Document> SearchServer::FindTopDocuments(
 }
 
 
+inline bool SearchServer::IsMoreRelevant(const Document &lhs, const Document &rhs)
+{
+    if (std::abs(lhs.relevance - rhs.relevance) < EPS)
+    {
+        if (lhs.rating == rhs.rating)
+        {
+            return lhs.id < rhs.id;
+        }
+        return lhs.rating > rhs.rating;
+    }
+    else
+    {
+        return lhs.relevance > rhs.relevance;
+    }
+}
+
+
 template <typename DocumentPredicate>
 std::vector<Document> SearchServer::FindTopDocuments(
     std::string_view raw_query,
     DocumentPredicate document_predicate
 ) const
 {
-    const Query query = ParseQuery(raw_query);
-    std::vector<Document> matched_documents = FindAllDocuments(
-        query, document_predicate
-    );
-    std::sort(
-        matched_documents.begin(),
-        matched_documents.end(),
-        [](const Document &lhs, const Document &rhs)
-        {
-            if (std::abs(lhs.relevance - rhs.relevance) < EPS)
-            {
-                return lhs.rating > rhs.rating;
-            }
-            else
-            {
-                return lhs.relevance > rhs.relevance;
-            }
-        }
-    );
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+    QueryContext context;
+    return FindTopDocuments(context, raw_query, document_predicate);
+}
+
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocuments(
+    QueryContext &context,
+    std::string_view raw_query,
+    DocumentPredicate document_predicate
+) const
+{
+    LOG_LATENCY(LatencyOperation::FIND_TOP_DOCUMENTS);
+    TRACE_SCOPE("FindTopDocuments");
+    QueryStats *stats = context.stats;
+    Query query;
+    {
+        TRACE_SCOPE("parse");
+        PhaseTimer timer(stats ? &stats->parse_time : nullptr);
+        query = ParseQuery(raw_query);
+    }
+    FindAllDocuments(context, query, document_predicate);
+    PhaseTimer timer(stats ? &stats->top_k_time : nullptr);
+    if (stats)
     {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        stats->candidates_sorted += context.matched_documents.size();
     }
-    return matched_documents;
+    return SelectTopDocuments(context.matched_documents);
 }
 
 
-template <typename Policy, typename DocumentPredicate>
+template <typename Policy, typename DocumentPredicate, typename>
 std::vector<Document> SearchServer::FindTopDocuments(
     Policy policy,
     std::string_view raw_query,
     DocumentPredicate document_predicate
 ) const
 {
-    const Query query = ParseQuery(raw_query);
+    LOG_LATENCY(LatencyOperation::FIND_TOP_DOCUMENTS);
+    TRACE_SCOPE("FindTopDocuments");
+    Query query;
+    {
+        TRACE_SCOPE("parse");
+        query = ParseQuery(raw_query);
+    }
     std::vector<Document> matched_documents = FindAllDocuments(
         policy, query, document_predicate
     );
-    std::sort(
-        matched_documents.begin(),
-        matched_documents.end(),
-        [](const Document &lhs, const Document &rhs)
-        {
-            if (std::abs(lhs.relevance - rhs.relevance) < EPS)
+    return SelectTopDocuments(matched_documents);
+}
+
+
+template <typename DocumentPredicate>
+SearchPage SearchServer::FindPage(
+    std::string_view raw_query,
+    DocumentPredicate document_predicate,
+    const SearchCursor &cursor,
+    size_t page_size
+) const
+{
+    TRACE_SCOPE("FindPage");
+    if (page_size == 0)
+    {
+        throw std::invalid_argument("Page size must be positive");
+    }
+    QueryContext context;
+    Query query;
+    {
+        TRACE_SCOPE("parse");
+        query = ParseQuery(raw_query);
+    }
+    FindAllDocuments(context, query, document_predicate);
+    return SelectPage(context.matched_documents, cursor, page_size);
+}
+
+
+template <typename DocumentPredicate>
+std::vector<Document> SearchServer::FindTopDocumentsByImpact(
+    std::string_view raw_query,
+    DocumentPredicate document_predicate,
+    const ImpactSearchOptions &options
+) const
+{
+    TRACE_SCOPE("FindTopDocumentsByImpact");
+    if (!HasImpactIndex())
+    {
+        QueryContext context;
+        context.stats = options.stats;
+        return FindTopDocuments(context, raw_query, document_predicate);
+    }
+    Query query;
+    {
+        TRACE_SCOPE("parse");
+        query = ParseQuery(raw_query);
+    }
+    TRACE_SCOPE("impact scan");
+    PhaseTimer timer(options.stats ? &options.stats->scan_time : nullptr);
+    return impact_index_->FindTopDocuments(
+        query.plus_words, query.minus_words, document_predicate,
+        MAX_RESULT_DOCUMENT_COUNT, options
+    );
+}
+
+
+template <typename DocumentPredicate>
+std::future<std::vector<Document>> SearchServer::FindTopDocumentsAsync(
+    std::string raw_query,
+    DocumentPredicate document_predicate,
+    CancellationToken token,
+    SearchCallback on_done
+) const
+{
+    auto promise = std::make_shared<std::promise<std::vector<Document>>>();
+    std::future<std::vector<Document>> result = promise->get_future();
+    executor_->Submit(
+        [
+            this,
+            promise,
+            raw_query = std::move(raw_query),
+            document_predicate,
+            token = std::move(token),
+            on_done = std::move(on_done)
+        ](QueryContext &context) {
+            std::vector<Document> documents;
+            std::exception_ptr error;
+            try
+            {
+                token.ThrowIfCancelled();
+                context.cancellation = &token;
+                documents = FindTopDocuments(context, raw_query, document_predicate);
+            }
+            catch (...)
+            {
+                error = std::current_exception();
+            }
+            context.cancellation = nullptr;
+            if (on_done)
+            {
+                try
+                {
+                    on_done(documents, error);
+                }
+                catch (...)
+                {
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                }
+            }
+            if (error)
             {
-                return lhs.rating > rhs.rating;
+                promise->set_exception(error);
             }
             else
             {
-                return lhs.relevance > rhs.relevance;
+                promise->set_value(std::move(documents));
             }
         }
     );
-    if (matched_documents.size() > MAX_RESULT_DOCUMENT_COUNT)
+    return result;
+}
+
+
+template <typename Scorer>
+double SearchServer::ComputeTermWeight(
+    const Scorer &scorer,
+    std::string_view word,
+    const CorpusStatistics *corpus
+) const
+{
+    if (corpus == nullptr)
     {
-        matched_documents.resize(MAX_RESULT_DOCUMENT_COUNT);
+        return scorer.GetTermWeight(
+            GetDocumentCount(), word_to_document_freqs_.at(word).size()
+        );
     }
-    return matched_documents;
+    return scorer.GetTermWeight(corpus->document_count, corpus->document_freq(word));
 }
 
 
-template <typename DocumentPredicate>
-std::vector<Document> SearchServer::FindAllDocuments(
+template <typename Scorer, typename DocumentPredicate>
+void SearchServer::ScorePostings(
+    QueryContext &context,
     const Query &query,
+    const Scorer &scorer,
     DocumentPredicate document_predicate
 ) const
 {
-    std::map<int, double> document_to_relevance;
+    auto &document_to_relevance = context.document_to_relevance;
+    QueryStats *stats = context.stats;
+    TRACE_SCOPE("posting scan");
+    PhaseTimer timer(stats ? &stats->scan_time : nullptr);
+    uint64_t terms_resolved = 0;
+    uint64_t postings_scanned = 0;
     for (std::string_view word: query.plus_words)
     {
+        if (context.cancellation)
+        {
+            context.cancellation->ThrowIfCancelled();
+        }
         if (word_to_document_freqs_.count(word) == 0)
         {
             continue;
         }
-        const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-        for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word))
+        const double term_weight = ComputeTermWeight(scorer, word, context.corpus);
+        const auto &postings = word_to_document_freqs_.at(word);
+        ++terms_resolved;
+        postings_scanned += postings.size();
+        for (const auto& [document_id, term_freq] : postings)
         {
             const auto& document_data = documents_.at(document_id);
             if (document_predicate(document_id, document_data.status, document_data.rating))
             {
-                document_to_relevance[document_id] += term_freq * inverse_document_freq;
+                document_to_relevance[document_id] += scorer(
+                    term_freq, document_data.length_norm, term_weight
+                );
             }
         }
     }
-    for (std::string_view word : query.minus_words)
+    if (stats)
     {
-        if (word_to_document_freqs_.count(word) == 0)
+        stats->terms_resolved += terms_resolved;
+        stats->postings_scanned += postings_scanned;
+        // the predicate is evaluated once per posting
+        stats->predicate_evaluations += postings_scanned;
+        stats->documents_scored += document_to_relevance.size();
+    }
+}
+
+
+template <typename DocumentPredicate>
+void SearchServer::FindAllDocuments(
+    QueryContext &context,
+    const Query &query,
+    DocumentPredicate document_predicate
+) const
+{
+    auto &document_to_relevance = context.document_to_relevance;
+    document_to_relevance.clear();
+    QueryStats *stats = context.stats;
+    // one dispatch per search, the posting loop is compiled per model
+    std::visit(
+        [&](const auto &model) {
+            ScorePostings(
+                context, query,
+                model.MakeScorer(ComputeAverageDocumentLength(context.corpus)),
+                document_predicate
+            );
+        },
+        scoring_model_
+    );
+    {
+        TRACE_SCOPE("filter");
+        PhaseTimer timer(stats ? &stats->filter_time : nullptr);
+        uint64_t terms_resolved = 0;
+        uint64_t documents_excluded = 0;
+        for (std::string_view word : query.minus_words)
         {
-            continue;
+            if (word_to_document_freqs_.count(word) == 0)
+            {
+                continue;
+            }
+            ++terms_resolved;
+            for (const auto& [document_id, _] : word_to_document_freqs_.at(word))
+            {
+                documents_excluded += document_to_relevance.erase(document_id);
+            }
         }
-        for (const auto& [document_id, _] : word_to_document_freqs_.at(word))
+        if (stats)
         {
-            document_to_relevance.erase(document_id);
+            stats->terms_resolved += terms_resolved;
+            stats->documents_excluded += documents_excluded;
         }
     }
-    std::vector<Document> matched_documents;
+    TRACE_SCOPE("collect");
+    PhaseTimer timer(stats ? &stats->top_k_time : nullptr);
+    auto &matched_documents = context.matched_documents;
+    matched_documents.clear();
     for (const auto& [document_id, relevance] : document_to_relevance)
     {
-        //if(0<relevance) {
-            matched_documents.push_back(
-                {document_id, relevance, documents_.at(document_id).rating}
-            );
-        //}
+        matched_documents.push_back(
+            {document_id, relevance, documents_.at(document_id).rating}
+        );
     }
-    return matched_documents;
 }
 
 
@@ -329,36 +781,50 @@ std::vector<Document> SearchServer::FindAllDocuments(
     )
     {
         ConcurrentMap<int, double> document_to_relevance;
-        std::for_each(
-            policy, query.plus_words.begin(), query.plus_words.end(),
-            [&](std::string_view word){
+        {
+            TRACE_SCOPE("posting scan");
+            std::visit(
+                [&](const auto &model) {
+                    const auto scorer = model.MakeScorer(GetAverageDocumentLength());
+                    std::for_each(
+                        policy, query.plus_words.begin(), query.plus_words.end(),
+                        [&](std::string_view word){
+                            if (word_to_document_freqs_.count(word) == 0)
+                            { return; }
+                            const double term_weight = ComputeTermWeight(scorer, word);
+                            for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word))
+                            {
+                                const auto& document_data = documents_.at(document_id);
+                                if (
+                                    document_predicate(
+                                        document_id, document_data.status, document_data.rating
+                                    )
+                                )
+                                {
+                                    auto value = scorer(
+                                        term_freq, document_data.length_norm, term_weight
+                                    );
+                                    document_to_relevance[document_id].ref_to_value += value;
+                                }
+                            }
+                        }
+                    );
+                },
+                scoring_model_
+            );
+        }
+        {
+            TRACE_SCOPE("filter");
+            for (std::string_view word : query.minus_words)
+            {
                 if (word_to_document_freqs_.count(word) == 0)
-                { return; }
-                const double inverse_document_freq = ComputeWordInverseDocumentFreq(word);
-                for (const auto& [document_id, term_freq] : word_to_document_freqs_.at(word))
                 {
-                    const auto& document_data = documents_.at(document_id);
-                    if (
-                        document_predicate(
-                            document_id, document_data.status, document_data.rating
-                        )
-                    )
-                    {
-                        auto value = term_freq * inverse_document_freq;
-                        document_to_relevance[document_id].ref_to_value += value;
-                    }
+                    continue;
+                }
+                for (const auto& [document_id, _] : word_to_document_freqs_.at(word))
+                {
+                    document_to_relevance.erase(document_id);
                 }
-            }
-        );
-        for (std::string_view word : query.minus_words)
-        {
-            if (word_to_document_freqs_.count(word) == 0)
-            {
-                continue;
-            }
-            for (const auto& [document_id, _] : word_to_document_freqs_.at(word))
-            {
-                document_to_relevance.erase(document_id);
             }
         }
         std::vector<Document> matched_documents;
@@ -374,6 +840,8 @@ std::vector<Document> SearchServer::FindAllDocuments(
     }
     else
     {
-      return FindAllDocuments(query, document_predicate);
+        QueryContext context;
+        FindAllDocuments(context, query, document_predicate);
+        return std::move(context.matched_documents);
     }
 }
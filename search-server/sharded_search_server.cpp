@@ -0,0 +1,232 @@
+#include "sharded_search_server.h"
+#include <cstdint>
+#include <queue>
+#include <unordered_map>
+#include <utility>
+
+using namespace std;
+
+size_t GetPartitionIndex(int document_id, size_t partition_count)
+{
+    // Fibonacci hashing spreads runs of consecutive ids over all partitions
+    const uint64_t hash = static_cast<uint64_t>(document_id) * 0x9E3779B97F4A7C15ull;
+    return (hash >> 32) % partition_count;
+}
+
+ShardedSearchServer::ShardedSearchServer(
+    size_t shard_count,
+    const std::string &stop_words
+)
+    : ShardedSearchServer(shard_count, std::string_view(stop_words))
+{
+}
+
+ShardedSearchServer::ShardedSearchServer(
+    size_t shard_count,
+    std::string_view stop_words
+)
+    : ShardedSearchServer(shard_count, SplitIntoWords(stop_words))
+{
+}
+
+void ShardedSearchServer::AddDocument(
+    int document_id,
+    const std::string &document,
+    DocumentStatus status,
+    const std::vector<int> &ratings
+)
+{
+    if (document_id < 0)
+    {
+        throw invalid_argument("Invalid document_id"s);
+    }
+    shards_[GetShardIndex(document_id)].AddDocument(
+        document_id, document, status, ratings
+    );
+}
+
+void ShardedSearchServer::AddDocuments(const std::vector<NewDocument> &documents)
+{
+    vector<vector<const NewDocument *>> shard_documents(shards_.size());
+    for (const NewDocument &document : documents)
+    {
+        if (document.id < 0)
+        {
+            throw invalid_argument("Invalid document_id"s);
+        }
+        shard_documents[GetShardIndex(document.id)].push_back(&document);
+    }
+    executor_->ParallelFor(
+        shards_.size(),
+        [&](QueryContext &, size_t shard_index) {
+            for (const NewDocument *document : shard_documents[shard_index])
+            {
+                shards_[shard_index].AddDocument(
+                    document->id, document->text, document->status, document->ratings
+                );
+            }
+        }
+    );
+}
+
+void ShardedSearchServer::RemoveDocument(int document_id)
+{
+    shards_.at(GetShardIndex(document_id)).RemoveDocument(document_id);
+}
+
+void ShardedSearchServer::SetScoringModel(ScoringModel model)
+{
+    for (SearchServer &shard : shards_)
+    {
+        shard.SetScoringModel(model);
+    }
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+    std::string_view raw_query
+) const
+{
+    return FindTopDocuments(raw_query, DocumentStatus::ACTUAL);
+}
+
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+    std::string_view raw_query,
+    DocumentStatus status
+) const
+{
+    return FindTopDocuments(
+        raw_query,
+        [status](int document_id, DocumentStatus document_status, int rating) {
+            return document_status == status;
+        }
+    );
+}
+
+MatchType ShardedSearchServer::MatchDocument(
+    std::string_view raw_query,
+    int document_id
+) const
+{
+    return shards_[GetShardIndex(document_id)].MatchDocument(raw_query, document_id);
+}
+
+WordFrequencies ShardedSearchServer::GetWordFrequencies(int document_id) const
+{
+    return shards_[GetShardIndex(document_id)].GetWordFrequencies(document_id);
+}
+
+int ShardedSearchServer::GetDocumentCount() const
+{
+    int document_count = 0;
+    for (const SearchServer &shard : shards_)
+    {
+        document_count += shard.GetDocumentCount();
+    }
+    return document_count;
+}
+
+int ShardedSearchServer::GetDocumentFreq(std::string_view word) const
+{
+    int document_freq = 0;
+    for (const SearchServer &shard : shards_)
+    {
+        document_freq += shard.GetDocumentFreq(word);
+    }
+    return document_freq;
+}
+
+double ShardedSearchServer::GetTotalDocumentLength() const
+{
+    double total_length = 0;
+    for (const SearchServer &shard : shards_)
+    {
+        total_length += shard.GetTotalDocumentLength();
+    }
+    return total_length;
+}
+
+size_t ShardedSearchServer::GetShardCount() const
+{
+    return shards_.size();
+}
+
+const SearchServer &ShardedSearchServer::GetShard(size_t shard_index) const
+{
+    return shards_.at(shard_index);
+}
+
+size_t ShardedSearchServer::GetShardIndex(int document_id) const
+{
+    return GetPartitionIndex(document_id, shards_.size());
+}
+
+QueryExecutor &ShardedSearchServer::GetExecutor() const
+{
+    return *executor_;
+}
+
+CorpusStatistics ShardedSearchServer::GetCorpusStatistics(std::string_view raw_query) const
+{
+    // the global document frequency of every plus word of the query,
+    // summed over the shards once instead of by every shard
+    unordered_map<std::string_view, int> document_freqs;
+    for (std::string_view word : SplitIntoWords(raw_query))
+    {
+        if (!word.empty() && word[0] != '-')
+        {
+            document_freqs.emplace(word, 0);
+        }
+    }
+    for (auto &[word, document_freq] : document_freqs)
+    {
+        document_freq = GetDocumentFreq(word);
+    }
+    return {
+        GetDocumentCount(),
+        GetTotalDocumentLength(),
+        [this, document_freqs = move(document_freqs)](std::string_view word) {
+            const auto it = document_freqs.find(word);
+            return it == document_freqs.end() ? GetDocumentFreq(word) : it->second;
+        }
+    };
+}
+
+std::vector<Document> ShardedSearchServer::MergeTopDocuments(
+    const std::vector<std::vector<Document>> &shard_documents
+)
+{
+    TRACE_SCOPE("merge");
+    // (shard, position in its result) of the best document not yet merged
+    using Cursor = pair<size_t, size_t>;
+    auto is_less_relevant = [&shard_documents](const Cursor &lhs, const Cursor &rhs) {
+        return SearchServer::IsMoreRelevant(
+            shard_documents[rhs.first][rhs.second],
+            shard_documents[lhs.first][lhs.second]
+        );
+    };
+    priority_queue<Cursor, vector<Cursor>, decltype(is_less_relevant)> heads(
+        is_less_relevant
+    );
+    for (size_t shard_index = 0; shard_index < shard_documents.size(); ++shard_index)
+    {
+        if (!shard_documents[shard_index].empty())
+        {
+            heads.push({shard_index, 0});
+        }
+    }
+    vector<Document> result;
+    while (
+        !heads.empty()
+        && result.size() < static_cast<size_t>(MAX_RESULT_DOCUMENT_COUNT)
+    )
+    {
+        const auto [shard_index, position] = heads.top();
+        heads.pop();
+        result.push_back(shard_documents[shard_index][position]);
+        if (position + 1 < shard_documents[shard_index].size())
+        {
+            heads.push({shard_index, position + 1});
+        }
+    }
+    return result;
+}
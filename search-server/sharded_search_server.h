@@ -0,0 +1,126 @@
+#pragma once
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+
+// document passed to bulk ingestion
+struct NewDocument {
+    int id;
+    std::string text;
+    DocumentStatus status;
+    std::vector<int> ratings;
+};
+
+// partition of [0, partition_count) the document belongs to
+size_t GetPartitionIndex(int document_id, size_t partition_count);
+
+// Index partitioned by document id into independent SearchServer shards.
+// A query is searched on all shards in parallel with IDF and the average
+// document length computed over the whole corpus, and the per-shard top
+// documents are merged, so the results are the same as those of a single
+// SearchServer holding all documents under either scoring model.
+// Shards share one executor.
+class ShardedSearchServer
+{
+public:
+    template <typename StringContainer>
+    ShardedSearchServer(size_t shard_count, const StringContainer &stop_words);
+    ShardedSearchServer(size_t shard_count, const std::string &stop_words);
+    ShardedSearchServer(size_t shard_count, std::string_view stop_words);
+
+    void AddDocument(
+        int document_id,
+        const std::string &document,
+        DocumentStatus status,
+        const std::vector<int> &ratings
+    );
+    // adds documents to all shards in parallel
+    void AddDocuments(const std::vector<NewDocument> &documents);
+    void RemoveDocument(int document_id);
+    // sets the model of every shard
+    void SetScoringModel(ScoringModel model);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(
+        std::string_view raw_query,
+        DocumentStatus status
+    ) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(
+        std::string_view raw_query,
+        DocumentPredicate document_predicate
+    ) const;
+
+    MatchType MatchDocument(std::string_view raw_query, int document_id) const;
+    WordFrequencies GetWordFrequencies(int document_id) const;
+    int GetDocumentCount() const;
+    int GetDocumentFreq(std::string_view word) const;
+    double GetTotalDocumentLength() const;
+
+    size_t GetShardCount() const;
+    const SearchServer &GetShard(size_t shard_index) const;
+    size_t GetShardIndex(int document_id) const;
+    QueryExecutor &GetExecutor() const;
+
+private:
+    std::vector<SearchServer> shards_;
+    std::shared_ptr<QueryExecutor> executor_ = std::make_shared<QueryExecutor>();
+
+    // statistics of all shards, with the document frequencies of the
+    // words of the query, which must outlive them, computed up front
+    CorpusStatistics GetCorpusStatistics(std::string_view raw_query) const;
+    // k-way merge of the per-shard results sorted by SearchServer::IsMoreRelevant
+    static std::vector<Document> MergeTopDocuments(
+        const std::vector<std::vector<Document>> &shard_documents
+    );
+};
+
+template <typename StringContainer>
+ShardedSearchServer::ShardedSearchServer(
+    size_t shard_count,
+    const StringContainer &stop_words
+)
+{
+    if (shard_count == 0)
+    {
+        throw std::invalid_argument("Shard count must be positive");
+    }
+    shards_.reserve(shard_count);
+    for (size_t i = 0; i < shard_count; ++i)
+    {
+        shards_.emplace_back(stop_words);
+        shards_.back().SetExecutor(executor_);
+    }
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> ShardedSearchServer::FindTopDocuments(
+    std::string_view raw_query,
+    DocumentPredicate document_predicate
+) const
+{
+    const CorpusStatistics corpus = GetCorpusStatistics(raw_query);
+    std::vector<std::vector<Document>> shard_documents(shards_.size());
+    executor_->ParallelFor(
+        shards_.size(),
+        [&](QueryContext &context, size_t shard_index) {
+            context.corpus = &corpus;
+            try
+            {
+                shard_documents[shard_index] = shards_[shard_index].FindTopDocuments(
+                    context, raw_query, document_predicate
+                );
+            }
+            catch (...)
+            {
+                context.corpus = nullptr;
+                throw;
+            }
+            context.corpus = nullptr;
+        }
+    );
+    return MergeTopDocuments(shard_documents);
+}
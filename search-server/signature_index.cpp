@@ -0,0 +1,113 @@
+#include "signature_index.h"
+
+#include <algorithm>
+#include <string>
+
+using namespace std;
+using namespace std::literals;
+
+DuplicateDocumentError::DuplicateDocumentError(int document_id, int original_id)
+    : invalid_argument(
+          "Document "s + to_string(document_id) + " duplicates document "s + to_string(original_id)
+      ),
+      document_id_(document_id),
+      original_id_(original_id)
+{
+}
+
+int DuplicateDocumentError::GetDocumentId() const
+{
+    return document_id_;
+}
+
+int DuplicateDocumentError::GetOriginalId() const
+{
+    return original_id_;
+}
+
+SignatureIndex::SignatureIndex(size_t stripe_count)
+    : stripes_(max<size_t>(1, stripe_count))
+{
+}
+
+SignatureIndex::SignatureIndex(const SignatureIndex &other)
+    : stripes_(other.stripes_.size())
+{
+    for (size_t i = 0; i < stripes_.size(); ++i)
+    {
+        lock_guard guard(other.stripes_[i].mx_);
+        stripes_[i].documents_ = other.stripes_[i].documents_;
+    }
+}
+
+SignatureIndex &SignatureIndex::operator=(const SignatureIndex &other)
+{
+    if (this != &other)
+    {
+        SignatureIndex copy(other);
+        stripes_ = vector<Stripe>(copy.stripes_.size());
+        for (size_t i = 0; i < stripes_.size(); ++i)
+        {
+            stripes_[i].documents_ = move(copy.stripes_[i].documents_);
+        }
+    }
+    return *this;
+}
+
+void SignatureIndex::Insert(const TermSetSignature &signature, int document_id)
+{
+    Stripe &stripe = GetStripe(signature);
+    lock_guard guard(stripe.mx_);
+    stripe.documents_[signature].push_back(document_id);
+}
+
+void SignatureIndex::Erase(const TermSetSignature &signature, int document_id)
+{
+    Stripe &stripe = GetStripe(signature);
+    lock_guard guard(stripe.mx_);
+    const auto it = stripe.documents_.find(signature);
+    if (it == stripe.documents_.end())
+    {
+        return;
+    }
+    auto &document_ids = it->second;
+    document_ids.erase(remove(document_ids.begin(), document_ids.end(), document_id), document_ids.end());
+    if (document_ids.empty())
+    {
+        stripe.documents_.erase(it);
+    }
+}
+
+void SignatureIndex::Clear()
+{
+    for (Stripe &stripe : stripes_)
+    {
+        lock_guard guard(stripe.mx_);
+        stripe.documents_.clear();
+    }
+}
+
+size_t SignatureIndex::GetSize() const
+{
+    size_t size = 0;
+    for (const Stripe &stripe : stripes_)
+    {
+        lock_guard guard(stripe.mx_);
+        for (const auto &[signature, document_ids] : stripe.documents_)
+        {
+            size += document_ids.size();
+        }
+    }
+    return size;
+}
+
+SignatureIndex::Stripe &SignatureIndex::GetStripe(const TermSetSignature &signature)
+{
+    // low selects the bucket inside the stripe
+    return stripes_[signature.high % stripes_.size()];
+}
+
+const SignatureIndex::Stripe &SignatureIndex::GetStripe(const TermSetSignature &signature) const
+{
+    return stripes_[signature.high % stripes_.size()];
+}
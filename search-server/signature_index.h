@@ -0,0 +1,86 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include "term_set_signature.h"
+
+// what AddDocument does with a document whose words equal those of a
+// document already in the index
+enum class DuplicatePolicy {
+    // add it without checking, the default
+    ALLOW,
+    // add it and list it in GetFlaggedDuplicates
+    FLAG,
+    // throw DuplicateDocumentError and leave the index unchanged
+    REJECT,
+};
+
+class DuplicateDocumentError : public std::invalid_argument
+{
+public:
+    DuplicateDocumentError(int document_id, int original_id);
+
+    int GetDocumentId() const;
+    // the document already in the index with the same words
+    int GetOriginalId() const;
+
+private:
+    int document_id_;
+    int original_id_;
+};
+
+// Documents by the signature of their term set. The signatures are split
+// between stripes with a lock each, so documents may be filed and looked
+// up from several threads at once. Copies are independent.
+class SignatureIndex
+{
+public:
+    explicit SignatureIndex(size_t stripe_count = 64);
+    SignatureIndex(const SignatureIndex &other);
+    SignatureIndex &operator=(const SignatureIndex &other);
+
+    void Insert(const TermSetSignature &signature, int document_id);
+    void Erase(const TermSetSignature &signature, int document_id);
+    // the first document filed under the signature for which
+    // is_same(document_id) holds; is_same tells hash collisions apart
+    template <typename Predicate>
+    std::optional<int> Find(const TermSetSignature &signature, Predicate is_same) const;
+
+    void Clear();
+    size_t GetSize() const;
+
+private:
+    struct Stripe {
+        mutable std::mutex mx_;
+        std::unordered_map<TermSetSignature, std::vector<int>, TermSetSignatureHasher> documents_;
+    };
+
+    std::vector<Stripe> stripes_;
+
+    Stripe &GetStripe(const TermSetSignature &signature);
+    const Stripe &GetStripe(const TermSetSignature &signature) const;
+};
+
+template <typename Predicate>
+std::optional<int> SignatureIndex::Find(const TermSetSignature &signature, Predicate is_same) const
+{
+    const Stripe &stripe = GetStripe(signature);
+    std::lock_guard guard(stripe.mx_);
+    const auto it = stripe.documents_.find(signature);
+    if (it == stripe.documents_.end())
+    {
+        return std::nullopt;
+    }
+    for (int document_id : it->second)
+    {
+        if (is_same(document_id))
+        {
+            return document_id;
+        }
+    }
+    return std::nullopt;
+}
@@ -0,0 +1,194 @@
+#include "slow_query_log.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+using namespace std;
+using namespace std::literals;
+
+SlowQueryLog::SlowQueryLog(std::chrono::nanoseconds threshold, size_t capacity)
+    : threshold_(threshold),
+      capacity_(max<size_t>(1, capacity)),
+      slots_(make_unique<Slot[]>(capacity_))
+{
+}
+
+std::chrono::nanoseconds SlowQueryLog::GetThreshold() const
+{
+    return threshold_;
+}
+
+bool SlowQueryLog::IsSlow(std::chrono::nanoseconds latency) const
+{
+    return latency >= threshold_;
+}
+
+void SlowQueryLog::Record(
+    std::string_view raw_query,
+    std::optional<DocumentStatus> status,
+    std::chrono::nanoseconds latency,
+    uint64_t generation,
+    const QueryStats &stats
+)
+{
+    if (!IsSlow(latency))
+    {
+        return;
+    }
+    const uint64_t index = next_index_.fetch_add(1, memory_order_relaxed);
+    Slot &slot = slots_[index % capacity_];
+    uint64_t sequence = slot.sequence.load(memory_order_relaxed);
+    if (sequence % 2 == 1
+        || !slot.sequence.compare_exchange_strong(sequence, sequence + 1, memory_order_acquire))
+    {
+        return;
+    }
+    // the odd sequence must be visible before any of the new contents
+    atomic_thread_fence(memory_order_release);
+    slot.index = index;
+    slot.raw_query_size = min(raw_query.size(), MAX_QUERY_SIZE);
+    memcpy(slot.raw_query, raw_query.data(), slot.raw_query_size);
+    slot.status = status ? static_cast<int>(*status) : -1;
+    slot.latency_ns = latency.count();
+    slot.generation = generation;
+    slot.stats = stats;
+    slot.time_ns = chrono::duration_cast<chrono::nanoseconds>(
+        chrono::system_clock::now().time_since_epoch()
+    ).count();
+    slot.sequence.store(sequence + 2, memory_order_release);
+}
+
+std::vector<SlowQuery> SlowQueryLog::GetEntries() const
+{
+    vector<pair<uint64_t, SlowQuery>> entries;
+    for (size_t i = 0; i < capacity_; ++i)
+    {
+        const Slot &slot = slots_[i];
+        const uint64_t sequence = slot.sequence.load(memory_order_acquire);
+        if (sequence == 0 || sequence % 2 == 1)
+        {
+            continue;
+        }
+        SlowQuery query;
+        const uint64_t index = slot.index;
+        query.raw_query.assign(slot.raw_query, min(slot.raw_query_size, MAX_QUERY_SIZE));
+        if (slot.status >= 0)
+        {
+            query.status = static_cast<DocumentStatus>(slot.status);
+        }
+        query.latency = chrono::nanoseconds(slot.latency_ns);
+        query.generation = slot.generation;
+        query.stats = slot.stats;
+        query.time = chrono::system_clock::time_point(
+            chrono::duration_cast<chrono::system_clock::duration>(chrono::nanoseconds(slot.time_ns))
+        );
+        // a writer took the slot while it was copied
+        atomic_thread_fence(memory_order_acquire);
+        if (slot.sequence.load(memory_order_relaxed) != sequence)
+        {
+            continue;
+        }
+        entries.emplace_back(index, move(query));
+    }
+    sort(entries.begin(), entries.end(), [](const auto &lhs, const auto &rhs) {
+        return lhs.first < rhs.first;
+    });
+    vector<SlowQuery> queries;
+    queries.reserve(entries.size());
+    for (auto &[index, query] : entries)
+    {
+        queries.push_back(move(query));
+    }
+    return queries;
+}
+
+uint64_t SlowQueryLog::GetRecordedCount() const
+{
+    return next_index_.load(memory_order_relaxed);
+}
+
+void WriteSlowQueries(std::ostream &os, const std::vector<SlowQuery> &queries)
+{
+    for (const SlowQuery &query : queries)
+    {
+        const QueryStats &stats = query.stats;
+        os << chrono::duration_cast<chrono::milliseconds>(query.time.time_since_epoch()).count()
+           << '\t' << query.generation
+           << '\t' << query.latency.count()
+           << '\t' << (query.status ? GetStatusName(*query.status) : "PREDICATE"sv)
+           << '\t' << stats.terms_resolved
+           << '\t' << stats.postings_scanned
+           << '\t' << stats.predicate_evaluations
+           << '\t' << stats.documents_scored
+           << '\t' << stats.documents_excluded
+           << '\t' << stats.candidates_sorted
+           << '\t' << stats.parse_time.count()
+           << '\t' << stats.scan_time.count()
+           << '\t' << stats.filter_time.count()
+           << '\t' << stats.top_k_time.count()
+           << '\t';
+        // keep one entry per line
+        for (char c : query.raw_query)
+        {
+            os << (c == '\n' || c == '\t' ? ' ' : c);
+        }
+        os << '\n';
+    }
+}
+
+std::vector<SlowQuery> ReadSlowQueries(std::istream &is)
+{
+    vector<SlowQuery> queries;
+    string line;
+    while (getline(is, line))
+    {
+        if (line.empty())
+        {
+            continue;
+        }
+        const size_t query_start = [&line] {
+            size_t position = 0;
+            for (int field = 0; field < 14; ++field)
+            {
+                position = line.find('\t', position);
+                if (position == string::npos)
+                {
+                    throw invalid_argument("Malformed slow query line: "s + line);
+                }
+                ++position;
+            }
+            return position;
+        }();
+        istringstream fields(line.substr(0, query_start));
+        SlowQuery query;
+        int64_t time_ms = 0;
+        int64_t latency_ns = 0;
+        string status;
+        int64_t parse_ns = 0;
+        int64_t scan_ns = 0;
+        int64_t filter_ns = 0;
+        int64_t top_k_ns = 0;
+        QueryStats &stats = query.stats;
+        fields >> time_ms >> query.generation >> latency_ns >> status
+               >> stats.terms_resolved >> stats.postings_scanned
+               >> stats.predicate_evaluations >> stats.documents_scored
+               >> stats.documents_excluded >> stats.candidates_sorted
+               >> parse_ns >> scan_ns >> filter_ns >> top_k_ns;
+        if (!fields)
+        {
+            throw invalid_argument("Malformed slow query line: "s + line);
+        }
+        query.time = chrono::system_clock::time_point(
+            chrono::duration_cast<chrono::system_clock::duration>(chrono::milliseconds(time_ms))
+        );
+        query.latency = chrono::nanoseconds(latency_ns);
+        query.status = ParseStatus(status);
+        stats.parse_time = chrono::nanoseconds(parse_ns);
+        stats.scan_time = chrono::nanoseconds(scan_ns);
+        stats.filter_time = chrono::nanoseconds(filter_ns);
+        stats.top_k_time = chrono::nanoseconds(top_k_ns);
+        query.raw_query = line.substr(query_start);
+        queries.push_back(move(query));
+    }
+    return queries;
+}
@@ -0,0 +1,81 @@
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "document.h"
+#include "query_stats.h"
+
+// a search that took longer than the threshold of the log
+struct SlowQuery {
+    std::string raw_query;
+    // nullopt for a search with a custom predicate
+    std::optional<DocumentStatus> status;
+    std::chrono::nanoseconds latency{0};
+    // generation of the searched index
+    uint64_t generation = 0;
+    QueryStats stats;
+    std::chrono::system_clock::time_point time;
+};
+
+// Bounded log of the last slow searches. Every entry is a fixed-size slot
+// guarded by a sequence counter, so recording takes no lock and allocates
+// nothing, and readers copy entries without stopping the writers. A record
+// finding its slot busy with another writer is dropped.
+class SlowQueryLog
+{
+public:
+    // longer queries are truncated
+    static constexpr size_t MAX_QUERY_SIZE = 480;
+
+    explicit SlowQueryLog(std::chrono::nanoseconds threshold, size_t capacity = 1024);
+
+    std::chrono::nanoseconds GetThreshold() const;
+    bool IsSlow(std::chrono::nanoseconds latency) const;
+
+    // records the search if it is slow
+    void Record(
+        std::string_view raw_query,
+        std::optional<DocumentStatus> status,
+        std::chrono::nanoseconds latency,
+        uint64_t generation,
+        const QueryStats &stats
+    );
+    // the kept entries, oldest first
+    std::vector<SlowQuery> GetEntries() const;
+    // number of slow searches recorded so far, including overwritten ones
+    uint64_t GetRecordedCount() const;
+
+private:
+    struct Slot {
+        // odd while the slot is written, 0 if it was never written
+        std::atomic<uint64_t> sequence{0};
+        uint64_t index = 0;
+        char raw_query[MAX_QUERY_SIZE];
+        size_t raw_query_size = 0;
+        // -1 for a custom predicate
+        int status = -1;
+        int64_t latency_ns = 0;
+        uint64_t generation = 0;
+        QueryStats stats;
+        int64_t time_ns = 0;
+    };
+
+    const std::chrono::nanoseconds threshold_;
+    const size_t capacity_;
+    std::unique_ptr<Slot[]> slots_;
+    std::atomic<uint64_t> next_index_{0};
+};
+
+// One tab separated line per entry: time, generation, latency, status, the
+// counters and phase times of QueryStats and the query. ReadSlowQueries
+// parses the same format.
+void WriteSlowQueries(std::ostream &os, const std::vector<SlowQuery> &queries);
+std::vector<SlowQuery> ReadSlowQueries(std::istream &is);
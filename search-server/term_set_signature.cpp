@@ -0,0 +1,61 @@
+#include "term_set_signature.h"
+
+#include <algorithm>
+
+using namespace std;
+
+namespace {
+
+// finalizer of MurmurHash3
+uint64_t Mix(uint64_t value)
+{
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccdULL;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53ULL;
+    value ^= value >> 33;
+    return value;
+}
+
+// term_id(item) gives the term id of an item of the sorted range
+template <typename It, typename GetTermId>
+TermSetSignature ComputeSignature(It begin, It end, GetTermId term_id_of)
+{
+    // two chains with different constants give independent halves
+    TermSetSignature signature{0x243f6a8885a308d3ULL, 0x13198a2e03707344ULL};
+    uint64_t size = 0;
+    for (It it = begin; it != end; ++it, ++size)
+    {
+        const auto term_id = static_cast<uint64_t>(static_cast<uint32_t>(term_id_of(*it)));
+        signature.low = Mix(signature.low ^ (term_id * 0x9e3779b97f4a7c15ULL));
+        signature.high = Mix(signature.high + (term_id ^ 0xa4093822299f31d0ULL) * 0xc2b2ae3d27d4eb4fULL);
+    }
+    signature.low ^= size;
+    signature.high ^= Mix(size);
+    return signature;
+}
+
+}
+
+TermSetSignature ComputeTermSetSignature(const WordFrequencies &word_frequencies)
+{
+    return ComputeSignature(
+        word_frequencies.TermsBegin(), word_frequencies.TermsEnd(),
+        [](const TermFrequency &entry) { return entry.term_id; }
+    );
+}
+
+TermSetSignature ComputeTermSetSignature(const vector<int> &term_ids)
+{
+    return ComputeSignature(term_ids.begin(), term_ids.end(), [](int term_id) { return term_id; });
+}
+
+bool HaveSameTerms(const WordFrequencies &lhs, const WordFrequencies &rhs)
+{
+    return equal(
+        lhs.TermsBegin(), lhs.TermsEnd(), rhs.TermsBegin(), rhs.TermsEnd(),
+        [](const TermFrequency &lhs_entry, const TermFrequency &rhs_entry) {
+            return lhs_entry.term_id == rhs_entry.term_id;
+        }
+    );
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "forward_index.h"
+
+// 128-bit hash of the set of term ids of a document. Documents with the
+// same words have the same signature whatever the word frequencies; term
+// ids are local to an index, so signatures of different indexes cannot be
+// compared.
+struct TermSetSignature {
+    uint64_t low = 0;
+    uint64_t high = 0;
+
+    bool operator==(const TermSetSignature &other) const
+    {
+        return low == other.low && high == other.high;
+    }
+
+    bool operator!=(const TermSetSignature &other) const
+    {
+        return !(*this == other);
+    }
+};
+
+struct TermSetSignatureHasher {
+    size_t operator()(const TermSetSignature &signature) const
+    {
+        return static_cast<size_t>(signature.low);
+    }
+};
+
+TermSetSignature ComputeTermSetSignature(const WordFrequencies &word_frequencies);
+// term_ids must be sorted and unique; equals the signature of a document
+// with these terms
+TermSetSignature ComputeTermSetSignature(const std::vector<int> &term_ids);
+
+// exact check behind an equal signature
+bool HaveSameTerms(const WordFrequencies &lhs, const WordFrequencies &rhs);
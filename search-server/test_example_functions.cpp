@@ -1,6 +1,18 @@
 #include "test_example_functions.h"
+#include "near_duplicates.h"
+#include "process_queries.h"
+#include "remove_duplicates.h"
+#include "scoring_model.h"
+#include "request_queue.h"
+#include "sharded_search_server.h"
+#include "term_set_signature.h"
+#include "versioned_search_server.h"
 
+#include <atomic>
 #include <execution>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
 
 #define assertm(exp, msg) assert(((void)msg, exp))
 
@@ -71,6 +83,11 @@ void TestExcludeMinusWordsFromAddedDocument(){
         assert(found_docs.size()==0);
         //ASSERT(server.FindTopDocuments("in -cat"s).empty());
         assert(server.FindTopDocuments("in -cat"s).empty());
+        // words missing from the index match nothing
+        const string query = "city dog -mouse"s;
+        const auto [words, status] = server.MatchDocument(std::execution::par, query, doc_id);
+        assert(words == vector<string_view>{"city"sv});
+        assert(get<0>(server.MatchDocument(std::execution::par, "city -cat"s, doc_id)).empty());
     }
 }
 
@@ -320,6 +337,926 @@ void TestRelevanceComputation() {
 }
 
 
+void TestWordFrequencies() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "cat and dog and cat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "dog"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "bird cat"s, DocumentStatus::ACTUAL, {1});
+    map<string, double> freqs;
+    for (const auto &[word, freq] : server.GetWordFrequencies(1)) {
+        freqs[string(word)] = freq;
+    }
+    assert(freqs.size() == 2);
+    assert(abs(freqs.at("cat"s) - 2.0 / 3) < 1e-6);
+    assert(abs(freqs.at("dog"s) - 1.0 / 3) < 1e-6);
+    assert(server.GetWordFrequencies(42).empty());
+
+    server.RemoveDocument(1);
+    server.RemoveDocument(std::execution::par, 2);
+    assert(server.GetWordFrequencies(1).empty());
+    assert(server.GetWordFrequencies(3).size() == 2);
+    assert(server.FindTopDocuments("dog"s).empty());
+    assert(server.FindTopDocuments("cat"s).size() == 1);
+}
+
+
+void TestGetDocument() {
+    auto server = make_unique<SearchServer>("and"s);
+    server->AddDocument(1, "cat and dog"s, DocumentStatus::BANNED, {1, 2, 6});
+    const SearchServer copy = *server;
+    server.reset();
+    const IndexedDocument document = copy.GetDocument(1);
+    assert(document.id == 1);
+    assert(document.text == "cat and dog"sv);
+    assert(document.status == DocumentStatus::BANNED);
+    assert(document.rating == 3);
+    try {
+        copy.GetDocument(2);
+        assert(false);
+    } catch (const out_of_range &) {
+    }
+}
+
+
+void TestRequestQueue() {
+    SearchServer server("and in at"s);
+    server.AddDocument(1, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    RequestQueue request_queue(server, 3);
+    request_queue.AddFindRequest("empty request"s);
+    request_queue.AddFindRequest("curly dog"s);
+    request_queue.AddFindRequest("big collar"s);
+    assert(request_queue.GetNoResultRequests() == 2);
+    request_queue.AddFindRequest("sparrow"s);
+    assert(request_queue.GetNoResultRequests() == 2);
+    request_queue.AddFindRequest("cat"s, DocumentStatus::ACTUAL);
+    request_queue.AddFindRequest("cat"s, [](int, DocumentStatus, int) { return true; });
+    assert(request_queue.GetNoResultRequests() == 1);
+
+    RequestQueue shared_queue(server, 1500);
+    vector<thread> threads;
+    for (int i = 0; i < 4; ++i) {
+        threads.emplace_back([&shared_queue, i] {
+            for (int j = 0; j < 500; ++j) {
+                shared_queue.AddFindRequest(j % 2 == 0 ? "cat"s : "dog"s + to_string(i));
+            }
+        });
+    }
+    for (thread &t : threads) {
+        t.join();
+    }
+    // the window holds the last 1500 of 1000 empty and 1000 found requests
+    const int no_result_count = shared_queue.GetNoResultRequests();
+    assert(no_result_count >= 500 && no_result_count <= 1000);
+    for (int i = 0; i < 1500; ++i) {
+        shared_queue.AddFindRequest("cat"s);
+    }
+    assert(shared_queue.GetNoResultRequests() == 0);
+}
+
+
+void TestLatencyHistogram() {
+    LatencyHistogram histogram;
+    for (int i = 1; i <= 1000; ++i) {
+        histogram.Record(chrono::microseconds(i));
+    }
+    assert(histogram.GetCount() == 1000);
+    // every value is known within the bucket width of 1/32
+    const auto near = [](chrono::nanoseconds value, double expected) {
+        return abs(value.count() - expected) <= expected / 32;
+    };
+    assert(near(histogram.GetPercentile(50), 500'000));
+    assert(near(histogram.GetPercentile(99), 990'000));
+    assert(near(histogram.GetMax(), 1'000'000));
+    for (uint64_t value : {0ull, 63ull, 64ull, 1000ull, 123456789ull}) {
+        const size_t index = LatencyHistogram::GetBucketIndex(value);
+        assert(LatencyHistogram::GetBucketMaxValue(index) >= value);
+        assert(index == 0 || LatencyHistogram::GetBucketMaxValue(index - 1) < value);
+    }
+
+    ResetLatencyHistograms();
+    SearchServer server("and"s);
+    thread writer([&server] {
+        server.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+    });
+    writer.join();
+    server.FindTopDocuments("cat"s);
+    server.FindTopDocuments(execution::par, "dog"s);
+    assert(GetLatencyHistogram(LatencyOperation::ADD_DOCUMENT).GetCount() == 1);
+    assert(GetLatencyHistogram(LatencyOperation::FIND_TOP_DOCUMENTS).GetCount() == 2);
+    assert(GetLatencyHistogram(LatencyOperation::REMOVE_DOCUMENT).GetCount() == 0);
+
+    ostringstream output;
+    StreamDurationSink sink(output);
+    {
+        LOG_DURATION_SINK("scope"s, sink);
+    }
+    assert(output.str().rfind("scope: "s, 0) == 0);
+}
+
+
+void TestTracing() {
+    ClearTrace();
+    SearchServer server("and"s);
+    server.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+    server.FindTopDocuments("cat -bird"s);
+    ostringstream trace;
+    WriteChromeTrace(trace);
+    assert(trace.str().rfind("{\"traceEvents\":["s, 0) == 0);
+#ifdef SEARCH_SERVER_TRACING
+    for (const string &stage : {"parse"s, "posting scan"s, "filter"s, "top-k"s}) {
+        assert(trace.str().find("{\"name\":\""s + stage + '"') != string::npos);
+    }
+#else
+    assert(trace.str().find("\"name\""s) == string::npos);
+#endif
+}
+
+
+void TestQueryStats() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cat and bird"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "dog"s, DocumentStatus::BANNED, {1});
+    QueryStats stats;
+    const auto documents = server.FindTopDocuments("cat dog unknown -bird"s, DocumentStatus::ACTUAL, stats);
+    assert(documents.size() == 1 && documents[0].id == 1);
+    assert(stats.terms_resolved == 3);
+    assert(stats.postings_scanned == 4);
+    assert(stats.predicate_evaluations == 4);
+    assert(stats.documents_scored == 2);
+    assert(stats.documents_excluded == 1);
+    assert(stats.candidates_sorted == 1);
+    assert(stats.scan_time.count() > 0);
+
+    server.FindTopDocuments("dog"s, DocumentStatus::BANNED, stats);
+    assert(stats.postings_scanned == 6);
+    assert(stats.candidates_sorted == 2);
+}
+
+
+void TestSlowQueryLog() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "cat and bird"s, DocumentStatus::BANNED, {1});
+    SlowQueryLog slow_query_log(0ns, 2);
+    RequestQueue request_queue(server, 10, &slow_query_log);
+    request_queue.AddFindRequest("cat"s);
+    request_queue.AddFindRequest("cat -dog"s, DocumentStatus::BANNED);
+    request_queue.AddFindRequest("bird"s, [](int, DocumentStatus, int) { return true; });
+    assert(slow_query_log.GetRecordedCount() == 3);
+    const vector<SlowQuery> entries = slow_query_log.GetEntries();
+    assert(entries.size() == 2);
+    assert(entries[0].raw_query == "cat -dog"s);
+    assert(entries[0].status == DocumentStatus::BANNED);
+    assert(entries[0].generation == 2);
+    assert(entries[0].stats.postings_scanned == 2);
+    assert(entries[0].stats.documents_excluded == 0);
+    assert(entries[1].raw_query == "bird"s && !entries[1].status);
+
+    stringstream stream;
+    WriteSlowQueries(stream, entries);
+    const vector<SlowQuery> read_entries = ReadSlowQueries(stream);
+    assert(read_entries.size() == 2);
+    assert(read_entries[0].raw_query == entries[0].raw_query);
+    assert(read_entries[0].status == entries[0].status);
+    assert(read_entries[0].latency == entries[0].latency);
+    assert(read_entries[0].stats.scan_time == entries[0].stats.scan_time);
+    assert(!read_entries[1].status);
+
+    SlowQueryLog strict_log(1h);
+    strict_log.Record("cat"s, DocumentStatus::ACTUAL, 1ms, 0, QueryStats{});
+    assert(strict_log.GetEntries().empty());
+}
+
+
+void TestPerfCounters() {
+    PerfCounts counts;
+    {
+        LOG_PERF(counts);
+        volatile uint64_t sum = 0;
+        for (uint64_t i = 0; i < 100'000; ++i) {
+            sum = sum + i * i;
+        }
+    }
+    // unavailable counters leave nothing behind, available ones count the loop
+    if (GetThreadPerfCounters().IsAvailable()) {
+        assert(counts.available != 0);
+        if (counts.Has(PerfEvent::INSTRUCTIONS)) {
+            assert(counts.Get(PerfEvent::INSTRUCTIONS) > 100'000);
+        }
+    } else {
+        assert(counts.available == 0);
+    }
+
+    PerfCounts first;
+    first.values = {10, 20, 0, 0, 0, 0};
+    first.available = 0b11;
+    PerfCounts second;
+    second.values = {4, 5, 1, 0, 0, 0};
+    second.available = 0b101;
+    const PerfCounts difference = first - second;
+    assert(difference.Get(PerfEvent::CYCLES) == 6);
+    assert(difference.available == 0b1);
+    PerfCounts sum;
+    sum += first;
+    sum += second;
+    assert(sum.Get(PerfEvent::INSTRUCTIONS) == 25 && sum.available == 0b111);
+    ostringstream output;
+    output << difference;
+    assert(output.str() == "{ cycles = 6 }"s);
+}
+
+void TestRemoveDuplicates() {
+    SearchServer server("and with"s);
+    server.AddDocument(1, "funny pet and nasty rat"s, DocumentStatus::ACTUAL, {7, 2, 7});
+    server.AddDocument(2, "funny pet with curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    // the same words as document 2, other frequencies
+    server.AddDocument(3, "funny pet with curly hair curly"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(4, "funny pet and curly hair"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(5, "nasty rat funny pet"s, DocumentStatus::BANNED, {1, 2});
+    server.AddDocument(6, "not very funny nasty pet"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(7, "and with"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(8, "with"s, DocumentStatus::ACTUAL, {1});
+    assert(ComputeTermSetSignature(server.GetWordFrequencies(2)) == ComputeTermSetSignature(server.GetWordFrequencies(3)));
+    assert(ComputeTermSetSignature(server.GetWordFrequencies(2)) != ComputeTermSetSignature(server.GetWordFrequencies(1)));
+
+    RemoveDuplicates(server);
+    assert(vector<int>(server.cbegin(), server.cend()) == (vector<int>{1, 2, 6, 7}));
+    assert(server.GetGeneration() == 12);
+    assert(server.FindTopDocuments("curly"s).size() == 1);
+    assert(server.GetDocumentFreq("rat"s) == 1);
+
+    try {
+        server.RemoveDocuments({1, 42});
+        assert(false);
+    } catch (const out_of_range&) {
+    }
+    assert(server.GetDocumentCount() == 4);
+    server.RemoveDocuments({6, 1, 6});
+    assert(vector<int>(server.cbegin(), server.cend()) == (vector<int>{2, 7}));
+    assert(server.FindTopDocuments("rat nasty"s).empty());
+}
+
+void TestRemoveNearDuplicates() {
+    const string base = "alpha bravo charlie delta echo foxtrot golf hotel india juliett kilo lima mike november oscar papa quebec romeo sierra tango"s;
+    SearchServer server(""s);
+    server.AddDocument(1, base, DocumentStatus::ACTUAL, {1});
+    // one word added, Jaccard similarity 20 / 21
+    server.AddDocument(2, base + " uniform"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(3, "alpha bravo charlie delta echo foxtrot golf hotel india juliett x y z w v u s r q p"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(4, "completely different words here"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(5, base + " uniform victor"s, DocumentStatus::ACTUAL, {1});
+    assert(ComputeJaccard(server.GetWordFrequencies(1), server.GetWordFrequencies(2)) == 20.0 / 21);
+
+    assert((ChooseLshBanding(128, 0.8).rows_per_band == 8));
+    const auto near_duplicates = FindNearDuplicates(server, 0.8);
+    assert((near_duplicates == vector<pair<int, int>>{{1, 2}, {1, 5}, {2, 5}}));
+
+    // sketches kept at ingest give the same pairs
+    SearchServer sketched(""s);
+    sketched.SetMinHashSize(64);
+    for (const int document_id : server) {
+        sketched.AddDocument(document_id, string(server.GetDocument(document_id).text), DocumentStatus::ACTUAL, {1});
+    }
+    assert(sketched.GetMinHashSketch(1).size() == 64);
+    assert(EstimateJaccard(sketched.GetMinHashSketch(1), sketched.GetMinHashSketch(2)) > 0.7);
+    assert(EstimateJaccard(sketched.GetMinHashSketch(1), sketched.GetMinHashSketch(4)) < 0.2);
+    assert(FindNearDuplicates(sketched, 0.8) == near_duplicates);
+
+    RemoveNearDuplicates(server, 0.8);
+    assert(vector<int>(server.cbegin(), server.cend()) == (vector<int>{1, 3, 4}));
+    try {
+        RemoveNearDuplicates(server, 0);
+        assert(false);
+    } catch (const invalid_argument&) {
+    }
+
+    // every pair of copies is reported
+    SearchServer copies(""s);
+    for (int id = 1; id <= 4; ++id) {
+        copies.AddDocument(id, base, DocumentStatus::ACTUAL, {1});
+    }
+    copies.AddDocument(5, base + " uniform"s, DocumentStatus::ACTUAL, {1});
+    assert((FindNearDuplicates(copies, 0.9) == vector<pair<int, int>>{
+        {1, 2}, {1, 3}, {1, 4}, {1, 5}, {2, 3}, {2, 4}, {2, 5}, {3, 4}, {3, 5}, {4, 5}
+    }));
+    RemoveNearDuplicates(copies, 0.9);
+    assert(vector<int>(copies.cbegin(), copies.cend()) == (vector<int>{1}));
+
+    // 1 ~ 2 ~ 3 with 1 and 3 below the threshold: 3 is similar to the
+    // removed 2 only and stays
+    const string words_3_to_20 = "charlie delta echo foxtrot golf hotel india juliett kilo lima mike november oscar papa quebec romeo sierra tango"s;
+    SearchServer chain(""s);
+    chain.AddDocument(1, base, DocumentStatus::ACTUAL, {1});
+    chain.AddDocument(2, base + " w x y z"s, DocumentStatus::ACTUAL, {1});
+    chain.AddDocument(3, words_3_to_20 + " w x y z v"s, DocumentStatus::ACTUAL, {1});
+    assert(ComputeJaccard(chain.GetWordFrequencies(1), chain.GetWordFrequencies(2)) >= 0.8);
+    assert(ComputeJaccard(chain.GetWordFrequencies(2), chain.GetWordFrequencies(3)) >= 0.8);
+    assert(ComputeJaccard(chain.GetWordFrequencies(1), chain.GetWordFrequencies(3)) < 0.8);
+    assert((FindNearDuplicates(chain, 0.8) == vector<pair<int, int>>{{1, 2}, {2, 3}}));
+    RemoveNearDuplicates(chain, 0.8);
+    assert(vector<int>(chain.cbegin(), chain.cend()) == (vector<int>{1, 3}));
+}
+
+void TestOnlineDeduplication() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "cat and dog"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "dog cat"s, DocumentStatus::ACTUAL, {1});
+    assert(!server.FindDuplicate("cat dog"s));
+
+    // documents added before enabling are indexed too
+    server.SetDuplicatePolicy(DuplicatePolicy::REJECT);
+    assert(server.FindDuplicate("dog dog cat"s).has_value());
+    try {
+        server.AddDocument(3, "cat dog cat"s, DocumentStatus::ACTUAL, {1});
+        assert(false);
+    } catch (const DuplicateDocumentError& error) {
+        assert(error.GetDocumentId() == 3);
+        assert(error.GetOriginalId() == 1 || error.GetOriginalId() == 2);
+    }
+    assert(server.GetDocumentCount() == 2 && server.GetGeneration() == 2);
+    server.AddDocument(3, "cat and bird"s, DocumentStatus::ACTUAL, {1});
+    // a new word cannot be a duplicate
+    server.AddDocument(4, "cat dog fish"s, DocumentStatus::ACTUAL, {1});
+
+    // the index follows removals and copies
+    server.RemoveDocument(1);
+    server.RemoveDocument(execution::par, 2);
+    SearchServer copy = server;
+    copy.AddDocument(5, "dog cat"s, DocumentStatus::ACTUAL, {1});
+    assert(copy.FindDuplicate("cat dog"s) == 5);
+    assert(!server.FindDuplicate("cat dog"s));
+
+    copy.SetDuplicatePolicy(DuplicatePolicy::FLAG);
+    copy.AddDocument(6, "cat dog"s, DocumentStatus::ACTUAL, {1});
+    copy.AddDocument(7, "bird cat"s, DocumentStatus::ACTUAL, {1});
+    assert(copy.GetFlaggedDuplicates() == (set<int>{6, 7}));
+    copy.RemoveDocuments({5, 7});
+    assert(copy.GetFlaggedDuplicates() == set<int>{6});
+    assert(copy.FindDuplicate("cat dog"s) == 6);
+
+    copy.SetDuplicatePolicy(DuplicatePolicy::ALLOW);
+    copy.AddDocument(8, "cat dog"s, DocumentStatus::ACTUAL, {1});
+    assert(copy.GetFlaggedDuplicates().empty());
+}
+
+void TestSearchCursor() {
+    SearchServer server("and"s);
+    const vector<string> texts = {
+        "cat"s, "cat dog"s, "cat and bird"s, "dog"s, "cat cat fish"s, "bird"s, "cat"s, "cat dog fish"s,
+    };
+    for (size_t i = 0; i < texts.size(); ++i) {
+        // equal texts get different ratings to exercise the tie breaks
+        server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, {static_cast<int>(i % 3)});
+    }
+    server.AddDocument(100, "cat"s, DocumentStatus::BANNED, {1});
+
+    const SearchPage all = server.FindPage("cat dog fish"s, SearchCursor(), 100);
+    assert(all.documents.size() == 7 && !all.next);
+    assert(is_sorted(all.documents.begin(), all.documents.end(), SearchCursor::IsRankedBefore));
+    const auto top = server.FindTopDocuments("cat dog fish"s);
+    for (size_t i = 0; i < top.size(); ++i) {
+        assert(top[i].id == all.documents[i].id);
+    }
+
+    vector<int> paged_ids;
+    string cursor_text = SearchCursor().Serialize();
+    int page_count = 0;
+    while (true) {
+        const SearchPage page = server.FindPage("cat dog fish"s, SearchCursor::Parse(cursor_text), 3);
+        ++page_count;
+        for (const Document& document : page.documents) {
+            paged_ids.push_back(document.id);
+        }
+        if (!page.next) {
+            break;
+        }
+        assert(SearchCursor::Parse(page.next->Serialize()) == *page.next);
+        cursor_text = page.next->Serialize();
+    }
+    assert(page_count == 3);
+    assert(paged_ids.size() == all.documents.size());
+    for (size_t i = 0; i < paged_ids.size(); ++i) {
+        assert(paged_ids[i] == all.documents[i].id);
+    }
+
+    const SearchPage banned = server.FindPage("cat"s, DocumentStatus::BANNED, SearchCursor(), 2);
+    assert(banned.documents.size() == 1 && banned.documents[0].id == 100 && !banned.next);
+    const SearchPage even = server.FindPage(
+        "cat"s, [](int document_id, DocumentStatus, int) { return document_id % 2 == 0; }, SearchCursor(), 10
+    );
+    // the predicate ignores the status
+    assert(even.documents.size() == 5);
+    try {
+        SearchCursor::Parse("garbage"s);
+        assert(false);
+    } catch (const invalid_argument&) {
+    }
+
+    // "cat" makes k of the 2k + 1 words of document k, so neighbours differ
+    // in relevance by less than EPS while the ones two apart do not; the
+    // ratings fall as the relevance grows to make every tie break matter
+    SearchServer near_ties("and"s);
+    for (int id = 0; id < 5; ++id) {
+        near_ties.AddDocument(id, "dog"s, DocumentStatus::ACTUAL, {});
+    }
+    for (int k = 400; k < 408; ++k) {
+        string text;
+        for (int i = 0; i < k; ++i) {
+            text += "cat "s;
+        }
+        for (int i = 0; i <= k; ++i) {
+            text += "fish "s;
+        }
+        near_ties.AddDocument(k, text, DocumentStatus::ACTUAL, {408 - k});
+    }
+    const SearchPage near_all = near_ties.FindPage("cat"s, SearchCursor(), 100);
+    assert(near_all.documents.size() == 8);
+    assert(abs(near_all.documents[0].relevance - near_all.documents[1].relevance) < EPS);
+    assert(abs(near_all.documents[0].relevance - near_all.documents[2].relevance) >= EPS);
+    for (size_t i = 0; i < near_all.documents.size(); ++i) {
+        assert(near_all.documents[i].id == 407 - static_cast<int>(i));
+    }
+    for (size_t page_size = 1; page_size <= 3; ++page_size) {
+        vector<int> near_ids;
+        SearchCursor near_cursor;
+        while (true) {
+            const SearchPage page = near_ties.FindPage("cat"s, near_cursor, page_size);
+            for (const Document& document : page.documents) {
+                near_ids.push_back(document.id);
+            }
+            if (!page.next) {
+                break;
+            }
+            near_cursor = *page.next;
+        }
+        assert(near_ids.size() == near_all.documents.size());
+        for (size_t i = 0; i < near_ids.size(); ++i) {
+            assert(near_ids[i] == near_all.documents[i].id);
+        }
+    }
+}
+
+void TestScoringModels() {
+    for (uint32_t length = 0; length < EXACT_LENGTH_LIMIT; ++length) {
+        assert(DecodeLengthNorm(EncodeLengthNorm(length)) == length);
+    }
+    for (uint32_t length = EXACT_LENGTH_LIMIT; length < 100000; length = length * 5 / 4) {
+        assert(EncodeLengthNorm(length) <= EncodeLengthNorm(length + 1));
+        assert(abs(DecodeLengthNorm(EncodeLengthNorm(length)) / length - 1.0) < 0.05);
+    }
+
+    const vector<string> texts = {
+        "cat"s, "cat dog"s, "cat cat cat cat dog"s, "dog bird fish"s, "cat bird bird bird bird bird"s,
+    };
+    SearchServer server(""s);
+    double total_length = 0;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        server.AddDocument(i, texts[i], DocumentStatus::ACTUAL, {1});
+        total_length += SplitText(texts[i]).size();
+    }
+    assert(holds_alternative<TfIdf>(server.GetScoringModel()));
+    const auto tf_idf = server.FindTopDocuments("cat"s);
+
+    const Bm25 bm25{1.5, 0.5};
+    server.SetScoringModel(bm25);
+    const double average_length = total_length / texts.size();
+    assert(abs(server.GetAverageDocumentLength() - average_length) < 1e-9);
+    // the short documents are exact, so the scores match the formula
+    const auto expected_score = [&](int document_id, const string &word) {
+        const vector<string> words = SplitText(texts[document_id]);
+        const double count = std::count(words.begin(), words.end(), word);
+        int document_freq = 0;
+        for (const string &text : texts) {
+            const vector<string> text_words = SplitText(text);
+            document_freq += std::count(text_words.begin(), text_words.end(), word) > 0;
+        }
+        const double weight = log(1.0 + (texts.size() - document_freq + 0.5) / (document_freq + 0.5));
+        return weight * count * (bm25.k1 + 1)
+            / (count + bm25.k1 * (1 - bm25.b + bm25.b * words.size() / average_length));
+    };
+    const auto found = server.FindTopDocuments("cat dog"s);
+    const auto found_par = server.FindTopDocuments(execution::par, "cat dog"s);
+    assert(found.size() == 5 && found_par.size() == found.size());
+    for (size_t i = 0; i < found.size(); ++i) {
+        const double expected = expected_score(found[i].id, "cat"s) + expected_score(found[i].id, "dog"s);
+        assert(abs(found[i].relevance - expected) < 1e-9);
+        assert(found_par[i].id == found[i].id && abs(found_par[i].relevance - expected) < 1e-9);
+    }
+    // TF-IDF ranks by the share of cats, BM25 puts four cats in five
+    // words above a single cat
+    assert(tf_idf[0].id == 0);
+    assert(server.FindTopDocuments("cat"s)[0].id == 2);
+
+    server.RemoveDocument(4);
+    assert(abs(server.GetAverageDocumentLength() - (total_length - 6) / 4) < 1e-9);
+    server.SetScoringModel(TfIdf{});
+    assert(server.FindTopDocuments("cat"s)[0].id == 0);
+}
+
+void TestImpactIndex() {
+    SearchServer server("and"s);
+    const vector<string> words = {"cat"s, "dog"s, "bird"s, "fish"s, "tail"s, "ear"s, "paw"s};
+    uint32_t state = 12345;
+    const auto next = [&state](uint32_t bound) {
+        state = state * 1103515245u + 12345u;
+        return (state >> 16) % bound;
+    };
+    for (int id = 0; id < 300; ++id) {
+        string text = "cat"s;
+        for (uint32_t i = next(12); i > 0; --i) {
+            // lower words are more frequent
+            text += " "s + words[min(next(words.size()), next(words.size()))];
+        }
+        const auto status = id % 10 == 0 ? DocumentStatus::BANNED : DocumentStatus::ACTUAL;
+        server.AddDocument(id, text, status, {static_cast<int>(next(5))});
+    }
+    const vector<string> queries = {"cat"s, "dog paw"s, "fish -dog"s, "cat ear tail -bird"s, "and"s};
+    const auto same_ids = [](const vector<Document> &lhs, const vector<Document> &rhs) {
+        return equal(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), [](const Document &l, const Document &r) {
+            return l.id == r.id;
+        });
+    };
+
+    assert(!server.HasImpactIndex());
+    for (const string &query : queries) {
+        assert(same_ids(server.FindTopDocumentsByImpact(query), server.FindTopDocuments(query)));
+    }
+
+    server.BuildImpactIndex(ImpactPrecision::BITS_16);
+    assert(server.HasImpactIndex());
+    for (const string &query : queries) {
+        const auto exact = server.FindTopDocuments(query);
+        const auto found = server.FindTopDocumentsByImpact(query);
+        assert(same_ids(found, exact));
+        for (size_t i = 0; i < found.size(); ++i) {
+            assert(abs(found[i].relevance - exact[i].relevance) < 1e-3);
+        }
+        assert(same_ids(
+            server.FindTopDocumentsByImpact(query, DocumentStatus::BANNED),
+            server.FindTopDocuments(query, DocumentStatus::BANNED)
+        ));
+    }
+    // a search from the predicate of another one gets its own accumulators
+    const auto nested = server.FindTopDocumentsByImpact("dog paw"s, [&](int, DocumentStatus status, int) {
+        return status == DocumentStatus::ACTUAL && !server.FindTopDocumentsByImpact("fish"s).empty();
+    });
+    assert(same_ids(nested, server.FindTopDocumentsByImpact("dog paw"s)));
+    // the top is known after the highest impacts
+    QueryStats stats;
+    server.FindTopDocumentsByImpact("dog"s, DocumentStatus::ACTUAL, {0, &stats});
+    const auto dog_postings = static_cast<uint64_t>(server.GetDocumentFreq("dog"s));
+    assert(stats.postings_scanned > 0 && stats.postings_scanned < dog_postings / 2);
+
+    server.BuildImpactIndex(ImpactPrecision::BITS_8);
+    const auto exact = server.FindTopDocuments("dog paw"s);
+    const auto coarse = server.FindTopDocumentsByImpact("dog paw"s);
+    assert(coarse.size() == exact.size());
+    for (size_t i = 0; i < coarse.size(); ++i) {
+        // two words, each off by at most half of 1/255 of the highest score
+        assert(abs(coarse[i].relevance - exact[i].relevance) < 0.01 * exact[0].relevance);
+    }
+    const auto anytime = server.FindTopDocumentsByImpact("dog paw"s, DocumentStatus::ACTUAL, {1, nullptr});
+    assert(!anytime.empty() && anytime.size() <= coarse.size());
+    assert(is_sorted(anytime.begin(), anytime.end(), SearchServer::IsMoreRelevant));
+
+    server.AddDocument(1000, "dog dog paw"s, DocumentStatus::ACTUAL, {5});
+    assert(!server.HasImpactIndex());
+    assert(server.FindTopDocumentsByImpact("dog paw"s)[0].id == 1000);
+    server.BuildImpactIndex();
+    server.SetScoringModel(Bm25{});
+    assert(!server.HasImpactIndex());
+}
+
+void TestProcessQueries() {
+    SearchServer server("and with"s);
+    int id = 0;
+    for (
+        const string& text : {
+            "funny pet and nasty rat"s,
+            "funny pet with curly hair"s,
+            "funny pet and not very nasty rat"s,
+            "pet with rat and rat and rat"s,
+            "nasty rat with curly hair"s,
+        }
+    ) {
+        server.AddDocument(++id, text, DocumentStatus::ACTUAL, {1, 2});
+    }
+    QueryExecutor::Options options;
+    options.thread_count = 3;
+    options.grain_size = 2;
+    server.SetExecutor(make_shared<QueryExecutor>(options));
+    const vector<string> queries = {
+        "nasty rat -not"s,
+        "not very funny nasty pet"s,
+        "curly hair"s,
+        "cat"s,
+        "-pet rat"s,
+    };
+    const auto documents_lists = ProcessQueries(server, queries);
+    assert(documents_lists.size() == queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto expected = server.FindTopDocuments(queries[i]);
+        assert(documents_lists[i].size() == expected.size());
+        for (size_t j = 0; j < expected.size(); ++j) {
+            assert(documents_lists[i][j].id == expected[j].id);
+        }
+    }
+    const auto joined = ProcessQueriesJoined(server, queries);
+    size_t position = 0;
+    for (const auto& documents : documents_lists) {
+        for (const Document& document : documents) {
+            assert(joined.at(position++).id == document.id);
+        }
+    }
+    assert(position == joined.size());
+
+    stringstream input;
+    for (const string& query : queries) {
+        input << query << '\n';
+    }
+    size_t next_index = 0;
+    const size_t processed = ProcessQueriesStream(
+        server,
+        input,
+        [&](size_t index, const string& query, const vector<Document>& documents) {
+            assert(index == next_index++);
+            assert(query == queries[index]);
+            assert(documents.size() == documents_lists[index].size());
+        },
+        2
+    );
+    assert(processed == queries.size());
+    assert(next_index == queries.size());
+
+    bool is_thrown = false;
+    try {
+        ProcessQueries(server, {"rat"s, "--rat"s});
+    } catch (const invalid_argument&) {
+        is_thrown = true;
+    }
+    assert(is_thrown);
+}
+
+
+void TestFindTopDocumentsAsync() {
+    SearchServer server("and"s);
+    server.AddDocument(1, "white cat and yellow hat"s, DocumentStatus::ACTUAL, {1});
+    server.AddDocument(2, "curly cat curly tail"s, DocumentStatus::ACTUAL, {2});
+    server.AddDocument(3, "nasty dog"s, DocumentStatus::BANNED, {3});
+
+    atomic<int> callback_calls = 0;
+    auto future = server.FindTopDocumentsAsync(
+        "curly cat"s,
+        DocumentStatus::ACTUAL,
+        {},
+        [&callback_calls](const vector<Document>& documents, exception_ptr error) {
+            assert(documents.size() == 2);
+            assert(!error);
+            ++callback_calls;
+        }
+    );
+    const auto expected = server.FindTopDocuments("curly cat"s);
+    const auto found = future.get();
+    assert(callback_calls == 1);
+    assert(found.size() == expected.size());
+    assert(found[0].id == expected[0].id);
+
+    auto banned = server.FindTopDocumentsAsync(
+        "dog"s,
+        [](int, DocumentStatus status, int) { return status == DocumentStatus::BANNED; }
+    );
+    assert(banned.get().at(0).id == 3);
+
+    CancellationToken token;
+    token.Cancel();
+    auto cancelled = server.FindTopDocumentsAsync("cat"s, DocumentStatus::ACTUAL, token);
+    bool is_cancelled = false;
+    try {
+        cancelled.get();
+    } catch (const QueryCancelled&) {
+        is_cancelled = true;
+    }
+    assert(is_cancelled);
+}
+
+
+void TestVersionedSearchServer() {
+    VersionedSearchServer server(SearchServer("and"s));
+    server.AddDocument(1, "white cat and yellow hat"s, DocumentStatus::ACTUAL, {1});
+    const auto snapshot = server.GetSnapshot();
+    server.Update([](SearchServer& search_server) {
+        search_server.AddDocument(2, "curly cat curly tail"s, DocumentStatus::ACTUAL, {2});
+        search_server.AddDocument(3, "nasty dog"s, DocumentStatus::ACTUAL, {3});
+    });
+    server.RemoveDocument(1);
+    assert(snapshot->GetDocumentCount() == 1);
+    assert(snapshot->FindTopDocuments("cat"s).at(0).id == 1);
+    assert(server.GetDocumentCount() == 2);
+    assert(server.GetGeneration() == snapshot->GetGeneration() + 3);
+    assert(server.FindTopDocuments("cat"s).at(0).id == 2);
+
+    bool is_thrown = false;
+    try {
+        server.Update([](SearchServer& search_server) {
+            search_server.AddDocument(4, "grey cat"s, DocumentStatus::ACTUAL, {});
+            search_server.AddDocument(4, "grey cat"s, DocumentStatus::ACTUAL, {});
+        });
+    } catch (const invalid_argument&) {
+        is_thrown = true;
+    }
+    assert(is_thrown);
+    assert(server.GetDocumentCount() == 2);
+
+    // readers drop the last snapshot of most versions while the writer
+    // publishes new ones
+    const auto before_writes = server.GetSnapshot();
+    atomic<bool> is_writing = true;
+    thread writer([&server, &is_writing] {
+        for (int id = 100; id < 200; ++id) {
+            server.AddDocument(id, "cat number "s + to_string(id), DocumentStatus::ACTUAL, {id});
+        }
+        is_writing = false;
+    });
+    vector<thread> readers;
+    for (int reader = 0; reader < 3; ++reader) {
+        readers.emplace_back([&server, &before_writes, &is_writing] {
+            do {
+                const auto pinned = server.GetSnapshot();
+                // every write adds one document
+                const uint64_t writes = pinned->GetGeneration() - before_writes->GetGeneration();
+                assert(static_cast<uint64_t>(pinned->GetDocumentCount()) == 2 + writes);
+                // every document but "nasty dog" has a cat
+                const size_t cat_count = pinned->GetDocumentCount() - 1;
+                assert(pinned->FindTopDocuments("cat"s).size() == min<size_t>(cat_count, 5));
+            } while (is_writing);
+        });
+    }
+    writer.join();
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    assert(server.GetDocumentCount() == 102);
+    assert(before_writes->GetDocumentCount() == 2);
+    assert(before_writes->FindTopDocuments("cat"s).at(0).id == 2);
+
+    // the versions written in turn, replayed or copied, match one server
+    // given the same writes
+    VersionedSearchServer versioned(SearchServer("and"s));
+    SearchServer expected("and"s);
+    const auto check_equal = [&versioned, &expected] {
+        const auto pinned = versioned.GetSnapshot();
+        assert(pinned->GetGeneration() == expected.GetGeneration());
+        assert(pinned->GetDocumentCount() == expected.GetDocumentCount());
+        for (const string& query : {"cat"s, "curly dog"s, "cat -tail"s}) {
+            const auto lhs = pinned->FindTopDocuments(query);
+            const auto rhs = expected.FindTopDocuments(query);
+            assert(lhs.size() == rhs.size());
+            for (size_t i = 0; i < lhs.size(); ++i) {
+                assert(lhs[i].id == rhs[i].id && lhs[i].relevance == rhs[i].relevance);
+            }
+        }
+    };
+    for (int id = 0; id < 30; ++id) {
+        const string text = (id % 3 == 0 ? "curly cat"s : "dog with tail"s) + " number "s + to_string(id);
+        versioned.AddDocument(id, text, DocumentStatus::ACTUAL, {id});
+        expected.AddDocument(id, text, DocumentStatus::ACTUAL, {id});
+        if (id % 4 == 3) {
+            versioned.RemoveDocument(id - 2);
+            expected.RemoveDocument(id - 2);
+        }
+        if (id == 10) {
+            versioned.Update([](SearchServer& search_server) { search_server.SetScoringModel(Bm25{}); });
+            expected.SetScoringModel(Bm25{});
+        }
+        if (id == 20) {
+            // a failed write and a pinned snapshot keep the standby from
+            // being reused
+            const auto pinned = versioned.GetSnapshot();
+            try {
+                versioned.Update([](SearchServer& search_server) {
+                    search_server.RemoveDocuments({0, 3});
+                    search_server.AddDocument(0, "cat"s, DocumentStatus::ACTUAL, {});
+                    search_server.AddDocument(0, "cat"s, DocumentStatus::ACTUAL, {});
+                });
+                assert(false);
+            } catch (const invalid_argument&) {
+            }
+        }
+        check_equal();
+    }
+}
+
+
+void TestSerializeIndex() {
+    SearchServer server("and with"s);
+    server.SetMinHashSize(8);
+    server.SetDuplicatePolicy(DuplicatePolicy::FLAG);
+    server.AddDocument(1, "white cat and yellow hat"s, DocumentStatus::ACTUAL, {1, 2});
+    server.AddDocument(2, "curly cat curly tail"s, DocumentStatus::ACTUAL, {7});
+    server.AddDocument(3, "nasty dog with big eyes"s, DocumentStatus::BANNED, {-3});
+    server.AddDocument(4, "tail curly cat"s, DocumentStatus::ACTUAL, {});
+    server.AddDocument(5, "big grey mouse"s, DocumentStatus::ACTUAL, {2});
+    server.RemoveDocument(5);
+    server.SetScoringModel(Bm25{1.5, 0.5});
+    const string data = server.SerializeIndex();
+
+    SearchServer loaded("cat"s);
+    loaded.LoadIndex(data);
+    assert(loaded.GetGeneration() == server.GetGeneration());
+    assert(loaded.GetDocumentCount() == 4);
+    assert(loaded.GetFlaggedDuplicates() == set<int>{4});
+    assert(loaded.GetMinHashSketch(2) == server.GetMinHashSketch(2));
+    assert(loaded.GetTotalDocumentLength() == server.GetTotalDocumentLength());
+    assert(get<Bm25>(loaded.GetScoringModel()).k1 == 1.5);
+    assert(loaded.GetDocument(3).text == "nasty dog with big eyes"s);
+    assert(loaded.GetDocument(3).rating == -3);
+    assert(loaded.SerializeIndex() == data);
+    for (const string& query : {"cat"s, "curly -hat"s, "big mouse"s, "with"s}) {
+        const auto expected = server.FindTopDocuments(query);
+        const auto found = loaded.FindTopDocuments(query);
+        assert(found.size() == expected.size());
+        for (size_t i = 0; i < found.size(); ++i) {
+            assert(found[i].id == expected[i].id && found[i].relevance == expected[i].relevance);
+        }
+    }
+    assert(loaded.FindTopDocuments("eyes"s, DocumentStatus::BANNED).at(0).id == 3);
+    // the loaded server is as writable as the original
+    assert(loaded.FindDuplicate("hat yellow cat white"s) == 1);
+    loaded.AddDocument(6, "yellow cat"s, DocumentStatus::ACTUAL, {});
+    loaded.RemoveDocument(1);
+    assert(loaded.FindTopDocuments("yellow"s).at(0).id == 6);
+
+    // malformed data leaves the server unchanged
+    for (const string& bad : {data.substr(0, data.size() - 1), data + "x"s, "index"s}) {
+        try {
+            loaded.LoadIndex(bad);
+            assert(false);
+        } catch (const invalid_argument&) {
+        }
+        assert(loaded.GetDocumentCount() == 4);
+    }
+
+    // a loaded version is replayed onto the standby like any other write
+    VersionedSearchServer versioned(SearchServer(""s));
+    versioned.AddDocument(10, "old document"s, DocumentStatus::ACTUAL, {});
+    versioned.Update([&data](SearchServer& search_server) { search_server.LoadIndex(data); });
+    versioned.AddDocument(11, "cat"s, DocumentStatus::ACTUAL, {});
+    versioned.AddDocument(12, "grey cat"s, DocumentStatus::ACTUAL, {});
+    assert(versioned.GetDocumentCount() == 6);
+    assert(versioned.FindTopDocuments("document"s).empty());
+    assert(versioned.FindTopDocuments("grey"s).at(0).id == 12);
+}
+
+
+void TestShardedSearchServer() {
+    const vector<string> texts = {
+        "white cat and yellow hat"s,
+        "curly cat curly tail"s,
+        "nasty dog with big eyes"s,
+        "nasty pigeon john"s,
+        "funny pet and nasty rat"s,
+        "funny pet with curly hair"s,
+        "big cat with big eyes"s,
+        "pet with rat and rat and rat"s,
+        "cat"s,
+        "old grey cat with long curly tail and big yellow eyes"s,
+        "funny nasty rat"s,
+    };
+    SearchServer single("and with"s);
+    ShardedSearchServer sharded(3, "and with"s);
+    vector<NewDocument> documents;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        const int id = static_cast<int>(i) + 1;
+        const vector<int> ratings = {id % 3};
+        single.AddDocument(id, texts[i], DocumentStatus::ACTUAL, ratings);
+        documents.push_back({id, texts[i], DocumentStatus::ACTUAL, ratings});
+    }
+    sharded.AddDocuments(documents);
+    single.RemoveDocument(4);
+    sharded.RemoveDocument(4);
+    assert(sharded.GetDocumentCount() == single.GetDocumentCount());
+    assert(sharded.GetDocumentFreq("cat"s) == single.GetDocumentFreq("cat"s));
+
+    // the shards differ in average length, which BM25 must not see
+    for (const ScoringModel& model : {ScoringModel(TfIdf{}), ScoringModel(Bm25{})}) {
+        single.SetScoringModel(model);
+        sharded.SetScoringModel(model);
+        for (const string& query : {"curly cat"s, "big nasty eyes -dog"s, "funny pet rat"s, "pigeon"s, "rat with pet rat"s}) {
+            const auto expected = single.FindTopDocuments(query);
+            const auto found = sharded.FindTopDocuments(query);
+            assert(found.size() == expected.size());
+            for (size_t i = 0; i < expected.size(); ++i) {
+                assert(found[i].id == expected[i].id);
+                assert(abs(found[i].relevance - expected[i].relevance) < 1e-6);
+            }
+        }
+    }
+    const auto [words, status] = sharded.MatchDocument("curly tail"s, 2);
+    assert(words.size() == 2);
+}
+
+
 void TestAll()
 {
     TestExcludeStopWordsFromAddedDocumentContent();
@@ -329,4 +1266,23 @@ void TestAll()
     TestPredicatFiltering();
     TestStatusFiltering();
     TestRelevanceComputation();
+    TestWordFrequencies();
+    TestGetDocument();
+    TestRequestQueue();
+    TestLatencyHistogram();
+    TestTracing();
+    TestQueryStats();
+    TestSlowQueryLog();
+    TestPerfCounters();
+    TestRemoveDuplicates();
+    TestRemoveNearDuplicates();
+    TestOnlineDeduplication();
+    TestSearchCursor();
+    TestScoringModels();
+    TestImpactIndex();
+    TestProcessQueries();
+    TestFindTopDocumentsAsync();
+    TestVersionedSearchServer();
+    TestSerializeIndex();
+    TestShardedSearchServer();
 }
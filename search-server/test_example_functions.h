@@ -23,4 +23,23 @@ double ComputeWordInverseDocumentFreq(
     std::map<std::string, std::map<int, double>> word_to_document_freqs_
 );
 void TestRelevanceComputation();
+void TestWordFrequencies();
+void TestGetDocument();
+void TestRequestQueue();
+void TestLatencyHistogram();
+void TestTracing();
+void TestQueryStats();
+void TestSlowQueryLog();
+void TestPerfCounters();
+void TestRemoveDuplicates();
+void TestRemoveNearDuplicates();
+void TestOnlineDeduplication();
+void TestSearchCursor();
+void TestScoringModels();
+void TestImpactIndex();
+void TestProcessQueries();
+void TestFindTopDocumentsAsync();
+void TestVersionedSearchServer();
+void TestSerializeIndex();
+void TestShardedSearchServer();
 void TestAll();
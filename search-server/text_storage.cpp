@@ -0,0 +1,14 @@
+#include "text_storage.h"
+
+using namespace std;
+
+std::string_view TextStorage::Store(std::string_view text)
+{
+    lock_guard guard(mx_);
+    auto it = texts_.find(text);
+    if (it == texts_.end())
+    {
+        it = texts_.emplace(text).first;
+    }
+    return *it;
+}
@@ -0,0 +1,19 @@
+#pragma once
+#include <mutex>
+#include <set>
+#include <string>
+#include <string_view>
+
+// Append-only storage of the texts the index refers to through string_views.
+// Copies of a server share one storage, so the views stay valid in all of them
+// and the copies may add texts from different threads.
+class TextStorage
+{
+public:
+    // returns a view of the stored copy of text, equal texts are stored once
+    std::string_view Store(std::string_view text);
+
+private:
+    std::mutex mx_;
+    std::set<std::string, std::less<>> texts_;
+};
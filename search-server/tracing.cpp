@@ -0,0 +1,161 @@
+#include "tracing.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+using namespace std::literals;
+
+namespace {
+
+struct TraceEvent {
+    const char *name;
+    uint64_t start_ns;
+    uint64_t duration_ns;
+};
+
+struct TraceBuffer {
+    array<TraceEvent, TRACE_BUFFER_SIZE> events;
+    // number of spans ever recorded, the last TRACE_BUFFER_SIZE are kept
+    atomic<uint64_t> size{0};
+    int thread_index = 0;
+};
+
+// Buffers outlive their threads so the trace keeps their spans; the
+// buffer of a finished thread goes to the next new one.
+struct Registry {
+    mutex mx;
+    vector<unique_ptr<TraceBuffer>> all;
+    vector<TraceBuffer *> free;
+};
+
+Registry &GetRegistry()
+{
+    // never destroyed, threads may trace while static objects are destroyed
+    static Registry *registry = new Registry;
+    return *registry;
+}
+
+[[maybe_unused]] uint64_t GetTraceTime()
+{
+    static const auto start_time = chrono::steady_clock::now();
+    return chrono::duration_cast<chrono::nanoseconds>(
+        chrono::steady_clock::now() - start_time
+    ).count();
+}
+
+#ifdef SEARCH_SERVER_TRACING
+
+struct TraceBufferHolder {
+    TraceBuffer *buffer;
+
+    TraceBufferHolder()
+    {
+        Registry &registry = GetRegistry();
+        lock_guard guard(registry.mx);
+        if (registry.free.empty())
+        {
+            registry.all.push_back(make_unique<TraceBuffer>());
+            buffer = registry.all.back().get();
+            buffer->thread_index = static_cast<int>(registry.all.size());
+        }
+        else
+        {
+            buffer = registry.free.back();
+            registry.free.pop_back();
+        }
+    }
+
+    ~TraceBufferHolder()
+    {
+        Registry &registry = GetRegistry();
+        lock_guard guard(registry.mx);
+        registry.free.push_back(buffer);
+    }
+};
+
+TraceBuffer &GetThreadTraceBuffer()
+{
+    thread_local TraceBufferHolder holder;
+    return *holder.buffer;
+}
+
+#endif
+
+void WriteJsonString(std::ostream &os, const char *text)
+{
+    os << '"';
+    for (; *text != '\0'; ++text)
+    {
+        if (*text == '"' || *text == '\\')
+        {
+            os << '\\';
+        }
+        os << *text;
+    }
+    os << '"';
+}
+
+}
+
+#ifdef SEARCH_SERVER_TRACING
+
+TraceSpan::TraceSpan(const char *name)
+    : name_(name),
+      start_ns_(GetTraceTime())
+{
+}
+
+TraceSpan::~TraceSpan()
+{
+    TraceBuffer &buffer = GetThreadTraceBuffer();
+    const uint64_t index = buffer.size.load(memory_order_relaxed);
+    buffer.events[index % TRACE_BUFFER_SIZE] = {name_, start_ns_, GetTraceTime() - start_ns_};
+    buffer.size.store(index + 1, memory_order_release);
+}
+
+#endif
+
+void WriteChromeTrace(std::ostream &os)
+{
+    Registry &registry = GetRegistry();
+    lock_guard guard(registry.mx);
+    os << "{\"traceEvents\":["s;
+    bool is_first = true;
+    char times[64];
+    for (const auto &buffer : registry.all)
+    {
+        const uint64_t size = buffer->size.load(memory_order_acquire);
+        const uint64_t first = size > TRACE_BUFFER_SIZE ? size - TRACE_BUFFER_SIZE : 0;
+        for (uint64_t i = first; i < size; ++i)
+        {
+            const TraceEvent &event = buffer->events[i % TRACE_BUFFER_SIZE];
+            os << (is_first ? "\n"s : ",\n"s) << "{\"name\":"s;
+            WriteJsonString(os, event.name);
+            // timestamps are in microseconds
+            snprintf(
+                times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f",
+                event.start_ns / 1000.0, event.duration_ns / 1000.0
+            );
+            os << ",\"ph\":\"X\","s << times
+               << ",\"pid\":1,\"tid\":"s << buffer->thread_index << '}';
+            is_first = false;
+        }
+    }
+    os << "\n]}\n"s;
+}
+
+void ClearTrace()
+{
+    Registry &registry = GetRegistry();
+    lock_guard guard(registry.mx);
+    for (const auto &buffer : registry.all)
+    {
+        buffer->size.store(0, memory_order_release);
+    }
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+
+#include "log_duration.h"
+
+// Timeline tracing of the search stages. TRACE_SCOPE(name) records the
+// lifetime of the scope as a span on the calling thread; name must be a
+// string literal. Spans go to a per-thread ring buffer that keeps the last
+// TRACE_BUFFER_SIZE spans of the thread, so recording takes no lock and
+// allocates nothing after the first span of a thread.
+// Tracing is compiled in only when SEARCH_SERVER_TRACING is defined;
+// otherwise TRACE_SCOPE expands to nothing and the trace stays empty.
+
+const size_t TRACE_BUFFER_SIZE = 1 << 15;
+
+// Writes the recorded spans in the Chrome trace event format, viewable in
+// chrome://tracing or Perfetto. Spans recorded while it runs may be torn,
+// so it should be called after the traced work has finished.
+void WriteChromeTrace(std::ostream &os);
+void ClearTrace();
+
+#ifdef SEARCH_SERVER_TRACING
+
+class TraceSpan
+{
+public:
+    explicit TraceSpan(const char *name);
+    ~TraceSpan();
+
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+    const char *name_;
+    const uint64_t start_ns_;
+};
+
+#define TRACE_SCOPE(name) TraceSpan UNIQUE_VAR_NAME_PROFILE(name)
+
+#else
+
+#define TRACE_SCOPE(name) static_cast<void>(0)
+
+#endif
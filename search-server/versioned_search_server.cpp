@@ -0,0 +1,164 @@
+#include "versioned_search_server.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <thread>
+
+using namespace std;
+
+// Frees the versions handed to it on its own thread, in batches. Versions
+// still queued when it is destroyed are freed before the destructor returns.
+class VersionedSearchServer::Reclaimer
+{
+public:
+    Reclaimer()
+        : thread_([this] { Run(); })
+    {
+    }
+
+    ~Reclaimer()
+    {
+        {
+            lock_guard guard(mx_);
+            is_stopping_ = true;
+        }
+        retired_.notify_one();
+        thread_.join();
+    }
+
+    Reclaimer(const Reclaimer &) = delete;
+    Reclaimer &operator=(const Reclaimer &) = delete;
+
+    void Retire(const SearchServer *version)
+    {
+        {
+            lock_guard guard(mx_);
+            versions_.push_back(version);
+        }
+        retired_.notify_one();
+    }
+
+private:
+    mutex mx_;
+    condition_variable retired_;
+    vector<const SearchServer *> versions_;
+    bool is_stopping_ = false;
+    thread thread_;
+
+    void Run()
+    {
+        vector<const SearchServer *> versions;
+        unique_lock lock(mx_);
+        while (true)
+        {
+            retired_.wait(lock, [this] { return is_stopping_ || !versions_.empty(); });
+            if (versions_.empty())
+            {
+                return;
+            }
+            versions.swap(versions_);
+            lock.unlock();
+            for (const SearchServer *version : versions)
+            {
+                delete version;
+            }
+            versions.clear();
+            lock.lock();
+        }
+    }
+};
+
+VersionedSearchServer::VersionedSearchServer(SearchServer search_server)
+    : reclaimer_(make_shared<Reclaimer>())
+{
+    latest_ = MakeVersion(make_unique<SearchServer>(move(search_server)));
+    current_ = latest_;
+}
+
+VersionedSearchServer::Version VersionedSearchServer::MakeVersion(
+    std::unique_ptr<SearchServer> search_server
+) const
+{
+    return Version(
+        search_server.release(),
+        [reclaimer = reclaimer_](const SearchServer *retired) {
+            reclaimer->Retire(retired);
+        }
+    );
+}
+
+VersionedSearchServer::Version VersionedSearchServer::TakeStandby()
+{
+    Version standby = move(standby_);
+    vector<SearchServer::Change> changes = move(standby_changes_);
+    standby_changes_.clear();
+    // snapshots are only taken of current_, so once the standby is not
+    // shared no reader can get hold of it again
+    if (standby && standby.use_count() == 1)
+    {
+        // see the readers' last accesses before changing the version
+        atomic_thread_fence(memory_order_acquire);
+        standby->Replay(changes);
+        return standby;
+    }
+    return MakeVersion(make_unique<SearchServer>(*latest_));
+}
+
+void VersionedSearchServer::Publish(
+    Version next,
+    std::vector<SearchServer::Change> changes
+)
+{
+    atomic_store(&current_, Snapshot(next));
+    standby_ = exchange(latest_, move(next));
+    standby_changes_ = move(changes);
+}
+
+VersionedSearchServer::Snapshot VersionedSearchServer::GetSnapshot() const
+{
+    return atomic_load(&current_);
+}
+
+uint64_t VersionedSearchServer::GetGeneration() const
+{
+    return GetSnapshot()->GetGeneration();
+}
+
+void VersionedSearchServer::AddDocument(
+    int document_id,
+    const std::string &document,
+    DocumentStatus status,
+    const std::vector<int> &ratings
+)
+{
+    Update([&](SearchServer &search_server) {
+        search_server.AddDocument(document_id, document, status, ratings);
+    });
+}
+
+void VersionedSearchServer::RemoveDocument(int document_id)
+{
+    Update([document_id](SearchServer &search_server) {
+        search_server.RemoveDocument(document_id);
+    });
+}
+
+std::vector<Document> VersionedSearchServer::FindTopDocuments(
+    std::string_view raw_query
+) const
+{
+    return GetSnapshot()->FindTopDocuments(raw_query);
+}
+
+std::vector<Document> VersionedSearchServer::FindTopDocuments(
+    std::string_view raw_query,
+    DocumentStatus status
+) const
+{
+    return GetSnapshot()->FindTopDocuments(raw_query, status);
+}
+
+int VersionedSearchServer::GetDocumentCount() const
+{
+    return GetSnapshot()->GetDocumentCount();
+}
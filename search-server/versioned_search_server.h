@@ -0,0 +1,107 @@
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "search_server.h"
+
+// SearchServer safe for concurrent reads and writes. Readers pin an
+// immutable snapshot of the index and never wait for writers. Two versions
+// are kept: the published one and a standby, the version published before
+// it. A writer replays the changes the standby missed on it, applies its
+// own, publishes it atomically and makes the replaced version the standby,
+// so a write costs twice its own work and does not copy the index. The
+// index is copied only while a reader still holds the standby. A version
+// is freed by a background thread once the last snapshot referring to it
+// is released, so neither the query dropping it nor the writer replacing
+// it pays for the destruction.
+class VersionedSearchServer
+{
+public:
+    using Snapshot = std::shared_ptr<const SearchServer>;
+
+    explicit VersionedSearchServer(SearchServer search_server);
+
+    // the current version, stays valid and unchanged while it is held
+    Snapshot GetSnapshot() const;
+    uint64_t GetGeneration() const;
+
+    void AddDocument(
+        int document_id,
+        const std::string &document,
+        DocumentStatus status,
+        const std::vector<int> &ratings
+    );
+    void RemoveDocument(int document_id);
+    // applies mutation(SearchServer&) and publishes the result as one
+    // version; nothing is published if mutation throws
+    template <typename Mutation>
+    void Update(Mutation mutation);
+
+    std::vector<Document> FindTopDocuments(std::string_view raw_query) const;
+    std::vector<Document> FindTopDocuments(
+        std::string_view raw_query,
+        DocumentStatus status
+    ) const;
+    template <typename DocumentPredicate>
+    std::vector<Document> FindTopDocuments(
+        std::string_view raw_query,
+        DocumentPredicate document_predicate
+    ) const;
+    int GetDocumentCount() const;
+
+private:
+    class Reclaimer;
+
+    using Version = std::shared_ptr<SearchServer>;
+
+    // shared with the snapshots, which may outlive the server
+    std::shared_ptr<Reclaimer> reclaimer_;
+    Snapshot current_;
+    std::mutex write_mx_;
+    // guarded by write_mx_: current_ as the writer changes it, the standby
+    // and the changes published since the standby was current
+    Version latest_;
+    Version standby_;
+    std::vector<SearchServer::Change> standby_changes_;
+
+    // a version handing itself to the reclaimer when released
+    Version MakeVersion(std::unique_ptr<SearchServer> search_server) const;
+    // the standby caught up with latest_, or a copy of latest_ if a reader
+    // still holds the standby
+    Version TakeStandby();
+    void Publish(Version next, std::vector<SearchServer::Change> changes);
+};
+
+template <typename Mutation>
+void VersionedSearchServer::Update(Mutation mutation)
+{
+    std::lock_guard guard(write_mx_);
+    Version next = TakeStandby();
+    std::vector<SearchServer::Change> changes;
+    next->SetChangeLog(&changes);
+    try
+    {
+        mutation(*next);
+    }
+    catch (...)
+    {
+        // partly changed, the next write starts from a copy
+        next->SetChangeLog(nullptr);
+        throw;
+    }
+    next->SetChangeLog(nullptr);
+    Publish(std::move(next), std::move(changes));
+}
+
+template <typename DocumentPredicate>
+std::vector<Document> VersionedSearchServer::FindTopDocuments(
+    std::string_view raw_query,
+    DocumentPredicate document_predicate
+) const
+{
+    return GetSnapshot()->FindTopDocuments(raw_query, document_predicate);
+}